@@ -163,7 +163,6 @@ public:
 #else
         //auto stylizedContent = CreateTransformerNet(inputPre, training);
         auto generator = CreateGeneratorModel(IMAGE_WIDTH, IMAGE_HEIGHT);
-        generator->LoadWeights(string(STYLE) + "_weights.h5", false, true);
         auto stylizedContentPre = (*generator)(inputPre)[0];
 #endif
         auto stylizedFeatures = vggFeaturesModel(stylizedContentPre, "generated_features");
@@ -185,6 +184,13 @@ public:
 
         auto optimizer = Adam(LEARNING_RATE);
         auto minimize = optimizer.Minimize({ totalLoss });
+#if !defined(SLOW)
+        // resume from checkpoint including optimizer state when available
+        if (fs::exists(string(STYLE) + "_weights.ckpt"))
+            generator->LoadCheckpoint(string(STYLE) + "_weights.ckpt", minimize);
+        else if (fs::exists(string(STYLE) + "_weights.h5"))
+            generator->LoadWeights(string(STYLE) + "_weights.h5", false, true);
+#endif
 
         Tensor contentBatch(Shape::From(input->GetShape(), BATCH_SIZE));
 
@@ -223,11 +229,11 @@ public:
                 float loss = (*results[1])(0);
                 auto genImage = *results[0];
                 VGG16::DeprocessImage(genImage, NCHW);
-                genImage.SaveAsImage(string(STYLE) + "_" + to_string(i) + "_output.png", false);
+                ImageWriter::Default().Write(genImage, string(STYLE) + "_" + to_string(i) + "_output.png", false);
                 if (minLoss <= 0 || loss < minLoss)
                 {
 #if !defined(SLOW)
-                    generator->SaveWeights(string(STYLE) + "_weights.h5");
+                    generator->SaveCheckpoint(string(STYLE) + "_weights.ckpt", minimize);
 #endif
                     minLoss = loss;
                 }
@@ -265,7 +271,11 @@ public:
         auto input = new Placeholder(testContent.GetShape(), "input");
         auto inputPre = VGG16::Preprocess(input, NCHW);
         auto generator = CreateGeneratorModel(testContent.GetShape().Width(), testContent.GetShape().Height());
-        generator->LoadWeights(string("data/") + STYLE + "_weights.h5", false, true);
+        // weights trained before checkpoints were introduced are only available in HDF5 format
+        if (fs::exists(string("data/") + STYLE + "_weights.ckpt"))
+            generator->LoadCheckpoint(string("data/") + STYLE + "_weights.ckpt");
+        else
+            generator->LoadWeights(string("data/") + STYLE + "_weights.h5", false, true);
         auto stylizedContentPre = (*generator)(inputPre)[0];
 
         auto results = Session::Default()->Run({ stylizedContentPre }, { { input, &testContent } });
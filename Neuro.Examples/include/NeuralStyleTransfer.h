@@ -118,7 +118,7 @@ public:
             {
                 auto genImage = *results[0];
                 VGG16::DeprocessImage(genImage, NCHW);
-                genImage.SaveAsImage(outputName + "-" + to_string(e) + ".jpg", false);
+                ImageWriter::Default().Write(genImage, outputName + "-" + to_string(e) + ".jpg", false);
             }
         }
 
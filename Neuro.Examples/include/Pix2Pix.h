@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <iomanip>
+#include <ppl.h>
 
 #include "Neuro.h"
 
@@ -26,16 +28,27 @@ public:
             outImg.ResizeBatch(m_BatchSize);
             outImg.OverrideHost();
 
-            for (uint32_t n = 0; n < m_BatchSize; ++n)
+            vector<unsigned int> seeds;
+            auto files = SampleFiles(m_Rng, &seeds);
+            concurrency::parallel_for(0u, m_BatchSize, [&](uint32_t n)
             {
-                const auto& file = m_Files[m_Rng.Next((int)m_Files.size())];
-                //cout << "Load: " << file << endl;
-                auto img = LoadImage(file, cndImg.Width() * m_UpScaleFactor, cndImg.Height() * m_UpScaleFactor, cndImg.Width(), cndImg.Height());
-                auto edges = CannyEdgeDetection(img).ToRGB();
-                
-                edges.Sub(127.5f).Div(127.5f).CopyBatchTo(0, (uint32_t)n, cndImg);
-                img.Sub(127.5f).Div(127.5f).CopyBatchTo(0, (uint32_t)n, outImg);                
-            }
+                Random cropRng(seeds[n]);
+                LoadImage(*files[n], outImg.Values() + n * outImg.BatchLength(), outImg.Width() * m_UpScaleFactor, outImg.Height() * m_UpScaleFactor, outImg.Width(), outImg.Height(), NCHW, ImagePreprocess(), &cropRng);
+            });
+
+            // edges are detected for the whole batch at once, before images get normalized
+            Tensor edges;
+            CannyEdgeDetection(outImg, edges);
+
+            const uint32_t planeSize = cndImg.Width() * cndImg.Height();
+            const float* edgesValues = edges.Values();
+            float* cndValues = cndImg.Values();
+            for (uint32_t n = 0; n < m_BatchSize; ++n)
+            for (uint32_t c = 0; c < 3; ++c)
+                transform(edgesValues + n * planeSize, edgesValues + (n + 1) * planeSize, cndValues + (n * 3 + c) * planeSize, [](float x) { return x / 127.5f - 1.f; });
+
+            outImg.Sub(127.5f, outImg);
+            outImg.Div(127.5f, outImg);
 
             cndImg.CopyToDevice();
             outImg.CopyToDevice();
@@ -68,9 +81,10 @@ public:
             Tensor t2(Shape::From(img2.GetShape(), 1));
             tensor_ptr_vec_t tmp{ &t1, &t2 };
 
+            auto files = SampleFiles(m_Rng);
             for (uint32_t n = 0; n < m_BatchSize; ++n)
             {
-                const auto& file = m_Files[m_Rng.Next((int)m_Files.size())];
+                const auto& file = *files[n];
                 auto img = LoadImage(file, img1.Width() * 2, img1.Height());
                 img.Split(WidthAxis, tmp);
 
@@ -136,14 +150,15 @@ public:
         auto discOpt = new Adam(LEARNING_RATE, ADAM_BETA1);
         auto discMinimize = discOpt->Minimize({ discLoss });
 
-        dModel->LoadWeights(NAME + "_disc.h5", false, true);
-        gModel->LoadWeights(NAME + "_gen.h5", false, true);
+        dModel->LoadCheckpoint(NAME + "_disc.ckpt", discMinimize);
+        gModel->LoadCheckpoint(NAME + "_gen.ckpt", genMinimize);
 
-        // setup data preloader
+        // setup data preloader, decoded images are cached so they are decoded only once
+        ImageCache::Default().SetCapacity((size_t)2 * 1024 * 1024 * 1024);
         EdgeImageLoader loader(trainFiles, BATCH_SIZE, 1);
-        DataPreloader preloader({ inputImg->OutputPtr(), targetImg->OutputPtr() }, { &loader }, 5);
+        DataPreloader preloader({ inputImg->OutputPtr(), targetImg->OutputPtr() }, { &loader }, 6, true, 3);
         //SplitImageLoader loader(trainFiles, BATCH_SIZE, 1); // facades
-        //DataPreloader preloader({ targetImg->OutputPtr(), inputImg->OutputPtr() }, { &loader }, 5); // facades
+        //DataPreloader preloader({ targetImg->OutputPtr(), inputImg->OutputPtr() }, { &loader }, 6, true, 3); // facades
 
         const size_t STEPS = trainFiles.size() * EPOCHS;
 
@@ -171,11 +186,12 @@ public:
 
             if (s % 50 == 0)
             {
-                dModel->SaveWeights(NAME + "_disc.h5");
-                gModel->SaveWeights(NAME + "_gen.h5");
+                dModel->SaveCheckpoint(NAME + "_disc.ckpt", discMinimize);
+                gModel->SaveCheckpoint(NAME + "_gen.ckpt", genMinimize);
                 Tensor tmp(Shape(IMG_SHAPE.Width() * 3, IMG_SHAPE.Height(), IMG_SHAPE.Depth(), BATCH_SIZE));
                 Tensor::Concat(WidthAxis, { inputImg->OutputPtr(), &_genImg, targetImg->OutputPtr() }, tmp);
-                tmp.Add(1.f).Mul(127.5f).SaveAsImage(NAME + "_s" + PadLeft(to_string(s), 4, '0') + ".jpg", false, 1);
+                ImageWriter::Default().Write(tmp.Add(1.f).Mul(127.5f), NAME + "_s" + PadLeft(to_string(s), 4, '0') + ".jpg", false, 1);
+                cout << endl << preloader.Stats().ToString() << " - image cache hits: " << ImageCache::Default().Hits() << " misses: " << ImageCache::Default().Misses() << endl;
             }
 
             stringstream extString;
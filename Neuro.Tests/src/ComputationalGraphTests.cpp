@@ -1,5 +1,10 @@
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
 #include "CppUnitTest.h"
 #include "Neuro.h"
+#include "ComputationalGraph/Predicter.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Neuro;
@@ -20,6 +25,307 @@ namespace NeuroTests
             Assert::AreEqual(5.0, (double)(*result[0])(0));
         }
 
+        TEST_METHOD(ConcurrentGradient)
+        {
+            Tensor::SetDefaultOpMode(CPU_MT);
+
+            auto x = new Variable(Tensor(Shape(3, 4)).FillWithRand());
+            auto w = new Variable(Tensor(Shape(5, 3)).FillWithRand());
+            auto b = new Variable(Tensor(Shape(5)).FillWithRand());
+            auto h = add(matmul(x, w), b);
+            // h has multiple consumers so its gradient has to be accumulated
+            auto y = sum(add(add(multiply(h, h), sigmoid(h)), add(tanh(h), h)));
+
+            auto grads = gradients(y, vector<Variable*>{ x, w, b });
+
+            Graph::Default()->ConcurrentGradients(false);
+            auto serialResult = Session::Default()->Run(grads);
+            vector<Tensor> serialGrads;
+            for (auto grad : serialResult)
+                serialGrads.push_back(*grad);
+
+            Graph::Default()->ConcurrentGradients(true);
+            auto concurrentResult = Session::Default()->Run(grads);
+            Graph::Default()->ConcurrentGradients(false);
+
+            for (size_t i = 0; i < serialGrads.size(); ++i)
+                Assert::IsTrue(serialGrads[i].Equals(*concurrentResult[i]));
+        }
+
+        TEST_METHOD(ConcurrentGradientsSum)
+        {
+            Tensor::SetDefaultOpMode(CPU_MT);
+
+            auto x = new Variable(Tensor(Shape(3, 4)).FillWithRand());
+            auto w = new Variable(Tensor(Shape(5, 3)).FillWithRand());
+            auto h = matmul(x, w);
+            // enough consumers of h for its gradient to be summed in multiple chunks
+            TensorLike* y = multiply(h, h);
+            for (int i = 1; i < 16; ++i)
+                y = add(y, multiply(h, (float)i));
+            y = sum(y);
+
+            auto grads = gradients(y, vector<Variable*>{ x, w });
+
+            Graph::Default()->ConcurrentGradients(false);
+            auto serialResult = Session::Default()->Run(grads);
+            vector<Tensor> serialGrads;
+            for (auto grad : serialResult)
+                serialGrads.push_back(*grad);
+
+            // partial sums buffers are reused by subsequent runs
+            Graph::Default()->ConcurrentGradients(true);
+            for (int run = 0; run < 2; ++run)
+            {
+                auto concurrentResult = Session::Default()->Run(grads);
+                for (size_t i = 0; i < serialGrads.size(); ++i)
+                    Assert::IsTrue(serialGrads[i].Equals(*concurrentResult[i], 0.001f));
+            }
+            Graph::Default()->ConcurrentGradients(false);
+        }
+
+        TEST_METHOD(ConcurrentGradientEarlyUpdate)
+        {
+            Tensor::SetDefaultOpMode(CPU_MT);
+
+            auto x = new Variable(Tensor(Shape(3, 4)).FillWithRand());
+            auto w = new Variable(Tensor(Shape(5, 3)).FillWithRand());
+            auto b = new Variable(Tensor(Shape(5)).FillWithRand());
+            auto h = add(matmul(x, w), b);
+            auto y = sum(add(multiply(h, h), sigmoid(h)));
+
+            Session::Default()->Run({ y });
+
+            GradientsPlan plan;
+            plan.losses = { y };
+            plan.params = { x, w, b };
+
+            vector<Tensor> readyGrads(plan.params.size());
+            vector<int> readyCount(plan.params.size(), 0);
+            mutex readyMtx;
+
+            Graph::Default()->ConcurrentGradients(true);
+            Tensor::SetForcedOpMode(CPU);
+            auto& vars = Graph::Default()->ComputeGradients(plan, [&](Variable* var, size_t i)
+            {
+                unique_lock<mutex> locker(readyMtx);
+                ++readyCount[i];
+                readyGrads[i] = var->OutputGrad();
+            });
+            Graph::Default()->ConcurrentGradients(false);
+
+            // some gradients could have been computed on calling thread, its forced op mode has to survive that
+            EOpMode forcedMode;
+            bool forced = Tensor::GetForcedOpMode(forcedMode);
+            Tensor::ClearForcedOpMode();
+            Assert::IsTrue(forced);
+            Assert::IsTrue(forcedMode == CPU);
+
+            // every gradient has to be reported exactly once and already be final at that point
+            Assert::AreEqual(plan.params.size(), vars.size());
+            for (size_t i = 0; i < vars.size(); ++i)
+            {
+                Assert::AreEqual(1, readyCount[i]);
+                Assert::IsTrue(readyGrads[i].Equals(vars[i]->OutputGrad()));
+            }
+        }
+
+        TEST_METHOD(SameInputGradient)
+        {
+            auto x = new Variable(Tensor({ 1, 2, 3 }, Shape(3)));
+            // every use of x by the same operation contributes its own input gradient
+            auto y = sum(add(subtract(x, x), multiply(x, x)));
+
+            auto grads = gradients(y, x);
+            auto result = Session::Default()->Run(grads);
+
+            Assert::IsTrue(result[0]->Equals(Tensor({ 2, 4, 6 }, Shape(3))));
+        }
+
+        TEST_METHOD(ZeroCopyFeedRestoresPlaceholderValue)
+        {
+            auto x = new Placeholder(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto y = multiply(x, 2.f);
+
+            Tensor input({ 4, 5, 6 }, Shape(3));
+            auto result = Session::Default()->Run({ y }, { { x, &input } });
+            Assert::IsTrue(result[0]->Equals(Tensor({ 8, 10, 12 }, Shape(3))));
+
+            // placeholder is not fed this time so its own value has to be used
+            result = Session::Default()->Run({ y });
+            Assert::IsFalse(x->Output().IsAlias());
+            Assert::IsTrue(result[0]->Equals(Tensor({ 2, 4, 6 }, Shape(3))));
+        }
+
+        TEST_METHOD(ProfileForwardAndGradient)
+        {
+            auto x = new Variable(Tensor(Shape(3, 4)).FillWithRand());
+            auto w = new Variable(Tensor(Shape(5, 3)).FillWithRand());
+            TensorLike* mm;
+            TensorLike* y;
+            {
+                NameScope scope("dense");
+                mm = matmul(x, w);
+                y = sum(mm);
+            }
+            auto grads = gradients(y, w);
+            Assert::AreEqual(string("MatMulOp"), static_cast<Operation*>(mm)->TypeName());
+
+            Session session;
+            session.Profiling(true);
+            session.Run(grads);
+            // profiler is set on graph only for the duration of a run
+            Assert::IsTrue(Graph::Default()->GetProfiler() == nullptr);
+            session.Profiling(false);
+            session.Run(grads);
+
+            auto perType = session.GetProfiler().StatsPerOpType();
+            Assert::AreEqual((size_t)1, perType["MatMulOp"].forwardCount);
+            Assert::AreEqual((size_t)1, perType["MatMulOp"].gradientCount);
+            Assert::AreEqual((uint64_t)2 * 20 * 3, session.GetProfiler().Events()[0].flops);
+
+            auto perLayer = session.GetProfiler().StatsPerLayer();
+            Assert::AreEqual((size_t)2, perLayer["dense"].forwardCount);
+        }
+
+        TEST_METHOD(OptimizeGraph)
+        {
+            auto x = new Placeholder(Shape(3));
+            auto c = new Constant(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto w = new Variable(Tensor({ 2, 2, 2 }, Shape(3)));
+            w->SetTrainable(false);
+
+            // depends only on constant, frozen variable is not folded
+            auto c2 = add(c, c);
+            auto k = square(c2);
+            auto kw = multiply(k, w);
+            auto y = add(multiply(x, kw), multiply(x, kw));
+            // not required by fetches so it has to stay in graph
+            auto other = add(x, c);
+
+            auto report = Graph::Default()->Optimize({ y }, GO_ConstantFolding | GO_CommonSubexpressionElimination | GO_DeadNodeElimination);
+
+            Assert::AreEqual((size_t)1, report.folded.size());
+            Assert::AreEqual(k->Name(), report.folded[0].first);
+            Assert::AreEqual((size_t)1, report.merged.size());
+            // only input of folded operation became dead
+            Assert::AreEqual((size_t)1, report.removed.size());
+            Assert::AreEqual(c2->Name(), report.removed[0]);
+            Assert::IsTrue(find(Graph::Default()->Operations().begin(), Graph::Default()->Operations().end(), other) != Graph::Default()->Operations().end());
+
+            Tensor input({ 1, 2, 3 }, Shape(3));
+            auto result = Session::Default()->Run({ y }, { { x, &input } });
+            Assert::IsTrue(result[0]->Equals(Tensor({ 16, 128, 432 }, Shape(3))));
+
+            // changing frozen variable (ie. loading weights) has to be reflected
+            Tensor({ 1, 1, 1 }, Shape(3)).CopyTo(w->Output());
+            result = Session::Default()->Run({ y }, { { x, &input } });
+            Assert::IsTrue(result[0]->Equals(Tensor({ 8, 64, 216 }, Shape(3))));
+        }
+
+        TEST_METHOD(SessionOptimizeGraph)
+        {
+            auto x = new Placeholder(Shape(3));
+            auto c = new Constant(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto a = multiply(x, c);
+            auto b = multiply(x, c);
+            auto y = add(a, b);
+
+            Session session;
+            session.OptimizeGraph(true);
+
+            Tensor input({ 1, 2, 3 }, Shape(3));
+            auto result = session.Run({ y }, { { x, &input } });
+            Assert::IsTrue(result[0]->Equals(Tensor({ 2, 8, 18 }, Shape(3))));
+
+            // identical operations were merged when plan was compiled
+            auto& ops = Graph::Default()->Operations();
+            Assert::IsTrue(find(ops.begin(), ops.end(), a) == ops.end() || find(ops.begin(), ops.end(), b) == ops.end());
+        }
+
+        TEST_METHOD(ElementwiseFusion)
+        {
+            auto a = new Variable(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto b = new Constant(Tensor({ 0, 0, 1 }, Shape(3)));
+            auto loss = sum(square(sub(a, b)));
+
+            auto grads = gradients(loss, a);
+
+            auto report = Graph::Default()->Optimize(grads, GO_ElementwiseFusion);
+            Assert::AreEqual((size_t)3, report.fused.size());
+
+            auto result = Session::Default()->Run(grads);
+
+            Assert::IsTrue(result[0]->Equals(Tensor({ 2, 4, 4 }, Shape(3))));
+        }
+
+        TEST_METHOD(ElementwiseFusionBroadcast)
+        {
+            auto x = new Placeholder(Shape(3));
+            auto b = new Variable(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto loss = sum(square(sub(x, b)));
+
+            auto grads = gradients(loss, b);
+            vector<TensorLike*> fetches = { loss, grads[0] };
+
+            // batch size is only known when running so b has to be broadcast by fused kernel
+            auto report = Graph::Default()->Optimize(fetches, GO_ElementwiseFusion);
+            Assert::IsTrue(!report.fused.empty());
+
+            Tensor input({ 1, 2, 3, 3, 4, 5 }, Shape(3, 1, 1, 2));
+            auto result = Session::Default()->Run(fetches, { { x, &input } });
+
+            Assert::AreEqual(12.0, (double)(*result[0])(0), 0.0001);
+            Assert::IsTrue(result[1]->Equals(Tensor({ -4, -4, -4 }, Shape(3))));
+        }
+
+        TEST_METHOD(SaveLoadGraph)
+        {
+            auto x = new Placeholder(Shape(3));
+            auto w = new Variable(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto y = relu(add(multiply(x, w), -2.f));
+
+            Graph::Default()->Save("graph.ng", { x }, { y });
+
+            // operations are stored under compiler independent names
+            ifstream file("graph.ng", ios::in | ios::binary);
+            string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+            file.close();
+            Assert::IsTrue(content.find("MultiplyOp") != string::npos);
+            Assert::IsTrue(content.find("Neuro::") == string::npos);
+
+            auto loaded = Graph::Default()->Load("graph.ng");
+
+            Assert::AreEqual((size_t)1, loaded.inputs.size());
+            Assert::AreEqual((size_t)1, loaded.outputs.size());
+            Assert::AreEqual((size_t)5, loaded.order.size());
+
+            Tensor input({ 1, 1, 1 }, Shape(3));
+            Predicter predicter(loaded.inputs, loaded.outputs, loaded.order);
+            auto result = predicter.Predict({ &input });
+
+            Assert::IsTrue(result[0]->Equals(Tensor({ 0, 0, 1 }, Shape(3))));
+        }
+
+        TEST_METHOD(SaveLoadGraph_WithoutWeights)
+        {
+            auto x = new Placeholder(Shape(3));
+            auto w = new Variable(Shape(3), new Const(2.f));
+            auto b = new Variable(Tensor({ 1, 2, 3 }, Shape(3)));
+            auto y = add(multiply(x, w), b);
+
+            Graph::Default()->Save("graph_no_weights.ng", { x }, { y }, false);
+
+            auto loaded = Graph::Default()->Load("graph_no_weights.ng");
+
+            // variable with initializer is initialized anew while the one without it keeps its embedded values
+            Tensor input({ 1, 2, 3 }, Shape(3));
+            Predicter predicter(loaded.inputs, loaded.outputs, loaded.order);
+            auto result = predicter.Predict({ &input });
+
+            Assert::IsTrue(result[0]->Equals(Tensor({ 3, 6, 9 }, Shape(3))));
+        }
+
         TEST_METHOD(SimpleGraphTrain)
         {
             vector<TensorLike*> fetches;
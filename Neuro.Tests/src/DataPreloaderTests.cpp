@@ -0,0 +1,142 @@
+#include <atomic>
+#include <fstream>
+#include <set>
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(DataPreloaderTests)
+    {
+        struct CountingLoader : public ILoader
+        {
+            virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override
+            {
+                auto& x = dest[loadIdx];
+                x.OverrideHost();
+                int value = counter++;
+                x.Values()[0] = (float)value;
+                // uneven load times make workers finish out of order, every slow batch is overtaken by several fast ones
+                this_thread::sleep_for(chrono::milliseconds(value % 4 == 0 ? 8 : 1));
+                return 1;
+            }
+
+            atomic<int> counter{ 0 };
+        };
+
+        TEST_METHOD(MultipleWorkers_EachBatchDeliveredOnce)
+        {
+            TestDelivery(false, false);
+        }
+
+        TEST_METHOD(MultipleWorkers_Ordered_SwapStorage_EachBatchDeliveredOnce)
+        {
+            TestDelivery(true, true);
+        }
+
+        TEST_METHOD(RecordDataset_WriteRead)
+        {
+            Tensor samples(Shape(5, 4, 3, 7));
+            samples.FillWithRange(0, 1.5f);
+
+            {
+                RecordDatasetWriter writer("test_records", samples.GetShape(), RT_Float, 3);
+                writer.Write(samples);
+            }
+
+            RecordDataset dataset("test_records");
+            Assert::IsTrue(dataset.IsValid());
+            Assert::AreEqual((size_t)7, dataset.Size());
+            Assert::IsTrue(dataset.SampleShape() == Shape(5, 4, 3));
+
+            vector<size_t> indices = { 6, 0, 3, 3 };
+            Tensor batch(Shape(5, 4, 3, (uint32_t)indices.size()));
+            batch.OverrideHost();
+            dataset.Gather(indices, batch.Values());
+
+            for (uint32_t n = 0; n < indices.size(); ++n)
+            {
+                Tensor expected(Shape(5, 4, 3));
+                samples.CopyBatchTo((uint32_t)indices[n], 0, expected);
+                Tensor actual(Shape(5, 4, 3));
+                batch.CopyBatchTo(n, 0, actual);
+                Assert::IsTrue(actual.Equals(expected));
+            }
+        }
+
+        TEST_METHOD(CsvLoader_LoadAndStream)
+        {
+            {
+                ofstream file("test_data.csv");
+                file << "1.5,-2e1,2\r\n\n0.25,.5,0\n7,8,1";
+            }
+
+            Tensor inputs, outputs;
+            LoadCSVData("test_data.csv", 3, inputs, outputs, true);
+            Assert::IsTrue(inputs.Equals(Tensor({ 1.5f, -20, 0.25f, 0.5f, 7, 8 }, Shape(2, 1, 1, 3))));
+            Assert::IsTrue(outputs.Equals(Tensor({ 0, 0, 1, 1, 0, 0, 0, 1, 0 }, Shape(3, 1, 1, 3))));
+
+            CsvLoader loader("test_data.csv", 3, 2, true);
+            Assert::IsTrue(loader.IsValid());
+            vector<Tensor> dest = { Tensor(loader.InputShape()), Tensor(loader.OutputShape()) };
+
+            Assert::AreEqual((size_t)2, loader(dest, 0));
+            Assert::IsTrue(dest[0].Equals(Tensor({ 1.5f, -20, 0.25f, 0.5f }, Shape(2, 1, 1, 2))));
+            // reading continues from the beginning once end of file is reached
+            loader(dest, 0);
+            Assert::IsTrue(dest[0].Equals(Tensor({ 7, 8, 1.5f, -20 }, Shape(2, 1, 1, 2))));
+            Assert::IsTrue(dest[1].Equals(Tensor({ 0, 1, 0, 0, 0, 1 }, Shape(3, 1, 1, 2))));
+        }
+
+        TEST_METHOD(Augmentation_CenterCropAndFlip)
+        {
+            Tensor source(Shape(4, 3, 2, 2));
+            source.FillWithRange();
+            Tensor destination(Shape(2, 3, 2));
+
+            Random rng(7);
+            Augmentation().FlipHorizontally(1.f).Normalize(2.f, 1.f).Apply(source, destination, rng);
+
+            Assert::AreEqual(source.Batch(), destination.Batch());
+            for (uint32_t n = 0; n < source.Batch(); ++n)
+            for (uint32_t d = 0; d < source.Depth(); ++d)
+            for (uint32_t h = 0; h < source.Height(); ++h)
+            for (uint32_t w = 0; w < destination.Width(); ++w)
+                Assert::AreEqual(source(2 - w, h, d, n) * 2.f + 1.f, destination(w, h, d, n));
+        }
+
+        void TestDelivery(bool ordered, bool swapStorage)
+        {
+            const int LOADS = 40;
+            const int CAPACITY = 6;
+            Tensor dest(Shape(1));
+            CountingLoader loader;
+            set<int> delivered;
+
+            {
+                DataPreloader preloader({ &dest }, { &loader }, CAPACITY, true, 4, ordered);
+                for (int i = 0; i < LOADS; ++i)
+                {
+                    preloader.Load(swapStorage);
+                    int value = (int)dest(0);
+                    delivered.insert(value);
+
+                    // batches are handed out in order workers picked them up, loader values are assigned a moment later so
+                    // they can only be shuffled among batches picked up before the pending one is delivered
+                    if (ordered)
+                        Assert::IsTrue(abs(value - i) < CAPACITY);
+                }
+
+                auto stats = preloader.Stats();
+                Assert::AreEqual((size_t)LOADS, stats.batchesConsumed);
+                Assert::IsTrue(stats.batchesLoaded >= (size_t)LOADS);
+            }
+
+            Assert::AreEqual((size_t)LOADS, delivered.size());
+            Assert::IsTrue(*delivered.rbegin() < loader.counter);
+        }
+    };
+}
@@ -0,0 +1,152 @@
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(MemoryTests)
+    {
+        TEST_METHOD(ImageCache_EvictsLeastRecentlyUsed)
+        {
+            ImageCache cache;
+            cache.SetCapacity(300);
+            Assert::IsTrue(cache.IsEnabled());
+
+            cache.Put("a", 10, 10, CreateImage(100));
+            cache.Put("b", 10, 10, CreateImage(100));
+            cache.Put("c", 10, 10, CreateImage(100));
+            // touching first image makes second one least recently used
+            Assert::IsTrue(cache.Get("a", 10, 10) != nullptr);
+            cache.Put("d", 10, 10, CreateImage(100));
+
+            Assert::IsTrue(cache.Get("b", 10, 10) == nullptr);
+            Assert::IsTrue(cache.Get("a", 10, 10) != nullptr);
+            Assert::IsTrue(cache.Get("c", 10, 10) != nullptr);
+            Assert::IsTrue(cache.Get("d", 10, 10) != nullptr);
+            // same file resized to different size is a separate entry
+            Assert::IsTrue(cache.Get("d", 20, 20) == nullptr);
+
+            Assert::AreEqual((size_t)4, cache.Hits());
+            Assert::AreEqual((size_t)2, cache.Misses());
+            Assert::AreEqual((size_t)300, cache.SizeInBytes());
+
+            // shrinking evicts least recently used entries first
+            cache.SetCapacity(150);
+            Assert::AreEqual((size_t)100, cache.SizeInBytes());
+            Assert::IsTrue(cache.Get("d", 10, 10) != nullptr);
+            Assert::IsTrue(cache.Get("a", 10, 10) == nullptr);
+
+            // images which don't fit at all are not cached
+            cache.Put("e", 10, 10, CreateImage(200));
+            Assert::IsTrue(cache.Get("e", 10, 10) == nullptr);
+        }
+
+        TEST_METHOD(ScratchArena_SpillToNextBlockAndReuse)
+        {
+            ScratchArena::SetBlockSize(256 * sizeof(float));
+            {
+                ScratchArena arena;
+                float* first = arena.Allocate(200);
+                size_t mark = arena.Mark();
+
+                // doesn't fit into remaining part of the first block
+                float* spilled = arena.Allocate(100);
+                Assert::IsTrue(spilled < first || spilled >= first + 256);
+                Assert::AreEqual(256 + 112, (int)arena.Mark());
+
+                arena.Release(mark);
+                Assert::AreEqual((size_t)208 * sizeof(float), arena.UsedSizeInBytes());
+
+                // second block is kept after rewinding
+                Assert::IsTrue(spilled == arena.Allocate(100));
+                arena.Release(0);
+                Assert::IsTrue(first == arena.Allocate(200));
+                arena.Release(0);
+            }
+            ScratchArena::SetBlockSize(4 * 1024 * 1024);
+        }
+
+        TEST_METHOD(ScratchArena_LargerRequestReplacesFollowingBlocks)
+        {
+            ScratchArena::SetBlockSize(256 * sizeof(float));
+            {
+                ScratchArena arena;
+                float* first = arena.Allocate(200);
+                size_t mark = arena.Mark();
+                arena.Allocate(100);
+                arena.Release(mark);
+
+                // second block is too small so it is replaced with one large enough
+                float* large = arena.Allocate(1000);
+                Assert::AreEqual(256 + 1008, (int)arena.Mark());
+
+                for (int i = 0; i < 200; ++i)
+                    first[i] = 1.f;
+                for (int i = 0; i < 1000; ++i)
+                    large[i] = 2.f;
+                for (int i = 0; i < 200; ++i)
+                    Assert::AreEqual(1.f, first[i]);
+
+                arena.Release(256);
+                Assert::IsTrue(large == arena.Allocate(1000));
+                arena.Release(0);
+            }
+            ScratchArena::SetBlockSize(4 * 1024 * 1024);
+        }
+
+        TEST_METHOD(ScratchScope_Nested)
+        {
+            auto& arena = ScratchArena::Local();
+            size_t initialMark = arena.Mark();
+            {
+                ScratchScope outer;
+                float* outerData = outer.Allocate(10);
+                size_t outerMark = arena.Mark();
+                Assert::AreEqual(initialMark + 16, outerMark);
+
+                float* innerData;
+                {
+                    ScratchScope inner;
+                    innerData = inner.Allocate(20);
+                    Assert::IsTrue(innerData >= outerData + 10);
+                    // allocations in outer scope made while inner one is alive are released with inner one
+                    outer.Allocate(5);
+                    Assert::AreEqual(outerMark + 32 + 16, arena.Mark());
+                }
+
+                Assert::AreEqual(outerMark, arena.Mark());
+                Assert::IsTrue(innerData == outer.Allocate(20));
+            }
+            Assert::AreEqual(initialMark, arena.Mark());
+        }
+
+        TEST_METHOD(ScratchArena_PeakReporting)
+        {
+            ScratchArena arena;
+            Assert::AreEqual((size_t)0, arena.PeakSizeInBytes());
+
+            arena.Allocate(30);
+            size_t mark = arena.Mark();
+            arena.Allocate(100);
+            arena.Release(mark);
+            arena.Allocate(50);
+
+            // peak isn't lowered by releasing memory, allocation sizes are rounded up to alignment
+            Assert::AreEqual((size_t)(32 + 112) * sizeof(float), arena.PeakSizeInBytes());
+            Assert::IsTrue(ScratchArena::GlobalPeakSizeInBytes() >= arena.PeakSizeInBytes());
+
+            arena.Release(0);
+            Assert::AreEqual((size_t)0, arena.UsedSizeInBytes());
+            Assert::AreEqual((size_t)(32 + 112) * sizeof(float), arena.PeakSizeInBytes());
+        }
+
+        shared_ptr<const CachedImage> CreateImage(size_t size)
+        {
+            auto image = make_shared<CachedImage>();
+            image->pixels.resize(size);
+            return image;
+        }
+    };
+}
@@ -23,6 +23,125 @@ namespace NeuroTests
             TestDenseNetwork(2, 50, -1, 200);
         }
 
+        TEST_METHOD(NativeWeights_SaveLoad)
+        {
+            auto model = new Sequential("native_weights_test", 7);
+            model->AddLayer(new Dense(2, 3));
+            model->AddLayer(new Dense(4));
+            Graph::Default()->InitVariables();
+            model->SaveWeights("native_weights_test.nw");
+
+            auto model2 = new Sequential("native_weights_test2", 8);
+            model2->AddLayer(new Dense(2, 3));
+            model2->AddLayer(new Dense(4));
+            model2->LoadWeights("native_weights_test.nw", false);
+
+            vector<Variable*> params, params2;
+            model->Parameters(params);
+            model2->Parameters(params2);
+
+            Assert::AreEqual(params.size(), params2.size());
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                Assert::IsTrue(params2[i]->Output().IsAlias());
+                Assert::IsTrue(params[i]->Output().Equals(params2[i]->Output()));
+            }
+        }
+
+        TEST_METHOD(WeightsCached_LoadTwice)
+        {
+            auto model = new Sequential("cached_weights_test", 7);
+            model->AddLayer(new Dense(2, 3, nullptr, "cached_a"));
+            model->AddLayer(new Dense(4, nullptr, "cached_b"));
+            Graph::Default()->InitVariables();
+            model->SaveWeights("cached_weights_test.h5");
+            remove("cached_weights_test.h5.nw");
+
+            vector<Variable*> params;
+            model->Parameters(params);
+
+            // first load creates native copy which is used by the second one, both with default arguments
+            for (int i = 0; i < 2; ++i)
+            {
+                auto model2 = new Sequential("cached_weights_test" + to_string(i + 2), 8 + i);
+                model2->AddLayer(new Dense(2, 3, nullptr, "cached_a"));
+                model2->AddLayer(new Dense(4, nullptr, "cached_b"));
+                model2->LoadWeightsCached("cached_weights_test.h5");
+
+                vector<Variable*> params2;
+                model2->Parameters(params2);
+
+                Assert::AreEqual(params.size(), params2.size());
+                for (size_t p = 0; p < params.size(); ++p)
+                {
+                    Assert::AreEqual(i == 1, params2[p]->Output().IsAlias());
+                    Assert::IsTrue(params[p]->Output().Equals(params2[p]->Output()));
+                }
+            }
+        }
+
+        TEST_METHOD(Weights_LoadTruncated)
+        {
+            auto model = new Sequential("truncated_weights_test", 7);
+            model->AddLayer(new Dense(2, 3, nullptr, "layer_a"));
+            model->AddLayer(new Dense(4, nullptr, "layer_b"));
+            model->AddLayer(new Dense(5, nullptr, "layer_c"));
+            Graph::Default()->InitVariables();
+            model->SaveWeights("truncated_weights_test.h5");
+
+            // only leading layers are present in the model
+            auto model2 = new Sequential("truncated_weights_test2", 8);
+            model2->AddLayer(new Dense(2, 3, nullptr, "layer_a"));
+            model2->AddLayer(new Dense(4, nullptr, "layer_b"));
+            model2->LoadWeights("truncated_weights_test.h5", false);
+
+            vector<Variable*> params, params2;
+            model->Parameters(params);
+            model2->Parameters(params2);
+
+            Assert::AreEqual((size_t)4, params2.size());
+            for (size_t i = 0; i < params2.size(); ++i)
+                Assert::IsTrue(params[i]->Output().Equals(params2[i]->Output()));
+        }
+
+        TEST_METHOD(Checkpoint_SaveLoad)
+        {
+            Tensor input({ 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f }, Shape(3, 1, 1, 2));
+            Tensor output({ 1, 0, 0, 1 }, Shape(2, 1, 1, 2));
+
+            auto model = CreateCheckpointTestNet(7);
+            model->TrainOnBatch(input, output);
+            model->SaveCheckpoint("checkpoint_test.ckpt");
+            model->TrainOnBatch(input, output);
+            // second checkpoint has to replace the first one
+            model->SaveCheckpoint("checkpoint_test.ckpt");
+            Assert::IsTrue(model->WaitForCheckpoint());
+
+            auto model2 = CreateCheckpointTestNet(8);
+            model2->LoadCheckpoint("checkpoint_test.ckpt");
+
+            // identical update is only possible when Adam moments were restored as well
+            model->TrainOnBatch(input, output);
+            model2->TrainOnBatch(input, output);
+
+            vector<Variable*> params, params2;
+            model->Parameters(params);
+            model2->Parameters(params2);
+
+            Assert::AreEqual(params.size(), params2.size());
+            for (size_t i = 0; i < params.size(); ++i)
+                Assert::IsTrue(params[i]->Output().Equals(params2[i]->Output()));
+        }
+
+        ModelBase* CreateCheckpointTestNet(int seed)
+        {
+            // parameters names have to match for optimizer state to be restored
+            auto model = new Sequential("checkpoint_test", seed);
+            model->AddLayer(new Dense(3, 2, nullptr, "checkpoint_dense"));
+            model->Optimize(new Adam(), new MeanSquareError());
+            return model;
+        }
+
         ModelBase* CreateFitTestNet()
         {
             auto model = new Sequential("fit_test", 7);
@@ -1105,6 +1105,38 @@ namespace NeuroTests
             Assert::IsTrue(result.Equals(correct));
         }
 
+        TEST_METHOD(Alias)
+        {
+            Tensor::SetDefaultOpMode(EOpMode::CPU);
+
+            auto t = Tensor(Shape(2, 2, 1, 4)); t.FillWithRange(1);
+            Tensor result;
+            result.Alias(t, 1, 2);
+            auto correct = Tensor(Shape(2, 2, 1, 2)); correct.FillWithRange(5);
+
+            Assert::IsTrue(result.IsAlias());
+            Assert::IsTrue(result.Values() == t.Values() + 4);
+            Assert::IsTrue(result.Equals(correct));
+
+            result.ReleaseData();
+            Assert::IsFalse(result.IsAlias());
+            Assert::IsTrue(t.Equals(Tensor(t.GetShape()).FillWithRange(1)));
+        }
+
+        TEST_METHOD(HostOnly)
+        {
+            Tensor::SetDefaultOpMode(EOpMode::CPU);
+
+            auto t = Tensor(Shape(2, 2, 1, 2), "", ST_HostOnly); t.FillWithRange(1);
+            t.CopyToDevice();
+            Assert::IsFalse(t.IsOnDevice());
+
+            auto copy = t;
+            copy.CopyToDevice();
+            Assert::IsFalse(copy.IsOnDevice());
+            Assert::IsTrue(copy.Equals(Tensor(t.GetShape()).FillWithRange(1)));
+        }
+
         TEST_METHOD(Merge_Into_Batch)
         {
             Tensor::SetDefaultOpMode(EOpMode::CPU);
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <experimental/filesystem>
+#include <fstream>
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(ToolsTests)
+    {
+        TEST_METHOD(LoadFilesList_SkipsInvalidFiles)
+        {
+            const string dir = "test_files_list";
+            std::experimental::filesystem::create_directories(dir);
+            remove((dir + "_cache").c_str());
+
+            Tensor image(Shape(8, 8, 3));
+            image.FillWithRange(0, 1);
+            image.SaveAsImage(dir + "/valid.png", false);
+            {
+                ofstream file(dir + "/invalid.png");
+                file << "not an image";
+            }
+
+            // state of files is unknown until validated so all of them are listed
+            Assert::AreEqual((size_t)2, LoadFilesList(dir, false, false, false).size());
+
+            auto files = LoadFilesList(dir, false, true, true);
+            Assert::AreEqual((size_t)1, files.size());
+            Assert::IsTrue(files[0].find("valid.png") != string::npos && files[0].find("invalid.png") == string::npos);
+
+            // once file is known to be invalid it is skipped even when not validating
+            files = LoadFilesList(dir, false, true, false);
+            Assert::AreEqual((size_t)1, files.size());
+            Assert::IsTrue(files[0].find("invalid.png") == string::npos);
+        }
+
+        TEST_METHOD(LoadFilesList_RebuildsDamagedCache)
+        {
+            const string dir = "test_files_list_damaged";
+            std::experimental::filesystem::create_directories(dir);
+
+            Tensor image(Shape(8, 8, 3));
+            image.FillWithRange(0, 1);
+            image.SaveAsImage(dir + "/valid.png", false);
+            {
+                // entry with empty fields as if cache was truncated
+                ofstream file(dir + "_cache");
+                file << "NEUROFLC 1\n" << dir << "/valid.png\t\t\t\t\t\t\n";
+            }
+
+            auto files = LoadFilesList(dir, false, true, true);
+            Assert::AreEqual((size_t)1, files.size());
+            Assert::IsTrue(files[0].find("valid.png") != string::npos);
+        }
+
+        TEST_METHOD(ResampleImage_ConstantImageStaysConstant)
+        {
+            // rows are padded to check pitch is respected
+            const uint32_t srcWidth = 13, srcHeight = 9, srcPitch = 40;
+            const uint32_t dstWidth = 29, dstHeight = 5, dstPitch = 88;
+            vector<uint8_t> src(srcPitch * srcHeight, 77);
+
+            for (auto filter : { RF_Bilinear, RF_Bicubic, RF_Lanczos3 })
+            for (auto multiThreaded : { false, true })
+            {
+                vector<uint8_t> dst(dstPitch * dstHeight, 0);
+                ResampleImage(&src[0], srcWidth, srcHeight, srcPitch, &dst[0], dstWidth, dstHeight, dstPitch, 3, filter, multiThreaded);
+
+                for (uint32_t h = 0; h < dstHeight; ++h)
+                for (uint32_t i = 0; i < dstWidth * 3; ++i)
+                    Assert::AreEqual((uint8_t)77, dst[h * dstPitch + i]);
+            }
+        }
+
+        TEST_METHOD(ResampleImage_SameSizeIsIdentity)
+        {
+            const uint32_t width = 7, height = 6, channels = 4;
+            vector<uint8_t> src(width * height * channels);
+            for (size_t i = 0; i < src.size(); ++i)
+                src[i] = (uint8_t)(i * 37 % 256);
+
+            for (auto filter : { RF_Bilinear, RF_Bicubic, RF_Lanczos3 })
+            for (auto multiThreaded : { false, true })
+            {
+                vector<uint8_t> dst(src.size());
+                ResampleImage(&src[0], width, height, width * channels, &dst[0], width, height, width * channels, channels, filter, multiThreaded);
+                Assert::IsTrue(src == dst);
+            }
+        }
+
+        TEST_METHOD(CannyEdgeDetection_StepEdge)
+        {
+            const uint32_t width = 16, height = 12, stepX = 8;
+
+            for (uint32_t depth : { 1u, 3u })
+            {
+                // vertical step edge, left half is black and right half is white in all channels
+                Tensor img(Shape(width, height, depth));
+                for (uint32_t d = 0; d < depth; ++d)
+                for (uint32_t h = 0; h < height; ++h)
+                for (uint32_t w = 0; w < width; ++w)
+                    img(w, h, d) = w >= stepX ? 255.f : 0.f;
+
+                Tensor edges = CannyEdgeDetection(img);
+                Assert::IsTrue(edges.GetShape() == Shape(width, height, 1));
+
+                for (uint32_t h = 0; h < height; ++h)
+                {
+                    uint32_t edgePixels = 0;
+                    for (uint32_t w = 0; w < width; ++w)
+                    {
+                        float value = edges(w, h);
+                        Assert::IsTrue(value == 0.f || value == 255.f);
+                        if (value == 0.f)
+                            continue;
+
+                        // edge can only be found on either side of the step
+                        Assert::IsTrue(w == stepX - 1 || w == stepX);
+                        ++edgePixels;
+                    }
+
+                    // border pixels are suppressed, otherwise edge has to be continuous along the whole step
+                    if (h == 0 || h == height - 1)
+                        Assert::AreEqual(0u, edgePixels);
+                    else
+                        Assert::IsTrue(edgePixels > 0);
+                }
+            }
+        }
+    };
+}
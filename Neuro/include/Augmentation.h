@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "DataPreloader.h"
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+    class Random;
+
+    // Random image augmentations of NCHW samples. Output size is given by destination tensor, when it is smaller than source image a crop
+    // is taken. All enabled transforms are fused into a single pass over output pixels: geometric ones (crop, scale jitter and flips) only
+    // select source pixels while color ones are applied to every output pixel of images with 3 channels. Color jitter expects pixel values
+    // in [0, 255] range so normalization should be done by augmentation as well.
+    class Augmentation
+    {
+    public:
+        // Crop is taken at random position, otherwise it is centered
+        Augmentation& RandomCrop(bool enabled = true) { m_RandomCrop = enabled; return *this; }
+        // Source region is scaled by random factor from given range before cropping (factor greater than 1 zooms in)
+        Augmentation& ScaleJitter(float minScale, float maxScale) { m_MinScale = minScale; m_MaxScale = maxScale; return *this; }
+        Augmentation& FlipHorizontally(float probability = 0.5f) { m_FlipXProbability = probability; return *this; }
+        Augmentation& FlipVertically(float probability = 0.5f) { m_FlipYProbability = probability; return *this; }
+        // Factors are picked randomly from [1 - x, 1 + x] ranges
+        Augmentation& ColorJitter(float brightness, float contrast, float saturation) { m_Brightness = brightness; m_Contrast = contrast; m_Saturation = saturation; return *this; }
+        // Applied to output values after all other transforms: value * scale + offset
+        Augmentation& Normalize(float scale, float offset) { m_NormScale = scale; m_NormOffset = offset; return *this; }
+
+        // Augments every sample of source into the same batch of destination, samples are processed in parallel. Corresponding samples of
+        // all tensors receive the same geometric transform (so pairs of images stay aligned), color jitter is picked for each of them separately.
+        void Apply(const vector<const Tensor*>& sources, const vector<Tensor*>& destinations, Random& rng) const;
+        void Apply(const Tensor& source, Tensor& destination, Random& rng) const;
+
+    private:
+        struct Geometry
+        {
+            float regionX, regionY, regionWidth, regionHeight;
+            bool flipX, flipY;
+        };
+
+        struct ColorTransform
+        {
+            float a, b, c; // out = a * value + b * gray + c
+        };
+
+        Geometry SampleGeometry(Random& rng, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight) const;
+        ColorTransform SampleColor(Random& rng) const;
+        void ApplySample(const Geometry& geometry, const ColorTransform* color, const float* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t channels, float* dst, uint32_t dstWidth, uint32_t dstHeight) const;
+
+        bool m_RandomCrop = false;
+        float m_MinScale = 1.f;
+        float m_MaxScale = 1.f;
+        float m_FlipXProbability = 0.f;
+        float m_FlipYProbability = 0.f;
+        float m_Brightness = 0.f;
+        float m_Contrast = 0.f;
+        float m_Saturation = 0.f;
+        float m_NormScale = 1.f;
+        float m_NormOffset = 0.f;
+    };
+
+    // Loads batches with wrapped loader into internal tensors and augments them into destination. It is meant to be used with DataPreloader
+    // so augmentation is done by its workers. Every batch uses its own random stream derived from seed and batch sequence number, so
+    // augmentations don't depend on which worker loaded given batch.
+    class AugmentingLoader : public ILoader
+    {
+    public:
+        // Source shapes describe tensors loaded by wrapped loader (before augmentation)
+        AugmentingLoader(ILoader& loader, const vector<Shape>& sourceShapes, const Augmentation& augmentation, uint32_t seed = 0);
+        ~AugmentingLoader();
+
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+
+    private:
+        ILoader& m_Loader;
+        vector<Shape> m_SourceShapes;
+        Augmentation m_Augmentation;
+        uint32_t m_Seed;
+        atomic<uint32_t> m_BatchIdx{ 0 };
+
+        mutex m_BuffersMtx;
+        vector<vector<Tensor>*> m_FreeBuffers; // source tensors reused between batches
+    };
+}
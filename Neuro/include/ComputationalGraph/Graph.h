@@ -1,7 +1,12 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <vector>
 #include <unordered_set>
+#include <functional>
+#include <string>
+
+#include "Tensors/Tensor.h"
 
 namespace Neuro
 {
@@ -12,6 +17,53 @@ namespace Neuro
     class Operation;
     class Variable;
     class Constant;
+    class Profiler;
+
+    enum EGraphOptimization
+    {
+        GO_ConstantFolding = 1 << 0,
+        GO_CommonSubexpressionElimination = 1 << 1,
+        GO_DeadNodeElimination = 1 << 2,
+        GO_ElementwiseFusion = 1 << 3,
+        GO_All = GO_ConstantFolding | GO_CommonSubexpressionElimination | GO_DeadNodeElimination | GO_ElementwiseFusion,
+    };
+
+    struct GraphOptimizationReport
+    {
+        vector<pair<string, string>> folded; // operation name, constant replacing it
+        vector<pair<string, string>> merged; // operation name, identical operation replacing it
+        vector<string> removed; // operations left without consumers by other passes
+        vector<pair<string, string>> fused; // operation name, fused elementwise operation replacing it
+
+        string ToString() const;
+    };
+
+    // Backward pass compiled for given losses and parameters, it can be executed repeatedly without rebuilding any bookkeeping
+    // data. Plan is recompiled automatically whenever graph structure or trainability of any variable changes.
+    struct GradientsPlan
+    {
+        vector<TensorLike*> losses;
+        vector<Variable*> params;
+
+        vector<TensorLike*> nodes; // nodes caring about gradient in backward order
+        vector<bool> is_loss;
+        vector<vector<const Tensor*>> consumers_grads; // input gradients of consumers contributing to node's output gradient
+        vector<int> variable_idx; // index in variables or -1 for non-trainable nodes
+        vector<Variable*> variables; // trainable variables which gradients are computed
+        vector<vector<size_t>> waves; // groups of independent nodes (indices) for concurrent computation
+        vector<vector<Tensor>> partial_grads; // per node buffers for partial sums of consumers gradients when summed concurrently
+        bool has_gpu_ops = false;
+        uint32_t graph_version = UINT32_MAX;
+        uint32_t trainability_version = UINT32_MAX;
+    };
+
+    // Nodes recreated from serialized graph, order is a ready to use forward order for all outputs
+    struct LoadedGraph
+    {
+        vector<Placeholder*> inputs;
+        vector<TensorLike*> outputs;
+        vector<TensorLike*> order;
+    };
 
     class Graph
     {
@@ -40,19 +92,60 @@ namespace Neuro
         size_t PreloadSteps() const { return m_PreloadSteps; }
         void PreloadSteps(size_t steps) { m_PreloadSteps = steps; }
 
+        // When enabled, independent parts of backward pass will be computed concurrently. It only applies to orders without GPU operations
+        // and is disabled by default.
+        bool ConcurrentGradients() const { return m_ConcurrentGradients; }
+        void ConcurrentGradients(bool enabled) { m_ConcurrentGradients = enabled; }
+
+        // Gradient computations are recorded by given profiler, null disables profiling (it is managed by session)
+        Profiler* GetProfiler() const { return m_Profiler; }
+        void SetProfiler(Profiler* profiler) { m_Profiler = profiler; }
+
         // Builds nodes visitation order for forward pass, returns true when order contains training operation
         bool BuildForwardOrder(const vector<TensorLike*>& endNodes, vector<TensorLike*>& order);
         // Builds nodes visitation order for backward/gradients computation pass
         vector<TensorLike*> BuildBackwardOrder(const vector<TensorLike*>& endNodes, unordered_set<TensorLike*>& nodesAffectingEndNodes, const vector<Variable*>& params = {});
 
         vector<Variable*> ComputeGradients(const vector<TensorLike*>& losses, const vector<Variable*>& params);
-        vector<Variable*> ComputeGradientsInOrder(const vector<TensorLike*>& order, const vector<TensorLike*>& losses, const unordered_set<TensorLike*> nodesAffectingLosses, const vector<Variable*>& params);
+        // Optional gradientReady callback is invoked as soon as gradient of given variable (with its index in returned list) is final, it may be called from worker threads
+        const vector<Variable*>& ComputeGradients(GradientsPlan& plan, const function<void(Variable*, size_t)>& gradientReady = nullptr);
+        // Compiles plan when it is out of date, returns trainable variables (in order) for which gradients will be computed
+        const vector<Variable*>& PrepareGradientsPlan(GradientsPlan& plan);
+        bool IsUpToDate(const GradientsPlan& plan) const { return plan.graph_version == m_Version && plan.trainability_version == m_TrainabilityVersion; }
+
+        // Runs optimization passes over part of graph required by given fetches. Only constants are folded so variables can still be loaded,
+        // assigned or unfrozen afterwards. Dead node elimination removes operations left without consumers by other passes, operations
+        // outside of optimized part are never removed. Plans cached by session, trainers, predicters and optimizers are recompiled automatically.
+        GraphOptimizationReport Optimize(const vector<TensorLike*>& fetches, int passes = GO_All);
+        // Incremented every time graph structure is modified by optimization, can be used to invalidate cached orders
+        uint32_t Version() const { return m_Version; }
+        // Invalidates gradients plans since set of nodes caring about gradient might have changed
+        void OnTrainabilityChanged() { ++m_TrainabilityVersion; }
+
+        // Saves nodes required to compute outputs in compact binary format. Nodes are stored in forward order along with their attributes,
+        // output shapes and values of variables and constants, operations are identified by explicit type names. When weights are not saved
+        // variables store their initializers instead and are initialized anew after loading (ones without such initializer keep their values).
+        void Save(const string& filename, const vector<Placeholder*>& inputs, const vector<TensorLike*>& outputs, bool saveWeights = true);
+        // Recreates nodes saved in given file without running the construction code, it has to be called on the default graph
+        LoadedGraph Load(const string& filename);
 
         TensorLike* GetNode(const string& name);
         void DebugLog();
 
     private:
+        void FoldConstants(const vector<TensorLike*>& fetches, GraphOptimizationReport& report);
+        void EliminateCommonSubexpressions(const vector<TensorLike*>& fetches, GraphOptimizationReport& report);
+        void EliminateDeadNodes(const vector<TensorLike*>& fetches, const vector<TensorLike*>& order, GraphOptimizationReport& report);
+        void FuseElementwiseOperations(const vector<TensorLike*>& fetches, GraphOptimizationReport& report);
+        // Redirects all consumers of node to its replacement
+        void ReplaceNode(TensorLike* node, TensorLike* replacement);
+        // Removes operation from graph, it will be kept alive until graph is cleared since it might still be referenced externally
+        void DetachOperation(Operation* op);
+
         void ProcessForwardNode(TensorLike* node, vector<TensorLike*>& nodes, unordered_set<TensorLike*>& visited, bool& is_training);
+        void CompileGradientsPlan(GradientsPlan& plan);
+        void ComputeNodeGradient(GradientsPlan& plan, size_t n, bool concurrent);
+        void ComputeGradientsConcurrently(GradientsPlan& plan, const function<void(Variable*, size_t)>& gradientReady);
         void ProcessBackwardNode(TensorLike* node, vector<TensorLike*>& nodes, const vector<Variable*>& params, bool ignoreConsumersCheck, unordered_set<TensorLike*>& visited, unordered_set<TensorLike*>& visitedParams, const unordered_set<TensorLike*>& required);
 
         vector<Placeholder*> m_Placeholders;
@@ -60,8 +153,14 @@ namespace Neuro
         vector<Variable*> m_Variables;
         vector<Constant*> m_Constants;
         vector<TensorLike*> m_Nodes;
+        vector<TensorLike*> m_DetachedNodes;
         uint32_t m_CurrentStep = 0;
+        uint32_t m_Version = 0;
+        uint32_t m_TrainabilityVersion = 0;
+        size_t m_InitializedVariablesCount = 0;
         size_t m_PreloadSteps = 8;
+        bool m_ConcurrentGradients = false;
+        Profiler* m_Profiler = nullptr;
 
         static Graph* s_Default;
     };
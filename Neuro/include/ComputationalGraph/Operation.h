@@ -1,10 +1,21 @@
 ﻿#pragma once
 
+#include <map>
+#include <ostream>
+
 #include "ComputationalGraph/TensorLike.h"
 
 namespace Neuro
 {
     class Tensor;
+    struct FusedInstruction;
+
+    // State of minimization operation kept between training steps, per variable state (ie. moment estimates) is identified by variable name
+    struct OptimizerState
+    {
+        float iteration = 0;
+        map<string, vector<Tensor>> variables;
+    };
 
     class Operation : public TensorLike
     {
@@ -29,10 +40,25 @@ namespace Neuro
 
         // Existence of training operations in fetched list will cause network to automatically run in training mode
         virtual bool IsTrainingOp() const { return false; }
+        // Minimization operations keeping state between steps expose it so it can be checkpointed, stateless ones return false
+        virtual bool GetOptimizerState(OptimizerState& state) const { return false; }
+        virtual void SetOptimizerState(const OptimizerState& state) {}
 
         virtual bool ShouldPreload() const override { return m_OpMode == GPU; }
         EOpMode OpMode() const { return m_OpMode; }
 
+        // Operations with side effects or random output must not be folded nor merged by graph optimization
+        virtual bool IsDeterministic() const { return true; }
+        // Operations of the same type, with the same inputs and attributes are considered identical
+        virtual void WriteAttributes(ostream& stream) const {}
+        // Elementwise operations (and global reductions) which can be fused with neighboring ones describe themselves as a single instruction
+        virtual bool GetFusedInstruction(FusedInstruction& instruction) const { return false; }
+        // Rough number of floating point operations done by single forward or gradient computation (used by profiler), by default
+        // operation is assumed to be elementwise
+        virtual uint64_t EstimateFlops(bool gradient) const;
+        // Class name without namespace (ie. 'MatMulOp'), it is the same for all compilers
+        string TypeName() const;
+
     protected:
         Operation(const vector<TensorLike*>& inputNodes, const string& name);
 
@@ -52,5 +78,7 @@ namespace Neuro
         bool m_InputsManuallyConsumed = false;
         bool m_CareAboutGradient = false;
         bool m_Training = false;
+
+        friend class Graph;
     };
 }
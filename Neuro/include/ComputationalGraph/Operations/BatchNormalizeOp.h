@@ -9,6 +9,9 @@ namespace Neuro
     public:
         BatchNormalizeOp(TensorLike* x, TensorLike* gamma, TensorLike* beta, TensorLike* runningMean, TensorLike* runningVar, float momentum, float epsilon, const string& name = "");
 
+        virtual bool IsDeterministic() const override { return false; }
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Momentum << " " << m_Epsilon; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
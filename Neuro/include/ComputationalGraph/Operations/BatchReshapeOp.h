@@ -9,6 +9,8 @@ namespace Neuro
     public:
         BatchReshapeOp(TensorLike* x, const Shape& shape, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Shape.ToString(); }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
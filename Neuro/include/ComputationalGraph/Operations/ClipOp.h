@@ -9,6 +9,8 @@ namespace Neuro
     public:
         ClipOp(TensorLike* x, float min, float max, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Min << " " << m_Max; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
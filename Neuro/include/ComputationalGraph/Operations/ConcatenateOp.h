@@ -9,6 +9,8 @@ namespace Neuro
     public:
         ConcatenateOp(const vector<TensorLike*>& xs, EAxis axis = DepthAxis, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Axis; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
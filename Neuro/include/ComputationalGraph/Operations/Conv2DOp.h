@@ -9,6 +9,10 @@ namespace Neuro
     public:
         Conv2dOp(TensorLike* x, TensorLike* kernels, uint32_t stride, uint32_t padding, EDataFormat dataFormat = NCHW, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Stride << " " << m_Padding << " " << m_DataFormat; }
+        // gradient requires both input and kernels gradients of the same size
+        virtual uint64_t EstimateFlops(bool gradient) const override { return (gradient ? 4ull : 2ull) * GetShape().Length * m_Inputs[1]->Width() * m_Inputs[1]->Height() * m_Inputs[1]->Depth(); }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
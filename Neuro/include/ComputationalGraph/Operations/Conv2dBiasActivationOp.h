@@ -9,6 +9,9 @@ namespace Neuro
     public:
         Conv2dBiasActivationOp(TensorLike* x, TensorLike* kernels, uint32_t stride, uint32_t padding, TensorLike* bias, EActivation activation, float activationAlpha, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Stride << " " << m_Padding << " " << m_Activation << " " << m_ActivationAlpha; }
+        virtual uint64_t EstimateFlops(bool gradient) const override { return (gradient ? 4ull : 2ull) * GetShape().Length * (m_Inputs[1]->Width() * m_Inputs[1]->Height() * m_Inputs[1]->Depth() + 1); }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -9,6 +9,10 @@ namespace Neuro
     public:
         Conv2dTransposeOp(TensorLike* x, TensorLike* kernels, uint32_t stride, uint32_t padding, EDataFormat dataFormat = NCHW, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Stride << " " << m_Padding << " " << m_DataFormat; }
+        // every input value is scattered through kernel to all output channels
+        virtual uint64_t EstimateFlops(bool gradient) const override { return (gradient ? 4ull : 2ull) * m_Inputs[0]->Length() * m_Inputs[1]->Width() * m_Inputs[1]->Height() * GetShape().Depth(); }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
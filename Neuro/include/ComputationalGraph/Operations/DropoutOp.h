@@ -9,6 +9,9 @@ namespace Neuro
     public:
         DropoutOp(TensorLike* x, float prob, const string& name = "");
 
+        virtual bool IsDeterministic() const override { return false; }
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Prob; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
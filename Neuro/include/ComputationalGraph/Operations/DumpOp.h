@@ -9,6 +9,8 @@ namespace Neuro
     public:
         DumpOp(TensorLike* x, const string& name = "");
 
+        virtual bool IsDeterministic() const override { return false; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         ExtractSubTensorOp(TensorLike* x, uint32_t width, uint32_t height, uint32_t widthOffset, uint32_t heightOffset, bool clampAllowed = false, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Width << " " << m_Height << " " << m_WidthOffset << " " << m_HeightOffset << " " << m_ClampAllowed; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -10,6 +10,8 @@ namespace Neuro
         FuseSubTensorsOp(const vector<TensorLike*>& xs, size_t tX, size_t tY, const string& name = "");
         FuseSubTensorsOp(const vector<TensorLike*>& xs, size_t tX, size_t tY, const Shape& outputShape, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_TX << " " << m_TY << " " << m_ClampAllowed; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include "ComputationalGraph/Operation.h"
+
+namespace Neuro
+{
+    enum EFusedOp
+    {
+        FO_Add,
+        FO_Sub,
+        FO_Mul,
+        FO_Div,
+        FO_AddScalar,
+        FO_MulScalar,
+        FO_DivScalar,
+        FO_Pow,
+        FO_Neg,
+        FO_Sqrt,
+        FO_Exp,
+        FO_Log,
+        FO_Abs,
+        // reductions are only allowed as the last instruction
+        FO_Sum,
+        FO_Mean,
+    };
+
+    struct FusedInstruction
+    {
+        FusedInstruction(EFusedOp op = FO_Add, float val = 0.f) : op(op), val(val) {}
+
+        bool IsReduction() const { return op == FO_Sum || op == FO_Mean; }
+
+        EFusedOp op;
+        float val;
+        // registers of operands, first registers hold input values followed by results of preceding instructions
+        int a = -1;
+        int b = -1;
+    };
+
+    // Evaluates a tree of elementwise operations (optionally followed by global reduction) in a single sweep over memory without
+    // allocating intermediate tensors. Gradient is computed in a single sweep as well by recomputing intermediate values per element.
+    // Inputs are broadcast along axes of length 1 the same way as in regular elementwise operations, shapes are resolved on every run so
+    // batch size can change. It is created by graph optimization, there is no need to use it directly.
+    class FusedElementwiseOp : public Operation
+    {
+    public:
+        FusedElementwiseOp(const vector<TensorLike*>& inputs, const vector<FusedInstruction>& program, EOpMode opMode, const string& name = "");
+
+        virtual void WriteAttributes(ostream& stream) const override;
+
+    protected:
+        virtual void UpdateOutputShape() override;
+        virtual void ComputeInternal() override;
+        virtual void ComputeGradientInternal(const Tensor& grad) override;
+
+    private:
+        void GatherInputsData();
+        // Evaluates all non-reduction instructions for given element, result is stored in the last used register. Offsets of
+        // elements read from inputs are stored in offsets.
+        void Evaluate(uint32_t e, float* regs, uint32_t* offsets) const;
+        // Propagates adjoint of the last used register to all registers
+        void Backpropagate(const float* regs, float* adjs) const;
+
+        struct InputView
+        {
+            const float* data;
+            bool full; // input matches elements shape so it is indexed directly
+            uint32_t stride[4]; // per axis, zero along broadcast axes
+        };
+
+        vector<FusedInstruction> m_Program;
+        vector<InputView> m_InputsView;
+        Shape m_ElementsShape; // inputs broadcast to common shape
+        size_t m_ElementwiseCount; // number of non-reduction instructions
+        size_t m_RegistersCount;
+    };
+}
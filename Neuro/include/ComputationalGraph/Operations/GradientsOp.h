@@ -4,6 +4,7 @@
 #include <unordered_set>
 
 #include "ComputationalGraph/Operation.h"
+#include "ComputationalGraph/Graph.h"
 
 namespace Neuro
 {
@@ -14,6 +15,8 @@ namespace Neuro
     public:
         GradientsOp(TensorLike* y, const vector<Variable*>& vars, const string& name = "");
 
+        virtual bool IsDeterministic() const override { return false; }
+
         vector<TensorLike*> Grads() { return m_Grads; }
 
         virtual bool IsTrainingOp() const override { return true; }
@@ -25,8 +28,7 @@ namespace Neuro
     private:
         vector<Variable*> m_Vars;
         vector<TensorLike*> m_Grads;
-        vector<TensorLike*> m_Order;
-        unordered_set<TensorLike*> m_NodesAffectingInputNodes;
+        GradientsPlan m_Plan;
     };
 
     static vector<TensorLike*> gradients(TensorLike* y, const vector<Variable*>& vars, const string& name = "")
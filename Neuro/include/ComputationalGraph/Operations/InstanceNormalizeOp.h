@@ -9,6 +9,8 @@ namespace Neuro
     public:
         InstanceNormalizeOp(TensorLike* x, TensorLike* gamma, TensorLike* beta, float epsilon, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Epsilon; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
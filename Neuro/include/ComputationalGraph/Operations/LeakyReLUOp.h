@@ -9,6 +9,8 @@ namespace Neuro
     public:
         LeakyReLUOp(TensorLike* x, float alpha, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Alpha; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
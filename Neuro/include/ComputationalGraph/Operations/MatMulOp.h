@@ -8,6 +8,9 @@ namespace Neuro
     {
     public:
         MatMulOp(TensorLike* a, TensorLike* b, const string& name = "");
+
+        // gradient requires two multiplications of the same size
+        virtual uint64_t EstimateFlops(bool gradient) const override { return (gradient ? 4ull : 2ull) * GetShape().Length * m_Inputs[0]->Width(); }
         
     protected:
         virtual void UpdateOutputShape() override;
@@ -26,6 +29,9 @@ namespace Neuro
     public:
         MatMulTransOp(TensorLike* a, bool transposeA, TensorLike* b, bool transposeB, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_TransposeA << " " << m_TransposeB; }
+        virtual uint64_t EstimateFlops(bool gradient) const override { return (gradient ? 4ull : 2ull) * GetShape().Length * (m_TransposeA ? m_Inputs[0]->Height() : m_Inputs[0]->Width()); }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -42,6 +48,8 @@ namespace Neuro
     public:
         MatMulSyrkOp(TensorLike* a, bool transpose, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Transpose; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -9,6 +9,9 @@ namespace Neuro
     public:
         MeanOp(TensorLike* x, EAxis axis = GlobalAxis, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Axis; }
+        virtual bool GetFusedInstruction(FusedInstruction& instruction) const override;
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         MergeOp(const vector<TensorLike*>& xs, EMergeMode mode, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Mode; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
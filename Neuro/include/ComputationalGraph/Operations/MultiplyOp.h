@@ -10,6 +10,9 @@ namespace Neuro
         MultiplyOp(TensorLike* a, TensorLike* b, const string& name = "");
         MultiplyOp(TensorLike* x, float val, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Val; }
+        virtual bool GetFusedInstruction(FusedInstruction& instruction) const override;
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
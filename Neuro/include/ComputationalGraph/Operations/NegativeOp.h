@@ -9,6 +9,8 @@ namespace Neuro
     public:
         NegativeOp(TensorLike* x, const string& name = "");
 
+        virtual bool GetFusedInstruction(FusedInstruction& instruction) const override;
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         NormalizeGradientOp(TensorLike* x, size_t order = 1, float scale = 1.f, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Order << " " << m_Scale; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
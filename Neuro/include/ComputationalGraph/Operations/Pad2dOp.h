@@ -9,6 +9,8 @@ namespace Neuro
     public:
         Pad2dOp(TensorLike* x, uint32_t left, uint32_t right, uint32_t top, uint32_t bottom, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Left << " " << m_Right << " " << m_Top << " " << m_Bottom; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -24,6 +26,8 @@ namespace Neuro
     public:
         ConstantPad2dOp(TensorLike* x, uint32_t left, uint32_t right, uint32_t top, uint32_t bottom, float value, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { __super::WriteAttributes(stream); stream << " " << m_Value; }
+
     protected:
         virtual void ComputeInternal() override;
 
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         Pool2dOp(TensorLike* x, uint32_t filterSize, uint32_t stride, uint32_t padding, EPoolingMode mode, EDataFormat dataFormat, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_FilterSize << " " << m_Stride << " " << m_Padding << " " << m_Mode << " " << m_DataFormat; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
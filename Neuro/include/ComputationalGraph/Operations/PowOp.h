@@ -11,6 +11,9 @@ namespace Neuro
         PowOp(TensorLike* x, TensorLike* p, const string& name = "");
         PowOp(TensorLike* x, float p, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Power; }
+        virtual bool GetFusedInstruction(FusedInstruction& instruction) const override;
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -10,6 +10,8 @@ namespace Neuro
         RollOp(TensorLike* x, int rollX, int rollY, const string& name = "");
         RollOp(TensorLike* x, TensorLike* rollX, TensorLike* rollY, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_RollX << " " << m_RollY; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -35,6 +37,9 @@ namespace Neuro
     public:
         RandomRollOp(TensorLike* x, uint32_t jitterScale = 1, const string& name = "");
 
+        virtual bool IsDeterministic() const override { return false; }
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_JitterScale; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         SubTensor2dOp(TensorLike* x, uint32_t width, uint32_t height, uint32_t widthOffset, uint32_t heightOffset, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Width << " " << m_Height << " " << m_WidthOffset << " " << m_HeightOffset; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         SubtractOp(TensorLike* a, TensorLike* b, const string& name = "");
 
+        virtual bool GetFusedInstruction(FusedInstruction& instruction) const override;
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
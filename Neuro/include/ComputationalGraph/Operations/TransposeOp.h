@@ -9,6 +9,8 @@ namespace Neuro
     public:
         TransposeOp(TensorLike* x, const vector<EAxis>& axes, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { for (auto axis : m_Permutation) stream << axis << " "; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
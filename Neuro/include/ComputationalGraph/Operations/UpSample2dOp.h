@@ -9,6 +9,8 @@ namespace Neuro
     public:
         UpSample2dOp(TensorLike* x, int scaleFactor, const string& name = "");
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_ScaleFactor; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -12,5 +12,14 @@ namespace Neuro
         explicit Placeholder(const Tensor& defaultVal, const string& name = "");
 
         virtual bool IsPlaceholder() const override { return true; }
+
+        // Makes output alias fed tensor without copying it, placeholder's own value is kept aside and restored when feed is released
+        void BindFeed(const Tensor& feed);
+        void ReleaseFeed();
+        bool IsFeedBound() const { return m_FeedBound; }
+
+    private:
+        Tensor m_OwnValue;
+        bool m_FeedBound = false;
     };
 }
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include "Types.h"
+#include "ComputationalGraph/Session.h"
 
 namespace Neuro
 {
@@ -13,7 +14,8 @@ namespace Neuro
     class Predicter
     {
     public:
-        Predicter(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps);
+        // When forward order is known in advance (ie. restored along with serialized graph) it is used instead of building one
+        Predicter(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps, const vector<TensorLike*>& forwardOrder = {});
 
         tensor_ptr_vec_t Predict(const const_tensor_ptr_vec_t& inputs);
         tensor_ptr_vec_t Eval(const map<Placeholder*, const Tensor*>& feeds);
@@ -23,6 +25,6 @@ namespace Neuro
         vector<TensorLike*> m_OutputOps;
         map<Placeholder*, const Tensor*> m_Feeds;
 
-        vector<TensorLike*> m_Order;
+        ExecutionPlan m_Plan;
     };
 }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Operation;
+    class Tensor;
+
+    struct ProfilerEvent
+    {
+        string name;
+        string opType;
+        string layer; // name scope operation was created in, empty for operations created outside of any scope
+        bool gradient;
+        int64_t start; // microseconds since profiler was created or cleared
+        int64_t duration; // microseconds
+        uint32_t thread;
+        vector<Shape> inputShapes;
+        Shape outputShape;
+        uint64_t flops;
+        uint64_t bytes;
+    };
+
+    struct ProfilerStats
+    {
+        size_t forwardCount = 0;
+        size_t gradientCount = 0;
+        int64_t forwardTime = 0; // microseconds
+        int64_t gradientTime = 0; // microseconds
+        uint64_t flops = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Records forward and gradient computation of operations run by session it belongs to. Wall time is measured on calling thread,
+    // in case of GPU operations it only includes time spent on queuing work as kernels are asynchronous. FLOPs are estimated by
+    // operations, moved bytes are estimated from sizes of inputs, outputs and their gradients. Events can be aggregated per operation
+    // type and per layer or exported in Chrome trace event format (viewable in chrome://tracing or Perfetto).
+    class Profiler
+    {
+    public:
+        Profiler();
+
+        void Compute(Operation* op, bool training);
+        void ComputeGradient(Operation* op, const Tensor& grad);
+
+        const vector<ProfilerEvent>& Events() const { return m_Events; }
+        map<string, ProfilerStats> StatsPerOpType() const;
+        map<string, ProfilerStats> StatsPerLayer() const;
+        // Tables of operation types and layers sorted by total time
+        string Summary(size_t maxRows = 20) const;
+        void SaveChromeTrace(const string& filename) const;
+        void Clear();
+
+    private:
+        void Record(Operation* op, bool gradient, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end);
+
+        mutable mutex m_Mtx;
+        vector<ProfilerEvent> m_Events;
+        chrono::steady_clock::time_point m_Origin;
+    };
+}
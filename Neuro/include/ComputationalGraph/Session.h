@@ -1,8 +1,11 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <vector>
 #include <map>
 
+#include "ComputationalGraph/Profiler.h"
+
 namespace Neuro
 {
     using namespace std;
@@ -14,28 +17,68 @@ namespace Neuro
     class Variable;
     class Graph;
 
+    // Forward pass compiled for given fetches, it can be executed repeatedly without rebuilding any bookkeeping data.
+    // Plan is recompiled automatically whenever graph structure changes.
+    struct ExecutionPlan
+    {
+        struct Step
+        {
+            TensorLike* node;
+            Operation* op; // null for non-operation nodes
+            bool fetched;
+        };
+
+        vector<TensorLike*> fetches;
+        vector<Step> steps;
+        vector<Tensor*> results;
+        bool is_training = false;
+        uint32_t graph_version = UINT32_MAX;
+    };
+
     class Session
     {
     public:
         Session(Graph* graph = nullptr);
+        ~Session();
 
         static Session* Default();
         static size_t GetFetchesHash(const vector<TensorLike*>& fetches);
 
         vector<Tensor*> Run(const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds = {});
-        vector<Tensor*> RunInOrder(const vector<TensorLike*>& order, const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds, bool training);
+        // Compiles plan for given fetches, it is not required to call it before running plan
+        void Compile(const vector<TensorLike*>& fetches, ExecutionPlan& plan) const;
+        // Compiles plan using already known forward order (ie. restored along with serialized graph) instead of building it
+        void Compile(const vector<TensorLike*>& fetches, const vector<TensorLike*>& order, ExecutionPlan& plan) const;
+        const vector<Tensor*>& RunPlan(ExecutionPlan& plan, const map<Placeholder*, const Tensor*>& feeds = {});
+
+        // When enabled, placeholders are bound to fed tensors for the duration of a run instead of copying their values.
+        // Fed tensors must not be modified during the run, placeholders get their own values back once the run is over.
+        bool ZeroCopyFeeds() const { return m_ZeroCopyFeeds; }
+        void ZeroCopyFeeds(bool enabled) { m_ZeroCopyFeeds = enabled; }
+
+        // When enabled, every operation computed by this session (including gradients computed by its graph during a run) is recorded
+        // by profiler. Disabled profiling costs a single branch per computed node, recorded events are kept until profiler is cleared.
+        bool Profiling() const { return m_Profiling; }
+        void Profiling(bool enabled) { m_Profiling = enabled; }
+        Profiler& GetProfiler() { return m_Profiler; }
+
+        // When enabled, part of graph required by fetches is optimized (see Graph::Optimize) every time plan is compiled without known order.
+        // Optimization modifies graph shared by all sessions so it is disabled by default.
+        bool OptimizeGraph() const { return m_OptimizeGraph; }
+        void OptimizeGraph(bool enabled) { m_OptimizeGraph = enabled; }
 
         void Clear();
 
     private:
         Graph* m_Graph;
 
-        struct OrderCacheData
-        {
-            vector<TensorLike*> order;
-            bool is_training;
-        };
-        map<size_t, OrderCacheData> m_OrderCache;
+        void DebugLogOutputs(const ExecutionPlan::Step& step) const;
+
+        map<size_t, ExecutionPlan> m_PlanCache;
+        bool m_ZeroCopyFeeds = true;
+        bool m_Profiling = false;
+        bool m_OptimizeGraph = false;
+        Profiler m_Profiler;
 
         static Session* s_Default;
     };
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include "Types.h"
+#include "ComputationalGraph/Session.h"
 
 namespace Neuro
 {
@@ -23,6 +24,6 @@ namespace Neuro
         vector<TensorLike*> m_FetchOps;
         map<Placeholder*, const Tensor*> m_Feeds;
 
-        vector<TensorLike*> m_Order;
+        ExecutionPlan m_Plan;
     };
 }
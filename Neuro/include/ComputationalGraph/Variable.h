@@ -23,6 +23,7 @@ namespace Neuro
 
         void Initialize();
         void ForceInitialized() { m_Initialized = true; }
+        const InitializerBase* Initializer() const { return m_Initializer; }
 
         virtual bool CareAboutGradient() const override;
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DataPreloader.h"
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+    class MappedFile;
+
+    // Every non-empty line is a sample with comma separated input values followed by outputs. When outputs are one-hot encoded there is
+    // a single class index column which is expanded to outputsNum values. File is memory-mapped and split into chunks at line boundaries,
+    // chunks are parsed in parallel straight into tensors' memory.
+    void LoadCSVData(const string& filename, int outputsNum, Tensor& inputs, Tensor& outputs, bool outputsOneHotEncoded = false, int maxLines = -1);
+
+    // Streams consecutive batches of samples from CSV file (in the same format as LoadCSVData) so files larger than memory can be used
+    // for training. First tensor receives inputs and second one outputs, reading starts over from the beginning once end of file is reached.
+    class CsvLoader : public ILoader
+    {
+    public:
+        CsvLoader(const string& filename, int outputsNum, uint32_t batchSize, bool outputsOneHotEncoded = false);
+        ~CsvLoader();
+
+        CsvLoader(const CsvLoader&) = delete;
+        CsvLoader& operator=(const CsvLoader&) = delete;
+
+        bool IsValid() const;
+        Shape InputShape() const { return Shape(m_InputsNum, 1, 1, m_BatchSize); }
+        Shape OutputShape() const { return Shape(m_OutputsNum, 1, 1, m_BatchSize); }
+
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+
+    private:
+        const MappedFile* m_File = nullptr;
+        uint32_t m_InputsNum = 0;
+        uint32_t m_OutputsNum;
+        uint32_t m_BatchSize;
+        bool m_OneHot;
+        size_t m_Position = 0; // offset of the first line of next batch
+        mutex m_PositionMtx;
+    };
+}
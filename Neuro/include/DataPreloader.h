@@ -1,47 +1,75 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <vector>
-#include <list>
+#include <string>
 
 namespace Neuro
 {
     using namespace std;
 
     class Tensor;
+    class SlotQueue;
 
     struct ILoader
     {
         virtual ~ILoader() {}
-        // Loads tensor(s) starting at loadIdx. Returns number of tensors loaded.
+        // Loads tensor(s) starting at loadIdx. Returns number of tensors loaded. When preloader has multiple workers this function
+        // is called concurrently (each time with different destination) so any state shared between calls has to be guarded.
         virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) = 0;
     };
 
+    struct DataPreloaderStats
+    {
+        size_t batchesLoaded = 0;
+        size_t batchesConsumed = 0;
+        size_t queueDepthSum = 0; // sum of ready batches counts observed by each Load call
+        float loadTime = 0; // total time spent by workers in loaders [ms]
+        float workersWaitTime = 0; // total time spent by workers waiting for free slot [ms]
+        float consumerWaitTime = 0; // total time spent in Load waiting for data [ms]
+
+        string ToString() const;
+    };
+
+    // Batches are loaded into fixed number of preallocated slots. Slots are handed over between workers and consumer through lock-free
+    // queues of slot indices, waiting threads sleep on queue cells and are woken only when cell they wait for changes.
     class DataPreloader
     {
     public:
-        DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode = true);
+        // Each worker thread loads whole batch into its own slot so capacity should be greater than number of workers to keep all of them busy.
+        // In ordered mode batches are handed out in the same order workers started loading them, otherwise first loaded batch is handed out.
+        DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode = true, uint32_t workersNum = 1, bool ordered = false);
         ~DataPreloader();
 
-        // This function will copy first available tensors to the destination tensors
-        void Load();
+        // This function will copy first available tensors to the destination tensors. When swapping storage destination tensors receive
+        // preloaded memory and their previous memory is reused for loading, so any pointers to destination values are invalidated.
+        void Load(bool swapStorage = false);
+
+        // When consumer wait time is a significant part of training time and average queue depth is close to zero training is input-starved
+        DataPreloaderStats Stats() const;
+        void ResetStats();
 
     private:
-        void Preload();
+        // Returns false when preloader is stopping
+        bool Preload();
         void PreloadFunc();
 
         bool m_ThreadedMode = false;
-        bool m_Stop = false;
-        thread m_PreloaderThread;
-
-        condition_variable m_AvailableCond;
-        mutex m_AvailableMtx;
-        list<vector<Tensor>*> m_Available;
-        condition_variable m_PendingCond;
-        mutex m_PendingMtx;
-        list<vector<Tensor>*> m_Pending;
+        bool m_Ordered = false;
+        vector<thread> m_Workers;
+
+        vector<vector<Tensor>> m_Slots;
+        SlotQueue* m_Free = nullptr; // slots waiting to be loaded
+        SlotQueue* m_Ready = nullptr; // loaded slots waiting to be consumed
+        atomic<size_t> m_ReadyCount{ 0 };
+
+        atomic<size_t> m_BatchesLoaded{ 0 };
+        atomic<size_t> m_BatchesConsumed{ 0 };
+        atomic<size_t> m_QueueDepthSum{ 0 };
+        atomic<int64_t> m_LoadTime{ 0 }; // [us]
+        atomic<int64_t> m_WorkersWaitTime{ 0 }; // [us]
+        atomic<int64_t> m_ConsumerWaitTime{ 0 }; // [us]
 
         vector<Tensor*> m_Destination;
         vector<ILoader*> m_Loaders;
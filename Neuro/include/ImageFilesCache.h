@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Neuro
+{
+    using namespace std;
+
+    enum EImageFileState
+    {
+        IFS_Unknown, // file was not decoded yet
+        IFS_Valid,
+        IFS_Invalid,
+    };
+
+    struct ImageFileInfo
+    {
+        string path;
+        uint64_t size = 0;
+        int64_t modificationTime = 0;
+        uint32_t width = 0; // 0 when dimensions were not read yet
+        uint32_t height = 0;
+        int format = -1; // FreeImage format
+        EImageFileState state = IFS_Unknown;
+    };
+
+    // Metadata of files in directories listed by LoadFilesList. Every directory's list is persisted in 'dir_cache' file next to it and
+    // refreshed incrementally, only files which are new or whose size or modification time changed are probed again. Metadata of all
+    // loaded lists is kept in memory so image dimensions can be looked up without opening files.
+    class ImageFilesCache
+    {
+    public:
+        static ImageFilesCache& Default();
+
+        // Returns entries stored in directory's cache file, empty when there is no cache file
+        vector<ImageFileInfo> Load(const string& dir);
+        // Scans directory and updates its cache file. Files are stat'ed and probed in parallel, when validating every new or changed
+        // file is fully decoded so its state is known.
+        vector<ImageFileInfo> Refresh(const string& dir, bool validate);
+
+        bool Find(const string& filename, ImageFileInfo& info) const;
+        void Update(const ImageFileInfo& info);
+
+    private:
+        static string CacheFilename(const string& dir) { return dir + "_cache"; }
+        void Save(const string& dir, const vector<ImageFileInfo>& files) const;
+        void Register(const vector<ImageFileInfo>& files);
+
+        mutable mutex m_Mtx;
+        unordered_map<string, ImageFileInfo> m_Files;
+    };
+}
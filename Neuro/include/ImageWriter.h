@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+
+    // Saves images on background thread so dumping samples doesn't block training. Tensor values are copied on calling thread, their
+    // denormalization, tiling, encoding and writing to disk is done by the worker. Queue is bounded and images are dropped when it is
+    // full instead of blocking the caller. Images still in queue are written on destruction (including default writer at program exit).
+    class ImageWriter
+    {
+    public:
+        static ImageWriter& Default();
+
+        ImageWriter(size_t capacity = 4);
+        ~ImageWriter();
+
+        ImageWriter(const ImageWriter&) = delete;
+        ImageWriter& operator=(const ImageWriter&) = delete;
+
+        // Same arguments as SaveImage, returns false when image was dropped
+        bool Write(const Tensor& t, const string& imageFile, bool denormalize, uint32_t maxCols = 0);
+        // Blocks until all queued images are written
+        void Flush();
+
+        size_t Written() const { return m_Written; }
+        size_t Dropped() const { return m_Dropped; }
+
+    private:
+        struct Job
+        {
+            vector<float> values;
+            Shape shape;
+            string filename;
+            bool denormalize;
+            uint32_t maxCols;
+        };
+
+        void WorkerFunc();
+
+        size_t m_Capacity;
+        deque<Job*> m_Queue;
+        bool m_Writing = false;
+        bool m_Stop = false;
+        mutex m_Mtx;
+        condition_variable m_JobAvailable;
+        condition_variable m_Idle;
+        thread m_Worker;
+
+        atomic<size_t> m_Written{ 0 };
+        atomic<size_t> m_Dropped{ 0 };
+    };
+}
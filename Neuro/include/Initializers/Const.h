@@ -10,6 +10,7 @@ namespace Neuro
         Const(float value = 1.f);
 
         virtual void Init(Tensor& t) override;
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Value; }
 
 	private:
         float m_Value;
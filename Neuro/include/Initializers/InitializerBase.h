@@ -1,12 +1,20 @@
 ﻿#pragma once
 
+#include <ostream>
+
 namespace Neuro
 {
 	class Tensor;
 
+    using namespace std;
+
     class InitializerBase
     {
 	public:
+        virtual ~InitializerBase() {}
+
         virtual void Init(Tensor& t) = 0;
+        // Written attributes are enough to recreate the initializer when graph is saved without weights
+        virtual void WriteAttributes(ostream& stream) const {}
 	};
 }
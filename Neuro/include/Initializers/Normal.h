@@ -13,6 +13,8 @@ namespace Neuro
         // Values whose magnitude is more than two standard deviations from the mean are dropped and re-picked.
         static float NextTruncatedSingle(float mean, float stdDeviation);
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Mean << " " << m_Variance << " " << m_Scale; }
+
     protected:
         virtual void Init(Tensor& t) override;
 
@@ -13,6 +13,8 @@ namespace Neuro
         static float NextSingle(float min, float max);
         static Tensor Random(float min, float max, const Shape& shape);
 
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Min << " " << m_Max; }
+
     protected:
         virtual void Init(Tensor& t) override;
 
@@ -30,6 +30,7 @@ namespace Neuro
         VarianceScaling(float scale = 1, EFanMode mode = FanIn, EDistribution distribution = NormalDistribution);
 
         virtual void Init(Tensor& t) override;
+        virtual void WriteAttributes(ostream& stream) const override { stream << m_Scale << " " << (int)m_Mode << " " << (int)m_Distribution; }
 
     private:
         pair<float, float> ComputeFans(const Shape& shape) const;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Neuro
+{
+    using namespace std;
+
+    struct CachedImage
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        vector<uint8_t> pixels; // 24 bits per pixel, bottom-up rows
+    };
+
+    // Memory-bounded least recently used cache of decoded and resized images shared by all image loading functions (cropping is applied
+    // after cache lookup so random crops still work). It is disabled until capacity is set. Entries are shared so images evicted while
+    // in use stay alive until released.
+    class ImageCache
+    {
+    public:
+        static ImageCache& Default();
+
+        void SetCapacity(size_t capacityInBytes);
+        size_t Capacity() const { return m_Capacity; }
+        bool IsEnabled() const { return m_Capacity > 0; }
+
+        shared_ptr<const CachedImage> Get(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY);
+        void Put(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, const shared_ptr<const CachedImage>& image);
+        void Clear();
+
+        size_t Hits() const { return m_Hits; }
+        size_t Misses() const { return m_Misses; }
+        size_t SizeInBytes() const { return m_Size; }
+
+    private:
+        typedef list<pair<string, shared_ptr<const CachedImage>>> entries_t;
+
+        static string Key(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY);
+        void Evict(size_t requiredSize);
+
+        mutable mutex m_Mtx;
+        entries_t m_Entries; // most recently used first
+        unordered_map<string, entries_t::iterator> m_EntriesByKey;
+        // modified under lock but atomic so statistics can be read while other threads load images
+        atomic<size_t> m_Capacity{ 0 };
+        atomic<size_t> m_Size{ 0 };
+        atomic<size_t> m_Hits{ 0 };
+        atomic<size_t> m_Misses{ 0 };
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Neuro
+{
+    using namespace std;
+
+    // Whole file mapped into memory, pages are loaded on first access and shared with other processes mapping the same file.
+    // Copy-on-write mapping can be modified, modified pages become private and changes are never written back to the file.
+    class MappedFile
+    {
+    public:
+        MappedFile(const string& filename, bool copyOnWrite = false);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool IsValid() const { return m_Data != nullptr; }
+        bool IsCopyOnWrite() const { return m_CopyOnWrite; }
+
+        const uint8_t* Data() const { return m_Data; }
+        // Only copy-on-write mapping can be modified
+        uint8_t* MutableData();
+        size_t Size() const { return m_Size; }
+
+    private:
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+        uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+        bool m_CopyOnWrite;
+    };
+}
@@ -5,6 +5,8 @@
 #include <mutex>
 #include <driver_types.h>
 
+#include "Memory/ScratchArena.h"
+
 namespace Neuro
 {
     using namespace std;
@@ -186,6 +188,7 @@ namespace Neuro
         DeviceMemoryManager::Default().DumpMemoryState(file);
         HostMemoryManager::Default().DumpMemoryState(file);
         HostPinnedMemoryManager::Default().DumpMemoryState(file);
+        ScratchArena::DumpState(file);
         fclose(file);
     }
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+
+    // Per-thread stack of host workspace for temporaries needed only during a single kernel call. Memory is borrowed by bumping offset
+    // in current block and returned by rewinding to a previously taken mark, so both are O(1). Blocks are requested from host memory
+    // manager only when workspace grows beyond what was needed so far and are reused until thread exits. Peak usage is tracked so block
+    // size can be set up front.
+    class ScratchArena
+    {
+    public:
+        // Arena of calling thread
+        static ScratchArena& Local();
+
+        ScratchArena() = default;
+        ~ScratchArena();
+
+        ScratchArena(const ScratchArena&) = delete;
+        ScratchArena& operator=(const ScratchArena&) = delete;
+
+        // Returned memory is uninitialized and 64 bytes aligned
+        float* Allocate(size_t count);
+        size_t Mark() const { return m_Used; }
+        // Returns everything allocated after mark was taken
+        void Release(size_t mark);
+
+        size_t UsedSizeInBytes() const { return m_Used * sizeof(float); }
+        size_t PeakSizeInBytes() const { return m_Peak * sizeof(float); }
+
+        // Highest peak of all threads' arenas
+        static size_t GlobalPeakSizeInBytes();
+        // Minimum size of blocks requested from host memory manager, blocks grow geometrically when it is too small
+        static void SetBlockSize(size_t sizeInBytes);
+        static void DumpState(FILE* file);
+
+    private:
+        struct Block
+        {
+            float* data;
+            size_t size;
+            size_t begin; // offset of the first element in arena
+        };
+
+        vector<Block> m_Blocks;
+        size_t m_Current = 0;
+        size_t m_Used = 0; // offset of the first free element in arena, unused tails of blocks are counted as used
+        size_t m_Peak = 0;
+    };
+
+    // Borrows workspace from calling thread's arena and returns all of it when going out of scope. Scopes have to be nested.
+    class ScratchScope
+    {
+    public:
+        ScratchScope() : m_Arena(ScratchArena::Local()), m_Mark(m_Arena.Mark()) {}
+        ~ScratchScope() { m_Arena.Release(m_Mark); }
+
+        ScratchScope(const ScratchScope&) = delete;
+        ScratchScope& operator=(const ScratchScope&) = delete;
+
+        float* Allocate(size_t count) { return m_Arena.Allocate(count); }
+        // Uninitialized tensor using arena memory, it must not be used after scope ends
+        Tensor NewTensor(const Shape& shape, const string& name = "");
+
+    private:
+        ScratchArena& m_Arena;
+        size_t m_Mark;
+    };
+}
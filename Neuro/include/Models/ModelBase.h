@@ -4,6 +4,7 @@
 #include <vector>
 #include <unordered_set>
 #include <fstream>
+#include <future>
 
 #include "Layers/LayerBase.h"
 #include "ParameterAndGradient.h"
@@ -19,6 +20,8 @@ namespace Neuro
     class Trainer;
     class Predicter;
     class Placeholder;
+    class MappedFile;
+    class Operation;
 
     class ModelBase : public LayerBase
     {
@@ -45,8 +48,24 @@ namespace Neuro
         const vector<LayerBase*>& InputLayers() const { return m_InputLayers; }
         const vector<LayerBase*>& OutputLayers() const { return m_OutputLayers; }
 
+        // Weights are saved in native format when file has '.nw' extension, otherwise HDF5 format is used
         void SaveWeights(const string& filename) const;
-        void LoadWeights(const string& filename, bool ignoreInputLayer = true, bool byName = false);
+        // Format is detected automatically. Native weights file is memory-mapped and parameters use its pages directly (modifying
+        // them makes private copies), in that case mapping is kept alive for the lifetime of the model. HDF5 file may contain more
+        // layers than the model, only groups of layers present in the model are read. Verbose mode prints per-layer load times.
+        void LoadWeights(const string& filename, bool ignoreInputLayer = true, bool byName = false, bool verbose = false);
+        // Loads native copy of given weights file (with '.nw' extension appended) when available, otherwise loads given file and saves
+        // its native copy so subsequent loads are nearly instant
+        void LoadWeightsCached(const string& filename, bool ignoreInputLayer = true, bool byName = false);
+        // Saves model's computational graph so it can be restored with Graph::Load and run by Predicter without model construction code
+        void SaveGraph(const string& filename, bool saveWeights = true) const;
+        // Snapshots parameters and state of minimization operation (model's own one by default) and writes them on a background thread.
+        // Checkpoint file is replaced atomically once fully written and flushed to disk, only one checkpoint is being written at a time.
+        void SaveCheckpoint(const string& filename, const Operation* minimization = nullptr);
+        // Restores parameters and minimization operation state saved by SaveCheckpoint
+        void LoadCheckpoint(const string& filename, Operation* minimization = nullptr);
+        // Blocks until checkpoint being written (if any) is on disk, returns false when writing it failed
+        bool WaitForCheckpoint();
         
         virtual void Parameters(vector<Variable*>& params, bool onlyTrainable = true) const override;
 
@@ -92,13 +111,20 @@ namespace Neuro
         void MapGraphNetwork(const vector<TensorLike*>& inputs, const vector<TensorLike*>& outputs);
         void ProcessLayer(LayerBase* layer, unordered_set<LayerBase*>& visited);
 
+        void SaveWeightsNative(const string& filename, bool ignoreInputLayer = false) const;
+        void LoadWeightsNative(const string& filename, bool ignoreInputLayer, bool byName);
+
         // This is vectorized gradient descent
         void TrainStep(const const_tensor_ptr_vec_t& inputs, const const_tensor_ptr_vec_t& outputs, float* trainError = nullptr, float* trainAcc = nullptr);
 
-        // Build a single tensor with multiple batches for each input
-        const_tensor_ptr_vec_t GenerateBatch(const const_tensor_ptr_vec_t& inputs, const vector<uint32_t>& batchIndices);
+        // Build a single tensor with multiple batches for each input, consecutive batches alias input values instead of being copied.
+        // Result tensors are reused between calls so their memory is only allocated when batch grows.
+        void GenerateBatch(const const_tensor_ptr_vec_t& inputs, const vector<uint32_t>& batchIndices, vector<Tensor>& result);
 
         OptimizerBase* m_Optimizer = nullptr;
+        Operation* m_Minimization = nullptr;
+        future<bool> m_CheckpointFuture;
+        vector<MappedFile*> m_MappedWeights;
         vector<accuracy_func_t> m_AccuracyFuncs;
         bool m_ForceLearningPhase = false;
 
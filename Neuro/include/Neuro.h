@@ -52,6 +52,7 @@
 #include "ComputationalGraph/Graph.h"
 #include "ComputationalGraph/Placeholder.h"
 #include "ComputationalGraph/Session.h"
+#include "ComputationalGraph/Profiler.h"
 #include "ComputationalGraph/Variable.h"
 #include "ComputationalGraph/Constant.h"
 #include "ComputationalGraph/NameScope.h"
@@ -63,5 +64,13 @@
 
 #include "Debug.h"
 #include "DataPreloader.h"
+#include "RecordDataset.h"
+#include "CsvLoader.h"
+#include "ImageFilesCache.h"
+#include "Augmentation.h"
+#include "ImageWriter.h"
+#include "Resampler.h"
 
-#include "Memory/MemoryManager.h"
\ No newline at end of file
+#include "Memory/MemoryManager.h"
+#include "Memory/ImageCache.h"
+#include "Memory/ScratchArena.h"
\ No newline at end of file
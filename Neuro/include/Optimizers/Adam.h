@@ -3,6 +3,7 @@
 #include <unordered_set>
 
 #include "Optimizers/OptimizerBase.h"
+#include "ComputationalGraph/Graph.h"
 
 namespace Neuro
 {
@@ -25,6 +26,8 @@ namespace Neuro
             MinimizationOperation(const vector<TensorLike*>& losses, const vector<Variable*>& vars, Variable* globalStep, TensorLike* lr, float beta1, float beta2, float epsilon);
             virtual bool IsTrainingOp() const override { return true; }
             virtual void Reset() override;
+            virtual bool GetOptimizerState(OptimizerState& state) const override;
+            virtual void SetOptimizerState(const OptimizerState& state) override;
             vector<Tensor>& DebugMGrads() { return m_MGradients; }
             vector<Tensor>& DebugVGrads() { return m_VGradients; }
         protected:
@@ -40,8 +43,9 @@ namespace Neuro
             Variable* m_GlobalStep;
             vector<Tensor> m_MGradients;
             vector<Tensor> m_VGradients;
-            vector<TensorLike*> m_Order;
-            unordered_set<TensorLike*> m_NodesAffectingLosses;
+            vector<Variable*> m_MomentsVars; // variables matching moments
+            map<string, pair<Tensor, Tensor>> m_RestoredMoments; // restored moments waiting for their variables to be optimized
+            GradientsPlan m_Plan;
             float m_Iteration = 0;
         };
 
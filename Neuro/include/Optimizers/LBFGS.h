@@ -64,6 +64,8 @@ namespace Neuro
         {
         public:
             MinimizationOperation(const vector<TensorLike*>& losses, const vector<Variable*>& vars, size_t maxIterations, float epsilon);
+            virtual bool IsTrainingOp() const override { return true; }
+            virtual bool IsDeterministic() const override { return false; }
 
         protected:
             virtual void ComputeInternal();
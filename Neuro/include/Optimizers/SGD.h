@@ -3,6 +3,7 @@
 #include <unordered_set>
 
 #include "Optimizers/OptimizerBase.h"
+#include "ComputationalGraph/Graph.h"
 
 namespace Neuro
 {
@@ -29,8 +30,7 @@ namespace Neuro
         private:
             float m_LearningRate;
             vector<Variable*> m_Vars;
-            vector<TensorLike*> m_Order;
-            unordered_set<TensorLike*> m_NodesAffectingLosses;
+            GradientsPlan m_Plan;
         };
 
     private:
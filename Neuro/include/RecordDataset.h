@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DataPreloader.h"
+#include "Random.h"
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    class MappedFile;
+
+    enum ERecordType
+    {
+        RT_UInt8, // values are rounded and clamped to [0, 255] on write
+        RT_Float,
+    };
+
+    // Writes fixed-shape samples to shard files (prefix_00000.rec, prefix_00001.rec, ...) and index file (prefix.idx) describing them.
+    // Every record starts at cache line boundary and shards' records start at page boundary so they can be read directly from mapped file.
+    class RecordDatasetWriter
+    {
+    public:
+        RecordDatasetWriter(const string& prefix, const Shape& sampleShape, ERecordType type = RT_UInt8, uint32_t recordsPerShard = 10000);
+        ~RecordDatasetWriter();
+
+        // Writes every batch of given tensor as separate record
+        void Write(const Tensor& samples);
+        void Write(const float* sample);
+        // Finalizes last shard and writes index, it is called on destruction
+        void Close();
+
+    private:
+        void OpenShard();
+        void CloseShard();
+
+        string m_Prefix;
+        Shape m_SampleShape;
+        ERecordType m_Type;
+        uint32_t m_RecordsPerShard;
+        uint64_t m_RecordsNum = 0;
+        uint32_t m_ShardsNum = 0;
+        uint32_t m_ShardRecordsNum = 0;
+        FILE* m_Shard = nullptr;
+        vector<uint8_t> m_RecordBuffer;
+        bool m_Closed = false;
+    };
+
+    // Random access reader of dataset created by RecordDatasetWriter, all shards are memory-mapped so reading a sample is a copy (or
+    // conversion from uint8) from mapped memory.
+    class RecordDataset
+    {
+    public:
+        RecordDataset(const string& prefix);
+        ~RecordDataset();
+
+        RecordDataset(const RecordDataset&) = delete;
+        RecordDataset& operator=(const RecordDataset&) = delete;
+
+        bool IsValid() const { return !m_Shards.empty(); }
+        size_t Size() const { return m_RecordsNum; }
+        const Shape& SampleShape() const { return m_SampleShape; }
+        ERecordType Type() const { return m_Type; }
+
+        void Read(size_t idx, float* output) const;
+        // Reads samples with given indices into consecutive batches of output, samples are read in parallel
+        void Gather(const vector<size_t>& indices, float* output) const;
+
+    private:
+        const uint8_t* Record(size_t idx) const;
+
+        Shape m_SampleShape;
+        ERecordType m_Type = RT_UInt8;
+        uint32_t m_RecordsPerShard = 0;
+        size_t m_RecordsNum = 0;
+        size_t m_RecordStride = 0;
+        vector<const MappedFile*> m_Shards;
+    };
+
+    // Loads batches of randomly picked samples from record dataset
+    struct RecordLoader : public ILoader
+    {
+        RecordLoader(const RecordDataset& dataset, uint32_t batchSize, uint32_t seed = 0) : m_Dataset(dataset), m_BatchSize(batchSize), m_Rng(seed) {}
+
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+
+    private:
+        const RecordDataset& m_Dataset;
+        uint32_t m_BatchSize;
+        Random m_Rng;
+        mutex m_RngMtx;
+    };
+
+    // Decodes images (resizing them to given size) in parallel and packs them into record dataset so they don't have to be decoded ever again
+    void PackImagesDataset(const vector<string>& files, const string& prefix, uint32_t width, uint32_t height, ERecordType type = RT_UInt8, uint32_t recordsPerShard = 10000);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Neuro
+{
+    enum EResampleFilter
+    {
+        RF_Bilinear,
+        RF_Bicubic, // Catmull-Rom
+        RF_Lanczos3,
+    };
+
+    // Separable resampling of 8-bit interleaved image (1 to 4 channels per pixel). Filter weights are computed once per output column
+    // and row, filter is widened when downscaling so there is no aliasing. Horizontal pass is done for every source row and produces floats,
+    // vertical pass combines them into output rows. Both passes are split by rows across threads when multi-threaded.
+    void ResampleImage(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstPitch, uint32_t channels, EResampleFilter filter = RF_Bicubic, bool multiThreaded = true);
+}
@@ -1,8 +1,5 @@
 #pragma once
 
-#include <driver_types.h>
-#include <future>
-#include <mutex>
 #include <string>
 
 #include "Types.h"
@@ -18,8 +15,11 @@ namespace Neuro
         ST_DeviceRefCounted = 1 << 2,
         ST_Offloadable = 1 << 3,
         ST_KeepDevMem = 1 << 4,
+        ST_HostOnly = 1 << 5, // never allocates device memory, copying to device and offload/preload are no-ops
     };
 
+    // Host buffer optionally mirrored on device. Offload/preload events and their synchronization live in a separate structure created
+    // on first use of device memory, so storages used only on CPU never touch CUDA runtime.
     class Storage
     {
     public:
@@ -31,10 +31,17 @@ namespace Neuro
         ~Storage();
 
         void ChangeType(int type);
+        int Type() const { return m_Type; }
         void Resize(size_t size);
         void Rename(const string& name);
         /// Deallocates all memory on both host and device. Location will be changed to None. Size will remain unchanged.
         void Release();
+        /// Makes host data point to externally owned memory without copying. It is never freed, alias is dropped on release or on resize
+        /// beyond aliased size. Memory has to outlive any use of this storage. Read-only alias is never written back from device.
+        void Alias(const float* data, size_t size, bool writable = false);
+        bool IsAlias() const { return m_Aliased; }
+        /// Exchanges host and device memory with other storage of the same size. Type, name and reference counts are not exchanged.
+        void Swap(Storage& other);
 
         void AllocateOnHost() const;
         void FreeOnHost();
@@ -83,6 +90,12 @@ namespace Neuro
         size_t AllocSizeInBytes() const { return m_AllocSize * sizeof(float); }
 
     private:
+        struct DeviceState;
+
+        DeviceState& GetDeviceState() const;
+        bool IsOffloadRequested() const;
+        bool IsPreloadRequested() const;
+
         static void OffloadTriggerCallback(void* userData);
         static void OffloadDoneCallback(void* userData);
         static void PreloadDoneCallback(void* userData);
@@ -97,19 +110,10 @@ namespace Neuro
         size_t m_Size = 0;
         mutable int m_DeviceDataRefCount = 0;
         mutable int m_DataRefCount = 0;
-        cudaEvent_t m_OffloadEvent = nullptr;
-        mutable bool m_OffloadDone = false;
-        mutable mutex m_OffloadDoneCallbackMtx;
-        mutable bool m_FreeDeviceMemOnOffloadDone = false;
-        mutable bool m_FreePinnedMemOnOffloadDone = false;
-        mutable bool m_OffloadRequested = false;
-        mutable promise<void> m_OffloadPromise;
-        mutable future<void> m_OffloadFuture;
-        mutable promise<void> m_PreloadPromise;
-        mutable future<void> m_PreloadFuture;
-        mutable bool m_PreloadRequested = false;
-        cudaEvent_t m_PreloadEvent = nullptr;
+        mutable DeviceState* m_DeviceState = nullptr;
         mutable ELocation m_DataLocation = None;
+        bool m_Aliased = false;
+        bool m_AliasWritable = false;
         string m_Name = "";
     };
 }
@@ -37,6 +37,8 @@ namespace Neuro
 		static void SetDefaultOpMode(EOpMode mode);
         static void SetForcedOpMode(EOpMode mode);
         static void ClearForcedOpMode();
+        // Returns false when no op mode is forced on calling thread
+        static bool GetForcedOpMode(EOpMode& mode);
 
         void SetOpMode(EOpMode mode);
 
@@ -56,6 +58,9 @@ namespace Neuro
         float* Values();
         const float* Values() const;
         void SetStorageType(int type);
+        int GetStorageType() const { return m_Storage.Type(); }
+        // Exchanges memory with other tensor of the same length without copying
+        void SwapStorage(Tensor& other);
 
         bool Validate() const;
 
@@ -323,6 +328,13 @@ namespace Neuro
         void IncRef(size_t n = 1);
         void DecRef(size_t n = 1);
         void ReleaseData();
+        /// Makes this tensor use host memory of given batches range of source tensor without copying (when batchesNum is 0 all remaining batches are used).
+        /// Aliased values are treated as read-only, source has to outlive any use of this tensor.
+        void Alias(const Tensor& source, uint32_t batchOffset = 0, uint32_t batchesNum = 0);
+        /// Makes this tensor use externally owned host memory without copying, memory has to outlive any use of this tensor.
+        /// Writable alias should only be used when memory can be modified (i.e. copy-on-write file mapping).
+        void Alias(const float* data, const Shape& shape, bool writable = false);
+        bool IsAlias() const { return m_Storage.IsAlias(); }
         void CopyToDevice() const;
         void CopyToHost(bool allowAlloc = false) const;
         /// Sync will copy data from device to host but it won't change location (useful for read-only operations performed on CPU)
@@ -358,7 +370,8 @@ namespace Neuro
 		static TensorOpCpu* GetOpFromMode(EOpMode mode);
 
 		static TensorOpCpu* g_DefaultOp;
-        static TensorOpCpu* g_ForcedOp;
+        // forced op is per thread so operations can be computed concurrently (i.e. during backward pass)
+        static thread_local TensorOpCpu* g_ForcedOp;
 		static TensorOpCpu* g_OpCpu;
         static TensorOpCpu* g_OpCpuMt;
         static TensorOpCpu* g_OpCpuMkl;
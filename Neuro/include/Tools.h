@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -26,10 +27,13 @@ namespace Neuro
 
 	class Tensor;
     class Variable;
+    struct ImageFileInfo;
 
     const float _EPSILON = 10e-7f;
     
     Random& GlobalRng();
+    // Has to be held whenever global generator is used from multiple threads
+    mutex& GlobalRngMutex();
     void GlobalRngSeed(unsigned int seed);
 
     template<typename C> void DeleteContainer(C& container);
@@ -59,18 +63,35 @@ namespace Neuro
     //void SaveMnistData(const Tensor& input, const Tensor& output, const string& imagesFile, const string& labelsFile);
     void LoadCifar10Data(const string& imagesFile, Tensor& input, Tensor& output, bool normalize, bool generateImage = false, int maxImages = -1);
     void SaveCifar10Data(const string& imagesFile, const Tensor& input, const Tensor& output);
-    void LoadCSVData(const string& filename, int outputsNum, Tensor& inputs, Tensor& outputs, bool outputsOneHotEncoded = false, int maxLines = -1);
+
+    // Preprocessing applied while pixels are converted to floats: value = (pixel - mean[channel]) * scale
+    struct ImagePreprocess
+    {
+        ImagePreprocess(float scale = 1.f, float meanR = 0.f, float meanG = 0.f, float meanB = 0.f, bool swapChannels = false) : scale(scale), mean{ meanR, meanG, meanB }, swapChannels(swapChannels) {}
+
+        float scale;
+        float mean[3]; // RGB order
+        bool swapChannels; // output channels in BGR order
+    };
 
     // Loaded tensor is flat and internal data layout is NHWC, it should be transposed and normalized before use
-    void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW);
-    Tensor LoadImage(const string& filename, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW);
+    // Crop offset is picked using given generator, when none is provided global generator is used
+    void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW, const ImagePreprocess& preprocess = ImagePreprocess(), Random* rng = nullptr);
+    Tensor LoadImage(const string& filename, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW, const ImagePreprocess& preprocess = ImagePreprocess(), Random* rng = nullptr);
     Tensor LoadImage(uint8_t* imageBuffer, uint32_t width, uint32_t height, EPixelFormat format = RGB);
     void SaveImage(const Tensor& t, const string& imageFile, bool denormalize, uint32_t maxCols = 0);
+    // Values have to be in host memory and use NCHW layout
+    void SaveImage(const float* values, const Shape& shape, const string& imageFile, bool denormalize, uint32_t maxCols = 0);
     bool IsImageFileValid(const string& filename);
+    // Reads dimensions and format of the file, when decoding whole image is decoded so file state is known as well
+    void ProbeImageFile(ImageFileInfo& info, bool decode);
     Shape GetShapeForMinSize(const Shape& shape, uint32_t minSize);
     Shape GetShapeForMaxSize(const Shape& shape, uint32_t maxSize);
+    // Dimensions are taken from files cache when available, otherwise only image header is read
     Shape GetImageDims(const string& filename);
 
+    // When using cache list stored in directory's cache file is returned, otherwise directory is scanned and cache refreshed (metadata of
+    // unchanged files is reused). Validation decodes new or changed files in parallel and excludes invalid ones from the list.
     vector<string> LoadFilesList(const string& dir, bool shuffle, bool useCache = true, bool validate = false);
 
     void SampleImagesBatch(const vector<string>& files, Tensor& output, bool loadAll = false);
@@ -85,6 +106,8 @@ namespace Neuro
     Tensor NonMaxSuppression(const Tensor& img, const Tensor& theta);
     Tensor Threshold(const Tensor& img, float lowThresholdRatio = 0.05f, float highThresholdRatio = 0.09f, float weak = 100.f, float strong = 255.f);
     void Hysteresis(Tensor& img, float weak, float strong = 255.f);
+    // Every image of the batch (grayscale or RGB) is processed in parallel, edges are either 0 or 255 and have single channel
+    void CannyEdgeDetection(const Tensor& img, Tensor& edges);
     Tensor CannyEdgeDetection(const Tensor& img);
 
     static const uint32_t NVTX_COLOR_RED = 0xFFFF0000;
@@ -103,13 +126,23 @@ namespace Neuro
 
     struct ImageLoader : public ILoader
     {
-        ImageLoader(const vector<string>& files, uint32_t batchSize, uint32_t upScaleFactor = 1) : m_Files(files), m_BatchSize(batchSize), m_UpScaleFactor(upScaleFactor) {}
+        ImageLoader(const vector<string>& files, uint32_t batchSize, uint32_t upScaleFactor = 1, const ImagePreprocess& preprocess = ImagePreprocess()) : m_Files(files), m_BatchSize(batchSize), m_UpScaleFactor(upScaleFactor), m_Preprocess(preprocess) {}
 
+        // Images of a batch are decoded in parallel
         virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
 
         vector<string> m_Files;
         uint32_t m_BatchSize;
         uint32_t m_UpScaleFactor;
+        ImagePreprocess m_Preprocess;
+
+    protected:
+        // Randomly picks files for a whole batch, it is safe to call it from multiple preloader workers. Optionally seeds
+        // for per-image generators are picked as well so images can be cropped in parallel without sharing a generator.
+        vector<const string*> SampleFiles(Random& rng, vector<unsigned int>* seeds = nullptr);
+
+    private:
+        mutex m_SampleMtx;
     };
 
     class Tqdm
@@ -99,9 +99,9 @@ namespace Neuro
         }
 
         if (includeTop)
-            model->LoadWeights(weightsDir + "vgg16_weights_tf_dim_ordering_tf_kernels.h5");
+            model->LoadWeightsCached(weightsDir + "vgg16_weights_tf_dim_ordering_tf_kernels.h5");
         else
-            model->LoadWeights(weightsDir + "vgg16_weights_tf_dim_ordering_tf_kernels_notop.h5");
+            model->LoadWeightsCached(weightsDir + "vgg16_weights_tf_dim_ordering_tf_kernels_notop.h5");
 
         return model;
     }
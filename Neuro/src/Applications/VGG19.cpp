@@ -50,9 +50,9 @@ namespace Neuro
         }
 
         if (includeTop)
-            model->LoadWeights(weightsDir + "vgg19_weights_tf_dim_ordering_tf_kernels.h5", false);
+            model->LoadWeightsCached(weightsDir + "vgg19_weights_tf_dim_ordering_tf_kernels.h5", false);
         else
-            model->LoadWeights(weightsDir + "vgg19_weights_tf_dim_ordering_tf_kernels_notop.h5", false);
+            model->LoadWeightsCached(weightsDir + "vgg19_weights_tf_dim_ordering_tf_kernels_notop.h5", false);
 
         return model;
     }
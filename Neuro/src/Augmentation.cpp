@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <ppl.h>
+#include <emmintrin.h>
+
+#include "Augmentation.h"
+#include "Random.h"
+#include "Tensors/Tensor.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    using namespace concurrency;
+
+    static const float COLOR_PIVOT = 127.5f;
+
+    //////////////////////////////////////////////////////////////////////////
+    void Augmentation::Apply(const Tensor& source, Tensor& destination, Random& rng) const
+    {
+        Apply({ &source }, { &destination }, rng);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Augmentation::Apply(const vector<const Tensor*>& sources, const vector<Tensor*>& destinations, Random& rng) const
+    {
+        NEURO_ASSERT(sources.size() == destinations.size(), "Mismatched number of source and destination tensors.");
+        if (sources.empty())
+            return;
+
+        const uint32_t batch = sources[0]->Batch();
+        const size_t tensorsNum = sources.size();
+        const bool colorJitter = m_Brightness > 0 || m_Contrast > 0 || m_Saturation > 0;
+
+        for (size_t t = 0; t < tensorsNum; ++t)
+        {
+            NEURO_ASSERT(sources[t]->Batch() == batch, "Mismatched batch size of source tensor " << t << ".");
+            NEURO_ASSERT(sources[t]->Depth() == destinations[t]->Depth(), "Mismatched depth of tensors " << t << ".");
+            destinations[t]->ResizeBatch(batch);
+            destinations[t]->OverrideHost();
+        }
+
+        // all random parameters are picked up front so results don't depend on how samples are split between threads
+        vector<Geometry> geometry(batch);
+        vector<ColorTransform> colors(batch * tensorsNum);
+        for (uint32_t n = 0; n < batch; ++n)
+        {
+            geometry[n] = SampleGeometry(rng, sources[0]->Width(), sources[0]->Height(), destinations[0]->Width(), destinations[0]->Height());
+            for (size_t t = 0; t < tensorsNum; ++t)
+            {
+                if (colorJitter && sources[t]->Depth() == 3)
+                    colors[n * tensorsNum + t] = SampleColor(rng);
+            }
+        }
+
+        // values are accessed once so host copies are synchronized before going parallel
+        vector<const float*> srcValues(tensorsNum);
+        vector<float*> dstValues(tensorsNum);
+        for (size_t t = 0; t < tensorsNum; ++t)
+        {
+            srcValues[t] = sources[t]->Values();
+            dstValues[t] = destinations[t]->Values();
+        }
+
+        parallel_for(0u, batch, [&](uint32_t n)
+        {
+            for (size_t t = 0; t < tensorsNum; ++t)
+            {
+                const Tensor& src = *sources[t];
+                Tensor& dst = *destinations[t];
+
+                // geometry is picked for the first tensor, other tensors of different size get proportional region
+                Geometry sampleGeometry = geometry[n];
+                if (src.Width() != sources[0]->Width() || src.Height() != sources[0]->Height())
+                {
+                    float scaleX = src.Width() / (float)sources[0]->Width();
+                    float scaleY = src.Height() / (float)sources[0]->Height();
+                    sampleGeometry.regionX *= scaleX;
+                    sampleGeometry.regionWidth *= scaleX;
+                    sampleGeometry.regionY *= scaleY;
+                    sampleGeometry.regionHeight *= scaleY;
+                }
+
+                const ColorTransform* color = colorJitter && src.Depth() == 3 ? &colors[n * tensorsNum + t] : nullptr;
+                ApplySample(sampleGeometry, color, srcValues[t] + n * src.BatchLength(), src.Width(), src.Height(), src.Depth(), dstValues[t] + n * dst.BatchLength(), dst.Width(), dst.Height());
+            }
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Augmentation::Geometry Augmentation::SampleGeometry(Random& rng, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight) const
+    {
+        Geometry geometry;
+        float scale = m_MinScale < m_MaxScale ? rng.NextFloat(m_MinScale, m_MaxScale) : m_MinScale;
+        geometry.regionWidth = min((float)srcWidth, dstWidth / scale);
+        geometry.regionHeight = min((float)srcHeight, dstHeight / scale);
+
+        // integer offsets make crops without scaling exact copies of source pixels
+        int maxX = (int)(srcWidth - geometry.regionWidth);
+        int maxY = (int)(srcHeight - geometry.regionHeight);
+        geometry.regionX = (float)(m_RandomCrop ? rng.Next(maxX + 1) : maxX / 2);
+        geometry.regionY = (float)(m_RandomCrop ? rng.Next(maxY + 1) : maxY / 2);
+
+        geometry.flipX = m_FlipXProbability > 0 && rng.NextFloat() < m_FlipXProbability;
+        geometry.flipY = m_FlipYProbability > 0 && rng.NextFloat() < m_FlipYProbability;
+        return geometry;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Augmentation::ColorTransform Augmentation::SampleColor(Random& rng) const
+    {
+        float brightness = m_Brightness > 0 ? rng.NextFloat(1 - m_Brightness, 1 + m_Brightness) : 1.f;
+        float contrast = m_Contrast > 0 ? rng.NextFloat(1 - m_Contrast, 1 + m_Contrast) : 1.f;
+        float saturation = m_Saturation > 0 ? rng.NextFloat(1 - m_Saturation, 1 + m_Saturation) : 1.f;
+
+        // saturation blends with gray, contrast scales around middle gray and brightness scales the result, combined into single linear function
+        ColorTransform color;
+        color.a = saturation * contrast * brightness;
+        color.b = (1 - saturation) * contrast * brightness;
+        color.c = COLOR_PIVOT * (1 - contrast) * brightness;
+        return color;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Augmentation::ApplySample(const Geometry& geometry, const ColorTransform* color, const float* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t channels, float* dst, uint32_t dstWidth, uint32_t dstHeight) const
+    {
+        static thread_local vector<int> columns;
+        static thread_local vector<float> columnWeights;
+        static thread_local vector<float> row;
+
+        // bilinear sampling coordinates of output columns, flip is folded into the table
+        columns.resize(dstWidth * 2);
+        columnWeights.resize(dstWidth);
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            uint32_t ox = geometry.flipX ? dstWidth - 1 - x : x;
+            float sx = Clip(geometry.regionX + (ox + 0.5f) * geometry.regionWidth / dstWidth - 0.5f, 0.f, (float)(srcWidth - 1));
+            int x0 = (int)sx;
+            columns[x * 2] = x0;
+            columns[x * 2 + 1] = min(x0 + 1, (int)srcWidth - 1);
+            columnWeights[x] = sx - x0;
+        }
+
+        row.resize(dstWidth * channels);
+        const uint32_t srcPlaneSize = srcWidth * srcHeight;
+        const uint32_t dstPlaneSize = dstWidth * dstHeight;
+
+        const __m128 normScale = _mm_set1_ps(m_NormScale);
+        const __m128 normOffset = _mm_set1_ps(m_NormOffset);
+
+        for (uint32_t y = 0; y < dstHeight; ++y)
+        {
+            uint32_t oy = geometry.flipY ? dstHeight - 1 - y : y;
+            float sy = Clip(geometry.regionY + (oy + 0.5f) * geometry.regionHeight / dstHeight - 0.5f, 0.f, (float)(srcHeight - 1));
+            int y0 = (int)sy;
+            int y1 = min(y0 + 1, (int)srcHeight - 1);
+            float wy = sy - y0;
+
+            // gather source pixels of this output row
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                const float* top = src + c * srcPlaneSize + y0 * srcWidth;
+                const float* bottom = src + c * srcPlaneSize + y1 * srcWidth;
+                float* out = &row[c * dstWidth];
+                for (uint32_t x = 0; x < dstWidth; ++x)
+                {
+                    int x0 = columns[x * 2], x1 = columns[x * 2 + 1];
+                    float wx = columnWeights[x];
+                    float t = top[x0] + (top[x1] - top[x0]) * wx;
+                    float b = bottom[x0] + (bottom[x1] - bottom[x0]) * wx;
+                    out[x] = t + (b - t) * wy;
+                }
+            }
+
+            // color transform and normalization are applied to 4 pixels at a time
+            uint32_t x = 0;
+            if (color)
+            {
+                float* r = &row[0];
+                float* g = r + dstWidth;
+                float* b = g + dstWidth;
+                float* dstR = dst + y * dstWidth;
+                float* dstG = dstR + dstPlaneSize;
+                float* dstB = dstG + dstPlaneSize;
+
+                const __m128 a = _mm_set1_ps(color->a), k = _mm_set1_ps(color->b), offset = _mm_set1_ps(color->c);
+                const __m128 grayR = _mm_set1_ps(0.299f), grayG = _mm_set1_ps(0.587f), grayB = _mm_set1_ps(0.114f);
+                const __m128 low = _mm_setzero_ps(), high = _mm_set1_ps(255.f);
+
+                auto transform = [&](__m128 v, __m128 gray)
+                {
+                    v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, v), _mm_mul_ps(k, gray)), offset);
+                    v = _mm_min_ps(_mm_max_ps(v, low), high);
+                    return _mm_add_ps(_mm_mul_ps(v, normScale), normOffset);
+                };
+
+                for (; x + 4 <= dstWidth; x += 4)
+                {
+                    __m128 vr = _mm_loadu_ps(r + x), vg = _mm_loadu_ps(g + x), vb = _mm_loadu_ps(b + x);
+                    __m128 gray = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr, grayR), _mm_mul_ps(vg, grayG)), _mm_mul_ps(vb, grayB));
+                    _mm_storeu_ps(dstR + x, transform(vr, gray));
+                    _mm_storeu_ps(dstG + x, transform(vg, gray));
+                    _mm_storeu_ps(dstB + x, transform(vb, gray));
+                }
+
+                for (; x < dstWidth; ++x)
+                {
+                    float gray = r[x] * 0.299f + g[x] * 0.587f + b[x] * 0.114f;
+                    dstR[x] = Clip(color->a * r[x] + color->b * gray + color->c, 0.f, 255.f) * m_NormScale + m_NormOffset;
+                    dstG[x] = Clip(color->a * g[x] + color->b * gray + color->c, 0.f, 255.f) * m_NormScale + m_NormOffset;
+                    dstB[x] = Clip(color->a * b[x] + color->b * gray + color->c, 0.f, 255.f) * m_NormScale + m_NormOffset;
+                }
+                continue;
+            }
+
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                const float* in = &row[c * dstWidth];
+                float* out = dst + c * dstPlaneSize + y * dstWidth;
+                for (x = 0; x + 4 <= dstWidth; x += 4)
+                    _mm_storeu_ps(out + x, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + x), normScale), normOffset));
+                for (; x < dstWidth; ++x)
+                    out[x] = in[x] * m_NormScale + m_NormOffset;
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    AugmentingLoader::AugmentingLoader(ILoader& loader, const vector<Shape>& sourceShapes, const Augmentation& augmentation, uint32_t seed)
+        : m_Loader(loader), m_SourceShapes(sourceShapes), m_Augmentation(augmentation), m_Seed(seed ? seed : (uint32_t)time(nullptr))
+    {
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    AugmentingLoader::~AugmentingLoader()
+    {
+        DeleteContainer(m_FreeBuffers);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t AugmentingLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        const uint32_t batchIdx = m_BatchIdx++;
+
+        vector<Tensor>* buffer = nullptr;
+        {
+            unique_lock<mutex> buffersLocker(m_BuffersMtx);
+            if (!m_FreeBuffers.empty())
+            {
+                buffer = m_FreeBuffers.back();
+                m_FreeBuffers.pop_back();
+            }
+        }
+
+        if (!buffer)
+        {
+            buffer = new vector<Tensor>();
+            for (const auto& shape : m_SourceShapes)
+                buffer->push_back(Tensor(shape, "", ST_HostOnly)); // only read by augmentation, so wrapped loader's device copies are skipped
+        }
+
+        size_t loaded = m_Loader(*buffer, 0);
+        NEURO_ASSERT(loaded == buffer->size(), "Wrapped loader loaded " << loaded << " tensors, expected " << buffer->size() << ".");
+
+        vector<const Tensor*> sources;
+        vector<Tensor*> destinations;
+        for (size_t i = 0; i < buffer->size(); ++i)
+        {
+            sources.push_back(&(*buffer)[i]);
+            destinations.push_back(&dest[loadIdx + i]);
+        }
+
+        // random stream of every batch depends only on seed and batch number
+        Random rng((m_Seed ^ (batchIdx * 0x9E3779B9u)) | 1);
+        m_Augmentation.Apply(sources, destinations, rng);
+
+        for (auto destination : destinations)
+            destination->CopyToDevice();
+
+        {
+            unique_lock<mutex> buffersLocker(m_BuffersMtx);
+            m_FreeBuffers.push_back(buffer);
+        }
+
+        return loaded;
+    }
+}
@@ -1,4 +1,11 @@
 ﻿#include <fstream>
+#include <sstream>
+#include <limits>
+#include <typeinfo>
+#include <ppl.h>
+#include <thread>
+#include <unordered_map>
+#include <iterator>
 
 #include "ComputationalGraph/Graph.h"
 #include "ComputationalGraph/TensorLike.h"
@@ -6,6 +13,8 @@
 #include "ComputationalGraph/Variable.h"
 #include "ComputationalGraph/Constant.h"
 #include "ComputationalGraph/Operation.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
+#include "ComputationalGraph/Profiler.h"
 #include "Debug.h"
 #include "Tools.h"
 #include "Memory/MemoryManager.h"
@@ -23,6 +32,8 @@
 
 namespace Neuro
 {
+    using namespace concurrency;
+
     Graph* Graph::s_Default = nullptr;
 
     //////////////////////////////////////////////////////////////////////////
@@ -71,21 +82,26 @@ namespace Neuro
     {
         for (auto node : m_Nodes)
             delete node;
+        for (auto node : m_DetachedNodes)
+            delete node;
 
         m_Nodes.clear();
+        m_DetachedNodes.clear();
         m_Placeholders.clear();
         m_Variables.clear();
         m_Constants.clear();
         m_Operations.clear();
 
         m_CurrentStep = 0;
+        m_InitializedVariablesCount = 0;
     }
 
     //////////////////////////////////////////////////////////////////////////
     void Graph::InitVariables()
     {
-        for (auto var : m_Variables)
-            var->Initialize();
+        // variables are never uninitialized so only the ones added since last call have to be visited
+        for (; m_InitializedVariablesCount < m_Variables.size(); ++m_InitializedVariablesCount)
+            m_Variables[m_InitializedVariablesCount]->Initialize();
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -199,130 +215,609 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     vector<Variable*> Graph::ComputeGradients(const vector<TensorLike*>& losses, const vector<Variable*>& params)
     {
+        GradientsPlan plan;
+        plan.losses = losses;
+        plan.params = params;
+        return ComputeGradients(plan);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    const vector<Variable*>& Graph::PrepareGradientsPlan(GradientsPlan& plan)
+    {
+        if (!IsUpToDate(plan))
+            CompileGradientsPlan(plan);
+        return plan.variables;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static size_t GradientsSumChunksNum(size_t gradsNum)
+    {
+        const size_t MIN_GRADS_PER_CHUNK = 2;
+        return max<size_t>(min<size_t>(gradsNum / MIN_GRADS_PER_CHUNK, thread::hardware_concurrency()), 1);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::CompileGradientsPlan(GradientsPlan& plan)
+    {
+        GRAPH_DEBUG_INFO("##Graph: Compiling gradients plan...\n");
+
+        plan.nodes.clear();
+        plan.is_loss.clear();
+        plan.consumers_grads.clear();
+        plan.variable_idx.clear();
+        plan.variables.clear();
+        plan.waves.clear();
+        plan.partial_grads.clear();
+        plan.has_gpu_ops = false;
+        plan.graph_version = m_Version;
+        plan.trainability_version = m_TrainabilityVersion;
+
+        // parameters could have been frozen since plan was requested, there is nothing to compute when all of them are frozen
+        vector<Variable*> params;
+        copy_if(plan.params.begin(), plan.params.end(), back_inserter(params), [](const Variable* param) { return param->CareAboutGradient(); });
+        if (!plan.params.empty() && params.empty())
+            return;
+
         unordered_set<TensorLike*> nodesAffectingLosses;
-        auto order = BuildBackwardOrder(losses, nodesAffectingLosses, params);
-        return ComputeGradientsInOrder(order, losses, nodesAffectingLosses, params);
+        auto order = BuildBackwardOrder(plan.losses, nodesAffectingLosses, params);
+
+        /// remove all nodes which don't care about gradient, plan is recompiled whenever variables are switched between trainable and non-trainable state
+        order.erase(remove_if(order.begin(), order.end(), [](const TensorLike* node) { return !node->CareAboutGradient(); }), order.end());
+
+        unordered_map<TensorLike*, size_t> nodeWave;
+
+        for (auto node : order)
+        {
+            size_t n = plan.nodes.size();
+            plan.nodes.push_back(node);
+            plan.is_loss.push_back(find(plan.losses.begin(), plan.losses.end(), node) != plan.losses.end());
+            plan.consumers_grads.push_back({});
+            plan.partial_grads.push_back({});
+            plan.has_gpu_ops |= node->IsOp() && static_cast<Operation*>(node)->OpMode() == GPU;
+
+            int varIdx = -1;
+            if (node->IsVar() && static_cast<Variable*>(node)->Trainable() && (params.empty() || find(params.begin(), params.end(), node) != params.end()))
+            {
+                varIdx = (int)plan.variables.size();
+                plan.variables.push_back(static_cast<Variable*>(node));
+            }
+            plan.variable_idx.push_back(varIdx);
+
+            // node can be consumed by the same operation multiple times, every use corresponds to a different input gradient
+            unordered_map<TensorLike*, size_t> consumerUses;
+            for (auto consumer : node->m_Consumers)
+            {
+                assert(consumer->IsOp());
+                Operation* consumerOp = static_cast<Operation*>(consumer);
+                size_t use = consumerUses[consumer]++;
+
+                // ignore consumer when it didn't affect loss. one example of such consumers might be accuracy operation
+                if (nodesAffectingLosses.find(consumer) == nodesAffectingLosses.end())
+                    continue;
+
+                auto& inputsGrad = consumerOp->InputsGrads();
+
+                if (inputsGrad.size() == 1)
+                {
+                    plan.consumers_grads[n].push_back(&inputsGrad[0]);
+                    continue;
+                }
+
+                for (size_t i = 0; i < consumer->m_InputNodes.size(); ++i)
+                {
+                    if (consumer->m_InputNodes[i] == node && use-- == 0)
+                    {
+                        plan.consumers_grads[n].push_back(&inputsGrad[i]);
+                        break;
+                    }
+                }
+            }
+
+            // first chunk is accumulated directly into node's output gradient
+            plan.partial_grads[n].resize(GradientsSumChunksNum(plan.consumers_grads[n].size()) - 1);
+
+            // split nodes into waves, node can be processed once all its consumers participating in backward pass are processed. all nodes in a single wave
+            // are independent from each other (i.e. parallel branches, inputs of multi-input operations, parameters of the same layer)
+            size_t wave = 0;
+            for (auto consumer : node->m_Consumers)
+            {
+                auto consumerWaveIt = nodeWave.find(consumer);
+                if (consumerWaveIt != nodeWave.end())
+                    wave = max(wave, consumerWaveIt->second + 1);
+            }
+
+            nodeWave[node] = wave;
+            if (plan.waves.size() <= wave)
+                plan.waves.resize(wave + 1);
+            plan.waves[wave].push_back(n);
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
-    vector<Variable*> Graph::ComputeGradientsInOrder(const vector<TensorLike*>& order, const vector<TensorLike*>& losses, const unordered_set<TensorLike*> nodesAffectingLosses, const vector<Variable*>& params)
+    const vector<Variable*>& Graph::ComputeGradients(GradientsPlan& plan, const function<void(Variable*, size_t)>& gradientReady)
     {
         //DeviceMemoryManager::Default().ForceMemoryStreamSync();
 
-        vector<Variable*> variables;
+        PrepareGradientsPlan(plan);
 
-        /// remove all node which don't care about gradient. it has to be done at runtime since variables can be switched between trainable and non-trainable state
-        /// between consecutive session runs
-        auto newOrder = order;
-        newOrder.erase(remove_if(newOrder.begin(), newOrder.end(), [](const TensorLike* node) { return !node->CareAboutGradient(); }), newOrder.end());
+        if (m_ConcurrentGradients && !plan.has_gpu_ops && Tensor::ActiveOp()->OpMode() != GPU)
+        {
+            ComputeGradientsConcurrently(plan, gradientReady);
+            return plan.variables;
+        }
 
+        const auto& nodes = plan.nodes;
         size_t lastPrefetched = 0;
-        
-        for (size_t n = 0; n < newOrder.size(); ++n)
+
+        for (size_t n = 0; n < nodes.size(); ++n)
         {
             for (size_t p = lastPrefetched + 1; p <= n + m_PreloadSteps; ++p)
             {
-                if (p >= newOrder.size())
+                if (p >= nodes.size())
                     break;
 
-                auto node = newOrder[p];
-                NVTXProfile nvtxProf((string("Preload ") + node->Name()).c_str(), 0xFF5BB8FF);
+                auto node = nodes[p];
+                NVTXProfile nvtxProf(node->Name().c_str(), 0xFF5BB8FF);
                 GRAPH_DEBUG_INFO("##Graph: Preloading '%s'...\n", node->Name().c_str());
                 node->PreloadForGradient();
             }
             lastPrefetched = n + m_PreloadSteps;
 
-            auto node = newOrder[n];
-            GRAPH_DEBUG_INFO("##Graph: Computing gradient '%s'... (care about grad: %d)\n", node->Name().c_str(), node->CareAboutGradient() ? 1 : 0);
+            ComputeNodeGradient(plan, n, false);
 
-            if (node->CareAboutGradient())
-            {
-                NVTXProfile nvtxProf((string("Output grad for ") + node->Name()).c_str(), 0xFF4242FF);
-                if (node->IsVar())
-                {
-                    Variable* var = static_cast<Variable*>(node);
-                    if (var->Trainable() && (params.empty() || find(params.begin(), params.end(), node) != params.end()))
-                        variables.push_back(var);
-                }
+            int varIdx = plan.variable_idx[n];
+            if (gradientReady && varIdx >= 0)
+                gradientReady(plan.variables[varIdx], varIdx);
+        }
 
-                auto& nodeOutputGrad = node->m_OutputGrad;
-                nodeOutputGrad.Resize(node->m_Output.GetShape());
-                if (nodeOutputGrad.TryDeviceAllocate())
-                    nodeOutputGrad.OverrideDevice();
-                nodeOutputGrad.Zero(); // reset gradient
+        return plan.variables;
+    }
 
-                if (find(losses.begin(), losses.end(), node) != losses.end())
-                {
-                    // gradient of loss w.r.t to loss is 1
-                    nodeOutputGrad.One();
-                }
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::ComputeGradientsConcurrently(GradientsPlan& plan, const function<void(Variable*, size_t)>& gradientReady)
+    {
+        EOpMode opMode = Tensor::ActiveOp()->OpMode();
+
+        for (auto& wave : plan.waves)
+        {
+            GRAPH_DEBUG_INFO("##Graph: Computing gradients wave of %d nodes...\n", (int)wave.size());
+
+            parallel_for((size_t)0, wave.size(), [&](size_t i)
+            {
+                size_t n = wave[i];
+                // forced op mode is per thread so it has to be propagated to worker, chunks can also run inline on calling thread
+                // so its forced mode has to be restored afterwards
+                EOpMode prevMode;
+                bool prevForced = Tensor::GetForcedOpMode(prevMode);
+                Tensor::SetForcedOpMode(opMode);
+                ComputeNodeGradient(plan, n, true);
+
+                // all consumers are already processed so variable's gradient is final
+                int varIdx = plan.variable_idx[n];
+                if (gradientReady && varIdx >= 0)
+                    gradientReady(plan.variables[varIdx], varIdx);
+
+                if (prevForced)
+                    Tensor::SetForcedOpMode(prevMode);
                 else
+                    Tensor::ClearForcedOpMode();
+            });
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static void SumGradients(const vector<const Tensor*>& grads, vector<Tensor>& partials, Tensor& result, bool concurrent)
+    {
+        size_t chunksNum = concurrent ? partials.size() + 1 : 1;
+
+        if (chunksNum <= 1)
+        {
+            for (auto grad : grads)
+                result.Add(*grad, result);
+            return;
+        }
+
+        // tree-like reduction, every chunk is accumulated into its own partial sum in parallel and partial sums are added to result at the end.
+        // partial sums buffers are owned by plan so they are only allocated once
+        parallel_for((size_t)0, chunksNum, [&](size_t c)
+        {
+            Tensor& acc = c == 0 ? result : partials[c - 1];
+            if (c > 0)
+            {
+                acc.Resize(result.GetShape());
+                acc.Zero();
+            }
+
+            for (size_t i = c; i < grads.size(); i += chunksNum)
+                acc.Add(*grads[i], acc);
+        });
+
+        for (auto& partial : partials)
+            result.Add(partial, result);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::ComputeNodeGradient(GradientsPlan& plan, size_t n, bool concurrent)
+    {
+        auto node = plan.nodes[n];
+        GRAPH_DEBUG_INFO("##Graph: Computing gradient '%s'...\n", node->Name().c_str());
+
+        NVTXProfile nvtxProf(node->Name().c_str(), 0xFF4242FF);
+
+        auto& nodeOutputGrad = node->m_OutputGrad;
+        nodeOutputGrad.Resize(node->m_Output.GetShape());
+        if (nodeOutputGrad.TryDeviceAllocate())
+            nodeOutputGrad.OverrideDevice();
+        nodeOutputGrad.Zero(); // reset gradient
+
+        if (plan.is_loss[n])
+        {
+            // gradient of loss w.r.t to loss is 1
+            nodeOutputGrad.One();
+        }
+        else
+            SumGradients(plan.consumers_grads[n], plan.partial_grads[n], nodeOutputGrad, concurrent);
+
+        Operation* opNode = node->IsOp() ? static_cast<Operation*>(node) : nullptr;
+            
+        if (opNode)
+        {
+            NVTXProfile nvtxProf(node->Name().c_str(), 0xFFFF4242);
+            if (m_Profiler)
+                m_Profiler->ComputeGradient(opNode, nodeOutputGrad);
+            else
+                opNode->ComputeGradient(nodeOutputGrad);
+
+            if (Debug::ShouldLogGrad(node->Name()))
+            {
+                nodeOutputGrad.DebugDumpValues(node->Name() + "_output0_grad_step" + to_string(Debug::GetStep()) + ".log");
+                for (size_t i = 0; i < opNode->InputsGrads().size(); ++i)
                 {
-                    for (auto consumer : node->m_Consumers)
+                    if (opNode->InputNodes()[i]->CareAboutGradient())
+                        opNode->InputsGrads()[i].DebugDumpValues(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+                    else
                     {
-                        assert(consumer->IsOp());
-                        Operation* consumerOp = static_cast<Operation*>(consumer);
-
-                        // ignore consumer when it didn't affect loss. one example of such consumers might be accuracy operation
-                        if (nodesAffectingLosses.find(consumer) == nodesAffectingLosses.end())
-                            continue;
-
-                        auto& inputsGrad = consumerOp->InputsGrads();
-
-                        if (inputsGrad.size() == 1)
-                        {
-                            assert(inputsGrad[0].Length());
-                            nodeOutputGrad.Add(inputsGrad[0], nodeOutputGrad);
-                        }
-                        else
-                        {
-                            auto nodeIndexInConsumerInputs = distance(consumer->m_InputNodes.begin(), find(consumer->m_InputNodes.begin(), consumer->m_InputNodes.end(), node));
-                            auto& lossGradWrtNode = inputsGrad[nodeIndexInConsumerInputs];
-                            assert(lossGradWrtNode.Length());
-                            nodeOutputGrad.Add(lossGradWrtNode, nodeOutputGrad);
-                        }
+                        ofstream s(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+                        s << "doesn't care about gradient";
+                        s.close();
                     }
                 }
+            }
 
-                Operation* opNode = node->IsOp() ? static_cast<Operation*>(node) : nullptr;
-                
-                if (opNode)
-                {
-                    NVTXProfile nvtxProf((string("Compute grad ") + node->Name()).c_str(), 0xFF4242FF);
-                    opNode->ComputeGradient(nodeOutputGrad);
+            node->Output().DecRef(); // output is no longer needed, we've already used it to compute input gradients
+            node->OutputGrad().ReleaseData(); // output grad is no longer needed, we've already used it to compute input gradients
+        }
+        else
+        {
+            if (Debug::ShouldLogGrad(node->Name()))
+                nodeOutputGrad.DebugDumpValues(node->Name() + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+        }
 
-                    if (Debug::ShouldLogGrad(node->Name()))
-                    {
-                        nodeOutputGrad.DebugDumpValues(node->Name() + "_output0_grad_step" + to_string(Debug::GetStep()) + ".log");
-                        for (size_t i = 0; i < opNode->InputsGrads().size(); ++i)
-                        {
-                            if (opNode->InputNodes()[i]->CareAboutGradient())
-                                opNode->InputsGrads()[i].DebugDumpValues(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
-                            else
-                            {
-                                ofstream s(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
-                                s << "doesn't care about gradient";
-                                s.close();
-                            }
-                        }
-                    }
+        // all consumers contributing to this node's output grad can be notified so they can release their corresponding input gradient
+        for (auto consumerNode : node->m_Consumers)
+            consumerNode->InputGradConsumed(node);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    GraphOptimizationReport Graph::Optimize(const vector<TensorLike*>& fetches, int passes)
+    {
+        GraphOptimizationReport report;
+
+        // dead node elimination only considers operations that were part of optimized subgraph to begin with
+        vector<TensorLike*> order;
+        BuildForwardOrder(fetches, order);
+
+        if (passes & GO_ConstantFolding)
+            FoldConstants(fetches, report);
+        if (passes & GO_CommonSubexpressionElimination)
+            EliminateCommonSubexpressions(fetches, report);
+        if (passes & GO_ElementwiseFusion)
+            FuseElementwiseOperations(fetches, report);
+        if (passes & GO_DeadNodeElimination)
+            EliminateDeadNodes(fetches, order, report);
+
+        if (report.folded.empty() && report.merged.empty() && report.removed.empty() && report.fused.empty())
+            return report;
+
+        ++m_Version;
+
+        GRAPH_DEBUG_INFO("##Graph: Optimized\n%s", report.ToString().c_str());
+        return report;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::FoldConstants(const vector<TensorLike*>& fetches, GraphOptimizationReport& report)
+    {
+        vector<TensorLike*> order;
+        BuildForwardOrder(fetches, order);
+
+        unordered_set<TensorLike*> fetchesSet(fetches.begin(), fetches.end());
+        unordered_set<TensorLike*> foldable;
 
-                    node->Output().DecRef(); // output is no longer needed, we've already used it to compute input gradients
-                    node->OutputGrad().ReleaseData(); // output grad is no longer needed, we've already used it to compute input gradients
+        for (auto node : order)
+        {
+            // variables are never folded even when frozen since their values can still be loaded or assigned
+            if (node->IsConst())
+            {
+                foldable.insert(node);
+                continue;
+            }
+
+            if (!node->IsOp())
+                continue;
+
+            auto op = static_cast<Operation*>(node);
+            if (!op->IsDeterministic() || op->IsTrainingOp() || op->m_InputNodes.empty())
+                continue;
+
+            if (all_of(op->m_InputNodes.begin(), op->m_InputNodes.end(), [&](TensorLike* inputNode) { return foldable.find(inputNode) != foldable.end(); }))
+                foldable.insert(op);
+        }
+
+        // only the outermost operations of constant subgraphs have to be replaced, remaining ones will simply become dead
+        vector<Operation*> toFold;
+        for (auto node : order)
+        {
+            if (!node->IsOp() || foldable.find(node) == foldable.end() || fetchesSet.find(node) != fetchesSet.end())
+                continue;
+
+            bool hasNonFoldableConsumer = any_of(node->m_Consumers.begin(), node->m_Consumers.end(), [&](TensorLike* consumer)
+            {
+                return foldable.find(consumer) == foldable.end() || fetchesSet.find(consumer) != fetchesSet.end();
+            });
+
+            if (hasNonFoldableConsumer)
+                toFold.push_back(static_cast<Operation*>(node));
+        }
+
+        if (toFold.empty())
+            return;
+
+        for (auto node : order)
+        {
+            if (foldable.find(node) == foldable.end())
+                continue;
+
+            if (node->IsOp())
+            {
+                node->Output().ResetRef(1);
+                static_cast<Operation*>(node)->Compute(false);
+            }
+        }
+
+        for (auto op : toFold)
+        {
+            auto constant = new Constant(op->Output(), op->Name() + "/folded");
+            ReplaceNode(op, constant);
+            DetachOperation(op);
+            report.folded.push_back(make_pair(op->Name(), constant->Name()));
+        }
+
+        for (auto node : order)
+        {
+            if (node->IsOp() && foldable.find(node) != foldable.end())
+                node->Output().ReleaseData();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::EliminateCommonSubexpressions(const vector<TensorLike*>& fetches, GraphOptimizationReport& report)
+    {
+        vector<TensorLike*> order;
+        BuildForwardOrder(fetches, order);
+
+        unordered_set<TensorLike*> fetchesSet(fetches.begin(), fetches.end());
+        unordered_map<string, Operation*> uniqueOps;
+
+        // order is topological so inputs of every operation are already deduplicated when we get to it
+        for (auto node : order)
+        {
+            if (!node->IsOp())
+                continue;
+
+            auto op = static_cast<Operation*>(node);
+            if (!op->IsDeterministic() || op->IsTrainingOp())
+                continue;
+
+            stringstream key;
+            key.precision(numeric_limits<float>::max_digits10);
+            key << typeid(*op).name() << "|" << op->OpMode() << "|" << op->GetShape().ToString() << "|";
+            for (auto inputNode : op->m_InputNodes)
+                key << inputNode << " ";
+            key << "|";
+            op->WriteAttributes(key);
+
+            auto uniqueOpIt = uniqueOps.find(key.str());
+            if (uniqueOpIt == uniqueOps.end())
+            {
+                uniqueOps[key.str()] = op;
+                continue;
+            }
+
+            // fetched operations have to stay in graph
+            if (fetchesSet.find(op) != fetchesSet.end())
+                continue;
+
+            ReplaceNode(op, uniqueOpIt->second);
+            DetachOperation(op);
+            report.merged.push_back(make_pair(op->Name(), uniqueOpIt->second->Name()));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::EliminateDeadNodes(const vector<TensorLike*>& fetches, const vector<TensorLike*>& order, GraphOptimizationReport& report)
+    {
+        unordered_set<TensorLike*> fetchesSet(fetches.begin(), fetches.end());
+
+        // operations outside of optimized subgraph might be required by other fetches so they are left alone, only those left without
+        // any consumer after their consumers were replaced by other passes are removed. consumers come after their inputs in order so
+        // visiting it backwards removes whole dead subgraphs.
+        for (auto nodeIt = order.rbegin(); nodeIt != order.rend(); ++nodeIt)
+        {
+            auto node = *nodeIt;
+            if (!node->IsOp() || !node->m_Consumers.empty() || fetchesSet.find(node) != fetchesSet.end())
+                continue;
+
+            // operation might have been already detached by other pass
+            if (find(m_Operations.begin(), m_Operations.end(), node) == m_Operations.end())
+                continue;
+
+            DetachOperation(static_cast<Operation*>(node));
+            report.removed.push_back(node->Name());
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::FuseElementwiseOperations(const vector<TensorLike*>& fetches, GraphOptimizationReport& report)
+    {
+        vector<TensorLike*> order;
+        BuildForwardOrder(fetches, order);
+
+        unordered_set<TensorLike*> fetchesSet(fetches.begin(), fetches.end());
+        unordered_set<TensorLike*> fused;
+
+        auto getFusedInstruction = [](TensorLike* node, FusedInstruction& instruction)
+        {
+            return node->IsOp() && static_cast<Operation*>(node)->OpMode() != GPU && static_cast<Operation*>(node)->GetFusedInstruction(instruction);
+        };
+
+        // consumers are visited before their inputs so every region is grown from its outermost operation. fetched operations
+        // cannot be replaced so in their case only inputs can be fused
+        for (auto nodeIt = order.rbegin(); nodeIt != order.rend(); ++nodeIt)
+        {
+            auto root = *nodeIt;
+            FusedInstruction rootInstruction;
+            if (fused.find(root) != fused.end() || fetchesSet.find(root) != fetchesSet.end() || !getFusedInstruction(root, rootInstruction))
+                continue;
+
+            const Shape& elementsShape = rootInstruction.IsReduction() ? root->m_InputNodes[0]->GetShape() : root->GetShape();
+            EOpMode opMode = static_cast<Operation*>(root)->OpMode();
+
+            vector<Operation*> regionOps; // in post-order
+            vector<TensorLike*> inputs;
+
+            function<void(Operation*)> growRegion = [&](Operation* op)
+            {
+                for (auto inputNode : op->m_InputNodes)
+                {
+                    FusedInstruction instruction;
+                    bool canAbsorb = inputNode->m_Consumers.size() == 1 &&
+                                     fetchesSet.find(inputNode) == fetchesSet.end() &&
+                                     getFusedInstruction(inputNode, instruction) &&
+                                     !instruction.IsReduction() &&
+                                     static_cast<Operation*>(inputNode)->OpMode() == opMode &&
+                                     inputNode->GetShape() == elementsShape;
+
+                    if (canAbsorb)
+                        growRegion(static_cast<Operation*>(inputNode));
+                    else if (find(inputs.begin(), inputs.end(), inputNode) == inputs.end())
+                        inputs.push_back(inputNode);
                 }
-                else
+                regionOps.push_back(op);
+            };
+            growRegion(static_cast<Operation*>(root));
+
+            if (regionOps.size() < 2)
+                continue;
+
+            // inputs are broadcast by fused kernel on every run so only their current shapes have to be compatible
+            bool inputsValid = all_of(inputs.begin(), inputs.end(), [&](TensorLike* input)
+            {
+                for (int a = 0; a < 4; ++a)
                 {
-                    if (Debug::ShouldLogGrad(node->Name()))
-                        nodeOutputGrad.DebugDumpValues(node->Name() + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+                    if (input->GetShape().Dimensions[a] != elementsShape.Dimensions[a] && input->GetShape().Dimensions[a] != 1)
+                        return false;
                 }
+                return true;
+            });
+            if (!inputsValid)
+                continue;
+
+            unordered_map<TensorLike*, int> registers;
+            for (size_t i = 0; i < inputs.size(); ++i)
+                registers[inputs[i]] = (int)i;
+
+            vector<FusedInstruction> program;
+            for (auto op : regionOps)
+            {
+                FusedInstruction instruction;
+                op->GetFusedInstruction(instruction);
+                instruction.a = registers[op->m_InputNodes[0]];
+                if (op->m_InputNodes.size() > 1)
+                    instruction.b = registers[op->m_InputNodes[1]];
+                if (!instruction.IsReduction())
+                    registers[op] = (int)(inputs.size() + program.size());
+                program.push_back(instruction);
+            }
+
+            auto fusedOp = new FusedElementwiseOp(inputs, program, opMode, root->Name() + "/fused");
+            ReplaceNode(root, fusedOp);
+
+            for (auto op : regionOps)
+            {
+                DetachOperation(op);
+                fused.insert(op);
+                report.fused.push_back(make_pair(op->Name(), fusedOp->Name()));
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::ReplaceNode(TensorLike* node, TensorLike* replacement)
+    {
+        // consumer using node multiple times is listed once per input, each entry is moved to replacement
+        for (auto consumer : node->m_Consumers)
+        {
+            for (size_t i = 0; i < consumer->m_InputNodes.size(); ++i)
+            {
+                if (consumer->m_InputNodes[i] != node)
+                    continue;
+
+                consumer->m_InputNodes[i] = replacement;
+                if (consumer->IsOp())
+                    static_cast<Operation*>(consumer)->m_Inputs[i] = replacement->OutputPtr();
             }
 
-            // all consumers contributing to this node's output grad can be notified so they can release their corresponding input gradient
-            for (auto consumerNode : node->m_Consumers)
-                consumerNode->InputGradConsumed(node);
+            replacement->m_Consumers.push_back(consumer);
+            consumer->RefreshCareAboutGradient();
+        }
+
+        node->m_Consumers.clear();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::DetachOperation(Operation* op)
+    {
+        for (auto inputNode : op->m_InputNodes)
+        {
+            auto& consumers = inputNode->m_Consumers;
+            auto consumerIt = find(consumers.begin(), consumers.end(), op);
+            if (consumerIt != consumers.end())
+                consumers.erase(consumerIt);
         }
 
-        return variables;
+        op->m_Output.ReleaseData();
+        op->m_OutputGrad.ReleaseData();
+
+        m_Operations.erase(remove(m_Operations.begin(), m_Operations.end(), op), m_Operations.end());
+        m_Nodes.erase(remove(m_Nodes.begin(), m_Nodes.end(), op), m_Nodes.end());
+        m_DetachedNodes.push_back(op);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string GraphOptimizationReport::ToString() const
+    {
+        stringstream ss;
+        ss << "Folded: " << folded.size() << ", merged: " << merged.size() << ", removed: " << removed.size() << ", fused: " << fused.size() << "\n";
+        for (auto& entry : folded)
+            ss << "  folded '" << entry.first << "' into '" << entry.second << "'\n";
+        for (auto& entry : merged)
+            ss << "  merged '" << entry.first << "' into '" << entry.second << "'\n";
+        for (auto& name : removed)
+            ss << "  removed '" << name << "'\n";
+        for (auto& entry : fused)
+            ss << "  fused '" << entry.first << "' into '" << entry.second << "'\n";
+        return ss.str();
     }
 
     //////////////////////////////////////////////////////////////////////////
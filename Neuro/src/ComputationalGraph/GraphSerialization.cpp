@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <typeinfo>
+#include <typeindex>
+#include <functional>
+#include <unordered_map>
+#include <cstring>
+
+#include "ComputationalGraph/Graph.h"
+#include "ComputationalGraph/TensorLike.h"
+#include "ComputationalGraph/Placeholder.h"
+#include "ComputationalGraph/Variable.h"
+#include "ComputationalGraph/Constant.h"
+#include "ComputationalGraph/Operation.h"
+#include "ComputationalGraph/Ops.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
+#include "Tensors/Tensor.h"
+#include "Tensors/TensorOpCpu.h"
+#include "Initializers/Const.h"
+#include "Initializers/Zeros.h"
+#include "Initializers/Normal.h"
+#include "Initializers/Uniform.h"
+#include "Initializers/VarianceScaling.h"
+#include "Initializers/GlorotNormal.h"
+#include "Initializers/GlorotUniform.h"
+#include "Initializers/HeNormal.h"
+#include "Initializers/HeUniform.h"
+#include "Initializers/LeCunNormal.h"
+#include "Initializers/LeCunUniform.h"
+
+namespace Neuro
+{
+    // Serialized graph file layout (little-endian):
+    // header: magic, uint32 version, uint32 number of nodes
+    // nodes in forward order: uint8 kind, name, uint32 dimensions[4] and kind specific data:
+    //   variable: uint8 trainable, uint8 embedded values flag, values when embedded otherwise initializer type name and its attributes
+    //   constant: values
+    //   operation: type name, attributes as written by WriteAttributes, uint32 number of inputs, uint32 input node indices
+    // footer: uint32 number of inputs, input node indices, uint32 number of outputs, output node indices
+    // strings are stored as uint32 length followed by characters
+    static const char GRAPH_MAGIC[] = "NEUROGRF";
+    static const uint32_t GRAPH_VERSION = 3;
+
+    enum ESerializedNode : uint8_t
+    {
+        SN_Placeholder,
+        SN_Variable,
+        SN_Constant,
+        SN_Operation,
+    };
+
+    // Recreates operation from its inputs and attributes written by Operation::WriteAttributes
+    typedef function<Operation*(const vector<TensorLike*>& inputs, istream& attributes, const string& name)> op_factory_t;
+
+    //////////////////////////////////////////////////////////////////////////
+    template<typename T> static T ReadAttribute(istream& stream)
+    {
+        T value;
+        stream >> value;
+        return value;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    template<typename E> static E ReadEnumAttribute(istream& stream)
+    {
+        return (E)ReadAttribute<int>(stream);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static Shape ReadShapeAttribute(istream& stream)
+    {
+        // written by Shape::ToString in (w, h, d, n) form
+        char separator;
+        uint32_t w, h, d, n;
+        stream >> separator >> w >> separator >> h >> separator >> d >> separator >> n >> separator;
+        return Shape(w, h, d, n);
+    }
+
+    // Operations are identified in files by explicit names so files don't depend on compiler specific type names
+    struct OpRegistry
+    {
+        template<typename T> void Add(const string& typeName, const op_factory_t& factory)
+        {
+            factories[typeName] = factory;
+            typeNames[type_index(typeid(T))] = typeName;
+        }
+
+        unordered_map<string, op_factory_t> factories;
+        unordered_map<type_index, string> typeNames;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    static OpRegistry CreateOpRegistry()
+    {
+        OpRegistry registry;
+
+        registry.Add<AbsOp>("AbsOp", [](auto& in, auto& attr, auto& name) { return new AbsOp(in[0], name); });
+        registry.Add<AccuracyOp>("AccuracyOp", [](auto& in, auto& attr, auto& name) { return new AccuracyOp(in[0], in[1], name); });
+        registry.Add<BinaryAccuracyOp>("BinaryAccuracyOp", [](auto& in, auto& attr, auto& name) { return new BinaryAccuracyOp(in[0], in[1], name); });
+        registry.Add<AddOp>("AddOp", [](auto& in, auto& attr, auto& name) { return in.size() == 2 ? new AddOp(in[0], in[1], name) : new AddOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<AssignOp>("AssignOp", [](auto& in, auto& attr, auto& name) { return new AssignOp(in[0], in[1], name); });
+        registry.Add<BatchFlattenOp>("BatchFlattenOp", [](auto& in, auto& attr, auto& name) { return new BatchFlattenOp(in[0], name); });
+        registry.Add<BatchNormalizeOp>("BatchNormalizeOp", [](auto& in, auto& attr, auto& name)
+        {
+            float momentum = ReadAttribute<float>(attr);
+            float epsilon = ReadAttribute<float>(attr);
+            return new BatchNormalizeOp(in[0], in[1], in[2], in[3], in[4], momentum, epsilon, name);
+        });
+        registry.Add<BatchReshapeOp>("BatchReshapeOp", [](auto& in, auto& attr, auto& name) { return new BatchReshapeOp(in[0], ReadShapeAttribute(attr), name); });
+        registry.Add<ClipOp>("ClipOp", [](auto& in, auto& attr, auto& name)
+        {
+            float min = ReadAttribute<float>(attr);
+            float max = ReadAttribute<float>(attr);
+            return new ClipOp(in[0], min, max, name);
+        });
+        registry.Add<ConcatenateOp>("ConcatenateOp", [](auto& in, auto& attr, auto& name) { return new ConcatenateOp(in, ReadEnumAttribute<EAxis>(attr), name); });
+        registry.Add<Conv2dOp>("Conv2dOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t stride = ReadAttribute<uint32_t>(attr);
+            uint32_t padding = ReadAttribute<uint32_t>(attr);
+            return new Conv2dOp(in[0], in[1], stride, padding, ReadEnumAttribute<EDataFormat>(attr), name);
+        });
+        registry.Add<Conv2dBiasActivationOp>("Conv2dBiasActivationOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t stride = ReadAttribute<uint32_t>(attr);
+            uint32_t padding = ReadAttribute<uint32_t>(attr);
+            EActivation activation = ReadEnumAttribute<EActivation>(attr);
+            return new Conv2dBiasActivationOp(in[0], in[1], stride, padding, in[2], activation, ReadAttribute<float>(attr), name);
+        });
+        registry.Add<Conv2dTransposeOp>("Conv2dTransposeOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t stride = ReadAttribute<uint32_t>(attr);
+            uint32_t padding = ReadAttribute<uint32_t>(attr);
+            return new Conv2dTransposeOp(in[0], in[1], stride, padding, ReadEnumAttribute<EDataFormat>(attr), name);
+        });
+        registry.Add<DivideOp>("DivideOp", [](auto& in, auto& attr, auto& name) { return in.size() == 2 ? new DivideOp(in[0], in[1], name) : new DivideOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<DropoutOp>("DropoutOp", [](auto& in, auto& attr, auto& name) { return new DropoutOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<DumpOp>("DumpOp", [](auto& in, auto& attr, auto& name) { return new DumpOp(in[0], name); });
+        registry.Add<EluOp>("EluOp", [](auto& in, auto& attr, auto& name) { return new EluOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<ExpOp>("ExpOp", [](auto& in, auto& attr, auto& name) { return new ExpOp(in[0], name); });
+        registry.Add<ExtractSubTensorOp>("ExtractSubTensorOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t width = ReadAttribute<uint32_t>(attr);
+            uint32_t height = ReadAttribute<uint32_t>(attr);
+            uint32_t widthOffset = ReadAttribute<uint32_t>(attr);
+            uint32_t heightOffset = ReadAttribute<uint32_t>(attr);
+            return new ExtractSubTensorOp(in[0], width, height, widthOffset, heightOffset, ReadAttribute<bool>(attr), name);
+        });
+        registry.Add<FusedElementwiseOp>("FusedElementwiseOp", [](auto& in, auto& attr, auto& name)
+        {
+            vector<FusedInstruction> program;
+            int op;
+            while (attr >> op)
+            {
+                FusedInstruction instr((EFusedOp)op);
+                attr >> instr.val >> instr.a >> instr.b;
+                program.push_back(instr);
+            }
+            // fused operations are CPU-only
+            EOpMode opMode = Tensor::ActiveOp()->OpMode() == GPU ? CPU_MT : Tensor::ActiveOp()->OpMode();
+            return new FusedElementwiseOp(in, program, opMode, name);
+        });
+        registry.Add<IdentityOp>("IdentityOp", [](auto& in, auto& attr, auto& name) { return new IdentityOp(in[0], name); });
+        registry.Add<InstanceNormalizeOp>("InstanceNormalizeOp", [](auto& in, auto& attr, auto& name) { return new InstanceNormalizeOp(in[0], in[1], in[2], ReadAttribute<float>(attr), name); });
+        registry.Add<LeakyReLUOp>("LeakyReLUOp", [](auto& in, auto& attr, auto& name) { return new LeakyReLUOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<LogOp>("LogOp", [](auto& in, auto& attr, auto& name) { return new LogOp(in[0], name); });
+        registry.Add<MatMulOp>("MatMulOp", [](auto& in, auto& attr, auto& name) { return new MatMulOp(in[0], in[1], name); });
+        registry.Add<MatMulTransOp>("MatMulTransOp", [](auto& in, auto& attr, auto& name)
+        {
+            bool transposeA = ReadAttribute<bool>(attr);
+            bool transposeB = ReadAttribute<bool>(attr);
+            return new MatMulTransOp(in[0], transposeA, in[1], transposeB, name);
+        });
+        registry.Add<MatMulSyrkOp>("MatMulSyrkOp", [](auto& in, auto& attr, auto& name) { return new MatMulSyrkOp(in[0], ReadAttribute<bool>(attr), name); });
+        registry.Add<MeanOp>("MeanOp", [](auto& in, auto& attr, auto& name) { return new MeanOp(in[0], ReadEnumAttribute<EAxis>(attr), name); });
+        registry.Add<MergeOp>("MergeOp", [](auto& in, auto& attr, auto& name) { return new MergeOp(in, ReadEnumAttribute<EMergeMode>(attr), name); });
+        registry.Add<MultiplyOp>("MultiplyOp", [](auto& in, auto& attr, auto& name) { return in.size() == 2 ? new MultiplyOp(in[0], in[1], name) : new MultiplyOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<NegativeOp>("NegativeOp", [](auto& in, auto& attr, auto& name) { return new NegativeOp(in[0], name); });
+        registry.Add<NormalizeGradientOp>("NormalizeGradientOp", [](auto& in, auto& attr, auto& name)
+        {
+            size_t order = (size_t)ReadAttribute<float>(attr);
+            return new NormalizeGradientOp(in[0], order, ReadAttribute<float>(attr), name);
+        });
+        registry.Add<Pad2dOp>("Pad2dOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t left = ReadAttribute<uint32_t>(attr), right = ReadAttribute<uint32_t>(attr), top = ReadAttribute<uint32_t>(attr), bottom = ReadAttribute<uint32_t>(attr);
+            return new Pad2dOp(in[0], left, right, top, bottom, name);
+        });
+        registry.Add<ConstantPad2dOp>("ConstantPad2dOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t left = ReadAttribute<uint32_t>(attr), right = ReadAttribute<uint32_t>(attr), top = ReadAttribute<uint32_t>(attr), bottom = ReadAttribute<uint32_t>(attr);
+            return new ConstantPad2dOp(in[0], left, right, top, bottom, ReadAttribute<float>(attr), name);
+        });
+        registry.Add<ReflectPad2dOp>("ReflectPad2dOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t left = ReadAttribute<uint32_t>(attr), right = ReadAttribute<uint32_t>(attr), top = ReadAttribute<uint32_t>(attr), bottom = ReadAttribute<uint32_t>(attr);
+            return new ReflectPad2dOp(in[0], left, right, top, bottom, name);
+        });
+        registry.Add<Pool2dOp>("Pool2dOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t filterSize = ReadAttribute<uint32_t>(attr);
+            uint32_t stride = ReadAttribute<uint32_t>(attr);
+            uint32_t padding = ReadAttribute<uint32_t>(attr);
+            EPoolingMode mode = ReadEnumAttribute<EPoolingMode>(attr);
+            return new Pool2dOp(in[0], filterSize, stride, padding, mode, ReadEnumAttribute<EDataFormat>(attr), name);
+        });
+        registry.Add<PowOp>("PowOp", [](auto& in, auto& attr, auto& name) { return in.size() == 2 ? new PowOp(in[0], in[1], name) : new PowOp(in[0], ReadAttribute<float>(attr), name); });
+        registry.Add<ReLUOp>("ReLUOp", [](auto& in, auto& attr, auto& name) { return new ReLUOp(in[0], name); });
+        registry.Add<ReshapeOp>("ReshapeOp", [](auto& in, auto& attr, auto& name) { return new ReshapeOp(in[0], ReadShapeAttribute(attr), name); });
+        registry.Add<RollOp>("RollOp", [](auto& in, auto& attr, auto& name)
+        {
+            if (in.size() == 3)
+                return new RollOp(in[0], in[1], in[2], name);
+            int rollX = ReadAttribute<int>(attr);
+            return new RollOp(in[0], rollX, ReadAttribute<int>(attr), name);
+        });
+        registry.Add<RandomRollOp>("RandomRollOp", [](auto& in, auto& attr, auto& name) { return new RandomRollOp(in[0], ReadAttribute<uint32_t>(attr), name); });
+        registry.Add<SigmoidOp>("SigmoidOp", [](auto& in, auto& attr, auto& name) { return new SigmoidOp(in[0], name); });
+        registry.Add<SoftmaxOp>("SoftmaxOp", [](auto& in, auto& attr, auto& name) { return new SoftmaxOp(in[0], name); });
+        registry.Add<SqrtOp>("SqrtOp", [](auto& in, auto& attr, auto& name) { return new SqrtOp(in[0], name); });
+        registry.Add<SubTensor2dOp>("SubTensor2dOp", [](auto& in, auto& attr, auto& name)
+        {
+            uint32_t width = ReadAttribute<uint32_t>(attr);
+            uint32_t height = ReadAttribute<uint32_t>(attr);
+            uint32_t widthOffset = ReadAttribute<uint32_t>(attr);
+            return new SubTensor2dOp(in[0], width, height, widthOffset, ReadAttribute<uint32_t>(attr), name);
+        });
+        registry.Add<SubtractOp>("SubtractOp", [](auto& in, auto& attr, auto& name) { return new SubtractOp(in[0], in[1], name); });
+        registry.Add<SumOp>("SumOp", [](auto& in, auto& attr, auto& name) { return new SumOp(in[0], ReadEnumAttribute<EAxis>(attr), name); });
+        registry.Add<SwapRedBlueChannelsOp>("SwapRedBlueChannelsOp", [](auto& in, auto& attr, auto& name) { return new SwapRedBlueChannelsOp(in[0], name); });
+        registry.Add<TanHOp>("TanHOp", [](auto& in, auto& attr, auto& name) { return new TanHOp(in[0], name); });
+        registry.Add<TransposeOp>("TransposeOp", [](auto& in, auto& attr, auto& name)
+        {
+            vector<EAxis> permutation;
+            int axis;
+            while (attr >> axis)
+                permutation.push_back((EAxis)axis);
+            return new TransposeOp(in[0], permutation, name);
+        });
+        registry.Add<UpSample2dOp>("UpSample2dOp", [](auto& in, auto& attr, auto& name) { return new UpSample2dOp(in[0], ReadAttribute<int>(attr), name); });
+
+        return registry;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static const OpRegistry& Ops()
+    {
+        static const OpRegistry registry = CreateOpRegistry();
+        return registry;
+    }
+
+    // Recreates initializer from attributes written by InitializerBase::WriteAttributes
+    typedef function<InitializerBase*(istream& attributes)> initializer_factory_t;
+
+    struct InitializerRegistry
+    {
+        template<typename T> void Add(const string& typeName, const initializer_factory_t& factory)
+        {
+            factories[typeName] = factory;
+            typeNames[type_index(typeid(T))] = typeName;
+        }
+
+        // Presets only differ by arguments passed to their base class so they are restored as base class
+        template<typename T> void AddPreset(const string& baseTypeName)
+        {
+            typeNames[type_index(typeid(T))] = baseTypeName;
+        }
+
+        unordered_map<string, initializer_factory_t> factories;
+        unordered_map<type_index, string> typeNames;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    static InitializerRegistry CreateInitializerRegistry()
+    {
+        InitializerRegistry registry;
+
+        registry.Add<Const>("Const", [](auto& attr) { return new Const(ReadAttribute<float>(attr)); });
+        registry.Add<Zeros>("Zeros", [](auto& attr) { return new Zeros(); });
+        registry.Add<Normal>("Normal", [](auto& attr)
+        {
+            float mean = ReadAttribute<float>(attr);
+            float variance = ReadAttribute<float>(attr);
+            return new Normal(mean, variance, ReadAttribute<float>(attr));
+        });
+        registry.Add<Uniform>("Uniform", [](auto& attr)
+        {
+            float min = ReadAttribute<float>(attr);
+            return new Uniform(min, ReadAttribute<float>(attr));
+        });
+        registry.Add<VarianceScaling>("VarianceScaling", [](auto& attr)
+        {
+            float scale = ReadAttribute<float>(attr);
+            EFanMode mode = ReadEnumAttribute<EFanMode>(attr);
+            return new VarianceScaling(scale, mode, ReadEnumAttribute<EDistribution>(attr));
+        });
+        registry.AddPreset<GlorotNormal>("VarianceScaling");
+        registry.AddPreset<GlorotUniform>("VarianceScaling");
+        registry.AddPreset<HeNormal>("VarianceScaling");
+        registry.AddPreset<HeUniform>("VarianceScaling");
+        registry.AddPreset<LeCunNormal>("VarianceScaling");
+        registry.AddPreset<LeCunUniform>("VarianceScaling");
+
+        return registry;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static const InitializerRegistry& Initializers()
+    {
+        static const InitializerRegistry registry = CreateInitializerRegistry();
+        return registry;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::Save(const string& filename, const vector<Placeholder*>& inputs, const vector<TensorLike*>& outputs, bool saveWeights)
+    {
+        vector<TensorLike*> order;
+        bool hasTrainingOps = BuildForwardOrder(outputs, order);
+        NEURO_ASSERT(!hasTrainingOps, "Graph containing training operations cannot be saved.");
+        if (hasTrainingOps)
+            return;
+
+        // inputs not contributing to any output still have to be restored
+        for (auto input : inputs)
+        {
+            if (find(order.begin(), order.end(), input) == order.end())
+                order.insert(order.begin(), input);
+        }
+
+        unordered_map<TensorLike*, uint32_t> nodeIdx;
+        for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+            nodeIdx[order[i]] = i;
+
+        ofstream stream(filename, ios::out | ios::binary);
+        auto writeU32 = [&](uint32_t value) { stream.write((const char*)&value, sizeof(value)); };
+        auto writeU8 = [&](uint8_t value) { stream.write((const char*)&value, sizeof(value)); };
+        auto writeString = [&](const string& str) { writeU32((uint32_t)str.length()); stream.write(str.c_str(), str.length()); };
+        auto writeValues = [&](const Tensor& t) { stream.write((const char*)t.Values(), t.Length() * sizeof(float)); };
+
+        stream.write(GRAPH_MAGIC, sizeof(GRAPH_MAGIC) - 1);
+        writeU32(GRAPH_VERSION);
+        writeU32((uint32_t)order.size());
+
+        for (auto node : order)
+        {
+            node->Output().SyncToHost();
+
+            if (node->IsPlaceholder())
+                writeU8(SN_Placeholder);
+            else if (node->IsVar())
+                writeU8(SN_Variable);
+            else if (node->IsConst())
+                writeU8(SN_Constant);
+            else
+                writeU8(SN_Operation);
+
+            writeString(node->Name());
+            node->GetShape().SaveBin(stream);
+
+            if (node->IsVar())
+            {
+                auto var = static_cast<Variable*>(node);
+                writeU8(var->Trainable() ? 1 : 0);
+
+                // variables without initializer which can be recreated always have their values embedded
+                auto initializer = var->Initializer();
+                auto typeNameIt = initializer ? Initializers().typeNames.find(type_index(typeid(*initializer))) : Initializers().typeNames.end();
+                bool embedded = saveWeights || typeNameIt == Initializers().typeNames.end();
+
+                writeU8(embedded ? 1 : 0);
+                if (embedded)
+                    writeValues(node->Output());
+                else
+                {
+                    stringstream attributes;
+                    attributes.precision(numeric_limits<float>::max_digits10);
+                    initializer->WriteAttributes(attributes);
+
+                    writeString(typeNameIt->second);
+                    writeString(attributes.str());
+                }
+            }
+            else if (node->IsConst())
+                writeValues(node->Output());
+            else if (node->IsOp())
+            {
+                auto op = static_cast<Operation*>(node);
+                auto typeNameIt = Ops().typeNames.find(type_index(typeid(*op)));
+                NEURO_ASSERT(typeNameIt != Ops().typeNames.end(), "Operation '" << op->Name() << "' of type '" << typeid(*op).name() << "' cannot be serialized.");
+
+                stringstream attributes;
+                attributes.precision(numeric_limits<float>::max_digits10);
+                op->WriteAttributes(attributes);
+
+                writeString(typeNameIt->second);
+                writeString(attributes.str());
+                writeU32((uint32_t)op->InputNodes().size());
+                for (auto inputNode : op->InputNodes())
+                    writeU32(nodeIdx[inputNode]);
+            }
+        }
+
+        writeU32((uint32_t)inputs.size());
+        for (auto input : inputs)
+            writeU32(nodeIdx[input]);
+        writeU32((uint32_t)outputs.size());
+        for (auto output : outputs)
+            writeU32(nodeIdx[output]);
+
+        stream.close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    LoadedGraph Graph::Load(const string& filename)
+    {
+        NEURO_ASSERT(this == Default(), "Graph can only be loaded into default graph.");
+
+        LoadedGraph result;
+
+        ifstream stream(filename, ios::in | ios::binary);
+        char magic[sizeof(GRAPH_MAGIC) - 1] = {};
+        stream.read(magic, sizeof(magic));
+        NEURO_ASSERT(stream && memcmp(magic, GRAPH_MAGIC, sizeof(magic)) == 0, "File '" << filename << "' doesn't contain serialized graph.");
+        if (!stream || memcmp(magic, GRAPH_MAGIC, sizeof(magic)) != 0)
+            return result;
+
+        auto readU32 = [&]() { uint32_t value = 0; stream.read((char*)&value, sizeof(value)); return value; };
+        auto readU8 = [&]() { uint8_t value = 0; stream.read((char*)&value, sizeof(value)); return value; };
+        auto readString = [&]() { string str(readU32(), '\0'); if (!str.empty()) stream.read(&str[0], str.length()); return str; };
+        auto readValues = [&](Tensor& t) { t.OverrideHost(); stream.read((char*)t.Values(), t.Length() * sizeof(float)); };
+
+        uint32_t version = readU32();
+        NEURO_ASSERT(version == GRAPH_VERSION, "Unsupported serialized graph version " << version << ".");
+        if (version != GRAPH_VERSION)
+            return result;
+
+        uint32_t nodesNum = readU32();
+        auto& order = result.order;
+        order.reserve(nodesNum);
+
+        vector<TensorLike*> inputs;
+        for (uint32_t n = 0; n < nodesNum; ++n)
+        {
+            ESerializedNode kind = (ESerializedNode)readU8();
+            string name = readString();
+            Shape shape(stream);
+
+            if (kind == SN_Placeholder)
+                order.push_back(new Placeholder(shape, name));
+            else if (kind == SN_Variable)
+            {
+                bool trainable = readU8() != 0;
+                bool embedded = readU8() != 0;
+                Variable* var = nullptr;
+                if (embedded)
+                {
+                    var = new Variable(shape, nullptr, name);
+                    readValues(var->Output());
+                    var->ForceInitialized();
+                }
+                else
+                {
+                    string type = readString();
+                    istringstream attributes(readString());
+
+                    auto factoryIt = Initializers().factories.find(type);
+                    NEURO_ASSERT(factoryIt != Initializers().factories.end(), "Unknown initializer type '" << type << "' of '" << name << "'.");
+                    // variable is initialized like a freshly constructed one on first run
+                    var = new Variable(shape, factoryIt != Initializers().factories.end() ? factoryIt->second(attributes) : nullptr, name);
+                }
+                var->SetTrainable(trainable);
+                order.push_back(var);
+            }
+            else if (kind == SN_Constant)
+            {
+                Tensor value(shape);
+                readValues(value);
+                order.push_back(new Constant(value, name));
+            }
+            else
+            {
+                string type = readString();
+                istringstream attributes(readString());
+
+                inputs.resize(readU32());
+                for (auto& input : inputs)
+                    input = order[readU32()];
+
+                auto factoryIt = Ops().factories.find(type);
+                NEURO_ASSERT(factoryIt != Ops().factories.end(), "Unknown operation type '" << type << "' of '" << name << "'.");
+                auto op = factoryIt->second(inputs, attributes, name);
+                // saved shape is only used to detect incompatible changes in operations
+                NEURO_ASSERT(op->UndeterminedOutputShape() || op->GetShape() == shape, "Restored operation '" << name << "' shape " << op->GetShape().ToString() << " doesn't match saved shape " << shape.ToString() << ".");
+                order.push_back(op);
+            }
+        }
+
+        result.inputs.resize(readU32());
+        for (auto& input : result.inputs)
+            input = static_cast<Placeholder*>(order[readU32()]);
+        result.outputs.resize(readU32());
+        for (auto& output : result.outputs)
+            output = order[readU32()];
+
+        NEURO_ASSERT(stream, "Serialized graph file '" << filename << "' is truncated.");
+        return result;
+    }
+}
@@ -1,4 +1,10 @@
-﻿#include "ComputationalGraph/Operation.h"
+﻿#include <cstdlib>
+#include <typeinfo>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+#include "ComputationalGraph/Operation.h"
 #include "ComputationalGraph/Graph.h"
 #include "Tensors/Tensor.h"
 #include "Tensors/TensorOpCpu.h"
@@ -121,6 +127,39 @@ namespace Neuro
         return m_InputsGradsPtrs;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    uint64_t Operation::EstimateFlops(bool gradient) const
+    {
+        if (!gradient)
+            return m_Output.Length();
+
+        uint64_t flops = 0;
+        for (auto input : m_Inputs)
+            flops += input->Length();
+        return flops;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string Operation::TypeName() const
+    {
+        string name = typeid(*this).name();
+#ifdef __GNUC__
+        // GCC and Clang return mangled names
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+        if (status == 0 && demangled)
+            name = demangled;
+        free(demangled);
+#endif
+        // MSVC names look like 'class Neuro::MatMulOp' while demangled ones look like 'Neuro::MatMulOp'
+        name = name.substr(0, name.find('<'));
+        size_t pos = name.rfind("::");
+        if (pos != string::npos)
+            return name.substr(pos + 2);
+        pos = name.rfind(' ');
+        return pos != string::npos ? name.substr(pos + 1) : name;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Operation::RefreshCareAboutGradient()
     {
@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/AbsOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -22,4 +23,11 @@ namespace Neuro
         if (m_InputNodes[0]->CareAboutGradient())
             grad.AbsGradient(*m_Inputs[0], grad, m_InputsGrads[0]);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool AbsOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = FusedInstruction(FO_Abs);
+        return true;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 ﻿#include <algorithm>
 #include "ComputationalGraph/Operations/AddOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {        
@@ -90,4 +91,11 @@ namespace Neuro
                 progressGrad(1);
         }
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool AddOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = m_InputNodes.size() == 1 ? FusedInstruction(FO_AddScalar, m_Val) : FusedInstruction(FO_Add);
+        return true;
+    }
 }
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "ComputationalGraph/Operations/DivideOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -99,4 +100,11 @@ namespace Neuro
             }
         }
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool DivideOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = m_InputNodes.size() == 1 ? FusedInstruction(FO_DivScalar, m_Val) : FusedInstruction(FO_Div);
+        return true;
+    }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/ExpOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -23,4 +24,11 @@ namespace Neuro
         if (m_InputNodes[0]->CareAboutGradient())
             grad.MulElem(m_Output, m_InputsGrads[0]);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ExpOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = FusedInstruction(FO_Exp);
+        return true;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include <ppl.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
+
+namespace Neuro
+{
+    using namespace concurrency;
+
+    static const uint32_t FUSED_BLOCK_SIZE = 4096;
+
+    //////////////////////////////////////////////////////////////////////////
+    FusedElementwiseOp::FusedElementwiseOp(const vector<TensorLike*>& inputs, const vector<FusedInstruction>& program, EOpMode opMode, const string& name)
+        : Operation(inputs, name.empty() ? "fused_elementwise" : name), m_Program(program)
+    {
+        NEURO_ASSERT(opMode != GPU, "Fused elementwise operation is not supported on GPU.");
+        m_OpMode = opMode;
+        m_Output.SetStorageType(ST_RefCounted);
+
+        m_ElementwiseCount = m_Program.size();
+        if (!m_Program.empty() && m_Program.back().IsReduction())
+            --m_ElementwiseCount;
+        m_RegistersCount = m_InputNodes.size() + m_ElementwiseCount;
+
+        UpdateOutputShape();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::WriteAttributes(ostream& stream) const
+    {
+        for (auto& instr : m_Program)
+            stream << instr.op << " " << instr.val << " " << instr.a << " " << instr.b << " ";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    template<typename T>
+    static Shape BroadcastShape(const vector<T*>& inputs)
+    {
+        uint32_t dims[4] = { 1, 1, 1, 1 };
+        for (auto input : inputs)
+        {
+            for (int a = 0; a < 4; ++a)
+                dims[a] = max(dims[a], input->GetShape().Dimensions[a]);
+        }
+        return Shape(dims[0], dims[1], dims[2], dims[3]);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::UpdateOutputShape()
+    {
+        if (m_ElementwiseCount < m_Program.size())
+            m_Output.Resize(Shape(1, 1, 1, 1));
+        else
+            m_Output.Resize(BroadcastShape(m_InputNodes));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::GatherInputsData()
+    {
+        // shapes are only known at this point since batch size (or any other dimension) might have changed since operation was created
+        m_ElementsShape = BroadcastShape(m_Inputs);
+        m_InputsView.resize(m_Inputs.size());
+
+        for (size_t i = 0; i < m_Inputs.size(); ++i)
+        {
+            const Shape& shape = m_Inputs[i]->GetShape();
+            auto& view = m_InputsView[i];
+            view.data = m_Inputs[i]->Values();
+            view.full = shape.Length == m_ElementsShape.Length;
+
+            for (int a = 0; a < 4; ++a)
+            {
+                NEURO_ASSERT(shape.Dimensions[a] == m_ElementsShape.Dimensions[a] || shape.Dimensions[a] == 1, "Fused input '" << m_InputNodes[i]->Name() << "' " << shape.ToString() << " cannot be broadcast to " << m_ElementsShape.ToString() << ".");
+                view.stride[a] = shape.Dimensions[a] == 1 ? 0 : shape.Stride[a];
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::Evaluate(uint32_t e, float* regs, uint32_t* offsets) const
+    {
+        const size_t inputsCount = m_InputsView.size();
+        uint32_t w = 0, h = 0, d = 0, b = 0;
+        bool coordsReady = false;
+
+        for (size_t i = 0; i < inputsCount; ++i)
+        {
+            const auto& view = m_InputsView[i];
+            if (view.full)
+                offsets[i] = e;
+            else
+            {
+                if (!coordsReady)
+                {
+                    w = e % m_ElementsShape.Width();
+                    h = (e / m_ElementsShape.Stride[1]) % m_ElementsShape.Height();
+                    d = (e / m_ElementsShape.Stride[2]) % m_ElementsShape.Depth();
+                    b = e / m_ElementsShape.Stride[3];
+                    coordsReady = true;
+                }
+                offsets[i] = w * view.stride[0] + h * view.stride[1] + d * view.stride[2] + b * view.stride[3];
+            }
+            regs[i] = view.data[offsets[i]];
+        }
+
+        for (size_t n = 0; n < m_ElementwiseCount; ++n)
+        {
+            const auto& instr = m_Program[n];
+            const float a = regs[instr.a];
+            float& r = regs[inputsCount + n];
+
+            switch (instr.op)
+            {
+            case FO_Add: r = a + regs[instr.b]; break;
+            case FO_Sub: r = a - regs[instr.b]; break;
+            case FO_Mul: r = a * regs[instr.b]; break;
+            case FO_Div: r = a / regs[instr.b]; break;
+            case FO_AddScalar: r = a + instr.val; break;
+            case FO_MulScalar: r = a * instr.val; break;
+            case FO_DivScalar: r = a / instr.val; break;
+            case FO_Pow: r = instr.val == 2.f ? a * a : ::pow(a, instr.val); break;
+            case FO_Neg: r = -a; break;
+            case FO_Sqrt: r = ::sqrt(a); break;
+            case FO_Exp: r = ::exp(a); break;
+            case FO_Log: r = ::log(a); break;
+            case FO_Abs: r = ::fabs(a); break;
+            default: assert(false);
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::Backpropagate(const float* regs, float* adjs) const
+    {
+        const size_t inputsCount = m_InputsView.size();
+        fill(adjs, adjs + m_RegistersCount - 1, 0.f);
+
+        for (size_t n = m_ElementwiseCount; n-- > 0;)
+        {
+            const auto& instr = m_Program[n];
+            const float a = regs[instr.a];
+            const float r = regs[inputsCount + n];
+            const float g = adjs[inputsCount + n];
+
+            switch (instr.op)
+            {
+            case FO_Add: adjs[instr.a] += g; adjs[instr.b] += g; break;
+            case FO_Sub: adjs[instr.a] += g; adjs[instr.b] -= g; break;
+            case FO_Mul: adjs[instr.a] += g * regs[instr.b]; adjs[instr.b] += g * a; break;
+            case FO_Div: adjs[instr.a] += g / regs[instr.b]; adjs[instr.b] -= g * r / regs[instr.b]; break;
+            case FO_AddScalar: adjs[instr.a] += g; break;
+            case FO_MulScalar: adjs[instr.a] += g * instr.val; break;
+            case FO_DivScalar: adjs[instr.a] += g / instr.val; break;
+            case FO_Pow: adjs[instr.a] += g * (instr.val == 2.f ? 2.f * a : instr.val * ::pow(a, instr.val - 1)); break;
+            case FO_Neg: adjs[instr.a] -= g; break;
+            case FO_Sqrt: adjs[instr.a] += g * 0.5f / r; break;
+            case FO_Exp: adjs[instr.a] += g * r; break;
+            case FO_Log: adjs[instr.a] += g / a; break;
+            case FO_Abs: adjs[instr.a] += a > 0 ? g : (a < 0 ? -g : 0.f); break;
+            default: assert(false);
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::ComputeInternal()
+    {
+        const bool isReduction = m_ElementwiseCount < m_Program.size();
+
+        GatherInputsData();
+        if (!isReduction)
+            m_Output.Resize(m_ElementsShape);
+        m_Output.OverrideHost();
+        float* outputData = m_Output.Values();
+
+        const uint32_t elementsCount = m_ElementsShape.Length;
+        const uint32_t blocksCount = (elementsCount + FUSED_BLOCK_SIZE - 1) / FUSED_BLOCK_SIZE;
+        vector<double> blockSums(isReduction ? blocksCount : 0);
+
+        auto processBlock = [&](uint32_t b)
+        {
+            vector<float> regs(m_RegistersCount);
+            vector<uint32_t> offsets(m_InputsView.size());
+            const uint32_t end = min(elementsCount, (b + 1) * FUSED_BLOCK_SIZE);
+            double sum = 0;
+
+            for (uint32_t e = b * FUSED_BLOCK_SIZE; e < end; ++e)
+            {
+                Evaluate(e, &regs[0], &offsets[0]);
+                if (isReduction)
+                    sum += regs.back();
+                else
+                    outputData[e] = regs.back();
+            }
+
+            if (isReduction)
+                blockSums[b] = sum;
+        };
+
+        if (m_OpMode == CPU)
+        {
+            for (uint32_t b = 0; b < blocksCount; ++b)
+                processBlock(b);
+        }
+        else
+            parallel_for(0u, blocksCount, processBlock);
+
+        if (isReduction)
+        {
+            double sum = 0;
+            for (auto blockSum : blockSums)
+                sum += blockSum;
+            outputData[0] = (float)(m_Program.back().op == FO_Mean ? sum / elementsCount : sum);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FusedElementwiseOp::ComputeGradientInternal(const Tensor& grad)
+    {
+        const bool isReduction = m_ElementwiseCount < m_Program.size();
+        const size_t inputsCount = m_InputNodes.size();
+
+        GatherInputsData();
+        const float* gradData = grad.Values();
+        const uint32_t elementsCount = m_ElementsShape.Length;
+        const float gradScale = isReduction && m_Program.back().op == FO_Mean ? 1.f / elementsCount : 1.f;
+
+        vector<float*> inputsGradData(inputsCount, nullptr);
+        for (size_t i = 0; i < inputsCount; ++i)
+        {
+            if (!m_InputNodes[i]->CareAboutGradient())
+                continue;
+
+            m_InputsGrads[i].OverrideHost();
+            inputsGradData[i] = m_InputsGrads[i].Values();
+        }
+
+        // gradients of broadcast inputs are sums over all elements they were broadcast to, each chunk accumulates its own partial sums
+        const uint32_t chunksCount = m_OpMode == CPU ? 1 : max(1u, min((elementsCount + FUSED_BLOCK_SIZE - 1) / FUSED_BLOCK_SIZE, thread::hardware_concurrency()));
+        vector<vector<double>> partialGrads(chunksCount * inputsCount);
+
+        auto processChunk = [&](uint32_t c)
+        {
+            vector<float> regs(m_RegistersCount);
+            vector<float> adjs(m_RegistersCount);
+            vector<uint32_t> offsets(inputsCount);
+            const uint32_t begin = (uint32_t)((uint64_t)elementsCount * c / chunksCount);
+            const uint32_t end = (uint32_t)((uint64_t)elementsCount * (c + 1) / chunksCount);
+
+            for (size_t i = 0; i < inputsCount; ++i)
+            {
+                if (inputsGradData[i] && !m_InputsView[i].full)
+                    partialGrads[c * inputsCount + i].resize(m_Inputs[i]->Length(), 0.0);
+            }
+
+            for (uint32_t e = begin; e < end; ++e)
+            {
+                Evaluate(e, &regs[0], &offsets[0]);
+                adjs.back() = (isReduction ? gradData[0] : gradData[e]) * gradScale;
+                Backpropagate(&regs[0], &adjs[0]);
+
+                for (size_t i = 0; i < inputsCount; ++i)
+                {
+                    if (!inputsGradData[i])
+                        continue;
+
+                    if (m_InputsView[i].full)
+                        inputsGradData[i][e] = adjs[i];
+                    else
+                        partialGrads[c * inputsCount + i][offsets[i]] += adjs[i];
+                }
+            }
+        };
+
+        if (chunksCount == 1)
+            processChunk(0);
+        else
+            parallel_for(0u, chunksCount, processChunk);
+
+        for (size_t i = 0; i < inputsCount; ++i)
+        {
+            if (!inputsGradData[i] || m_InputsView[i].full)
+                continue;
+
+            const uint32_t length = m_Inputs[i]->Length();
+            for (uint32_t j = 0; j < length; ++j)
+            {
+                double sum = 0;
+                for (uint32_t c = 0; c < chunksCount; ++c)
+                    sum += partialGrads[c * inputsCount + i][j];
+                inputsGradData[i][j] = (float)sum;
+            }
+        }
+    }
+}
@@ -8,7 +8,7 @@ namespace Neuro
     GradientsOp::GradientsOp(TensorLike* y, const vector<Variable*>& params, const string& name)
         : Operation({ y }, name.empty() ? "gradients" : name), m_Vars(params)
     {
-        m_Order = Graph::Default()->BuildBackwardOrder({ y }, m_NodesAffectingInputNodes, params);
+        m_Plan.params = params;
         for (auto param : params)
         {
             m_Grads.push_back(new Variable(zeros(param->Output().GetShape()), param->Name() + "_grad"));
@@ -20,7 +20,10 @@ namespace Neuro
     void GradientsOp::ComputeInternal()
     {
         m_InputsManuallyConsumed = true; // loss outputs will be completely obliterated after gradients computation
-        m_InputNodes[0]->GetGraph()->ComputeGradientsInOrder(m_Order, m_InputNodes, m_NodesAffectingInputNodes, m_Vars);
+        // input might have been replaced by graph optimization
+        if (!m_InputNodes[0]->GetGraph()->IsUpToDate(m_Plan))
+            m_Plan.losses = m_InputNodes;
+        m_InputNodes[0]->GetGraph()->ComputeGradients(m_Plan);
 
         for (size_t i = 0; i < m_Vars.size(); ++i)
             m_Vars[i]->OutputGrad().CopyTo(m_Grads[i]->Output());
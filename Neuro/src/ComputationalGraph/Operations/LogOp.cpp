@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/LogOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -23,4 +24,11 @@ namespace Neuro
         if (m_InputNodes[0]->CareAboutGradient())
             grad.Div(*m_Inputs[0], m_InputsGrads[0]);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool LogOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = FusedInstruction(FO_Log);
+        return true;
+    }
 }
\ No newline at end of file
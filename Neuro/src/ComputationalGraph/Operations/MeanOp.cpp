@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/MeanOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -53,4 +54,14 @@ namespace Neuro
             m_InputsGrads[0].MulElem(grad.Div(n), m_InputsGrads[0]);
         }
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool MeanOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        if (m_Axis != GlobalAxis)
+            return false;
+
+        instruction = FusedInstruction(FO_Mean);
+        return true;
+    }
 }
\ No newline at end of file
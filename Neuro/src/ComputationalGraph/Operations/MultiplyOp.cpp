@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "ComputationalGraph/Operations/MultiplyOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -85,4 +86,11 @@ namespace Neuro
                 progressGrad(1);
         }
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool MultiplyOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = m_InputNodes.size() == 1 ? FusedInstruction(FO_MulScalar, m_Val) : FusedInstruction(FO_Mul);
+        return true;
+    }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/NegativeOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -23,4 +24,11 @@ namespace Neuro
         if (m_InputNodes[0]->CareAboutGradient())
             grad.Negated(m_InputsGrads[0]);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool NegativeOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = FusedInstruction(FO_Neg);
+        return true;
+    }
 }
\ No newline at end of file
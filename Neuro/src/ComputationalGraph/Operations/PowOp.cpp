@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/PowOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -43,4 +44,15 @@ namespace Neuro
             grad.Map([&](float g, float x) {return g * ::pow(x, power) * ::log(x); }, *m_Inputs[0], m_InputsGrads[1]);
         }
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool PowOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        // power provided as a node is not supported
+        if (m_InputNodes.size() > 1)
+            return false;
+
+        instruction = FusedInstruction(FO_Pow, m_Power);
+        return true;
+    }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/SqrtOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -23,4 +24,11 @@ namespace Neuro
         if (m_InputNodes[0]->CareAboutGradient())
             grad.Div(1.f, 2.f, m_Output, m_InputsGrads[0]);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool SqrtOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = FusedInstruction(FO_Sqrt);
+        return true;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "ComputationalGraph/Operations/SubtractOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -69,4 +70,11 @@ namespace Neuro
         if (m_InputNodes[1]->CareAboutGradient())
             progressGrad(m_InputsGrads[1], grad.Negated());
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool SubtractOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        instruction = FusedInstruction(FO_Sub);
+        return true;
+    }
 }
\ No newline at end of file
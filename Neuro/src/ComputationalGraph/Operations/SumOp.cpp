@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/SumOp.h"
+#include "ComputationalGraph/Operations/FusedElementwiseOp.h"
 
 namespace Neuro
 {
@@ -49,4 +50,14 @@ namespace Neuro
             m_InputsGrads[0].MulElem(grad, m_InputsGrads[0]);
         }
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool SumOp::GetFusedInstruction(FusedInstruction& instruction) const
+    {
+        if (m_Axis != GlobalAxis)
+            return false;
+
+        instruction = FusedInstruction(FO_Sum);
+        return true;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 ﻿#include "ComputationalGraph/Placeholder.h"
 #include "ComputationalGraph/Graph.h"
+#include "Tools.h"
 
 namespace Neuro
 {
@@ -20,4 +21,26 @@ namespace Neuro
         defaultVal.CopyTo(m_Output);
         Graph::Default()->AddPlaceholder(this);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Placeholder::BindFeed(const Tensor& feed)
+    {
+        NEURO_ASSERT(!m_FeedBound, "Placeholder '" << Name() << "' is already bound to a feed.");
+        string name = m_Output.Name();
+        m_OwnValue = move(m_Output);
+        m_Output.Name(name);
+        m_Output.Alias(feed);
+        m_FeedBound = true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Placeholder::ReleaseFeed()
+    {
+        if (!m_FeedBound)
+            return;
+
+        m_Output.ReleaseData();
+        m_Output = move(m_OwnValue);
+        m_FeedBound = false;
+    }
 }
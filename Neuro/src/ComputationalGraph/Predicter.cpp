@@ -8,14 +8,17 @@
 namespace Neuro
 {
     //////////////////////////////////////////////////////////////////////////
-    Predicter::Predicter(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps)
+    Predicter::Predicter(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps, const vector<TensorLike*>& forwardOrder)
     {
         m_InputPlaceholders = inputPlaceholders;
         m_OutputOps = outputOps;
 
-        bool isTraining = Graph::Default()->BuildForwardOrder(m_OutputOps, m_Order);
+        if (forwardOrder.empty())
+            Session::Default()->Compile(m_OutputOps, m_Plan);
+        else
+            Session::Default()->Compile(m_OutputOps, forwardOrder, m_Plan);
 
-        NEURO_ASSERT(!isTraining, "Fetching training operation in predictor.");
+        NEURO_ASSERT(!m_Plan.is_training, "Fetching training operation in predictor.");
 
         for (size_t i = 0; i < m_InputPlaceholders.size(); ++i)
             m_Feeds[m_InputPlaceholders[i]] = nullptr;
@@ -28,12 +31,12 @@ namespace Neuro
         for (size_t i = 0; i < m_InputPlaceholders.size(); ++i)
             m_Feeds[m_InputPlaceholders[i]] = inputs[i];
 
-        return Session::Default()->RunInOrder(m_Order, m_OutputOps, m_Feeds, false);
+        return Session::Default()->RunPlan(m_Plan, m_Feeds);
     }
 
     //////////////////////////////////////////////////////////////////////////
     tensor_ptr_vec_t Predicter::Eval(const map<Placeholder*, const Tensor*>& feeds)
     {
-        return Session::Default()->RunInOrder(m_Order, m_OutputOps, feeds, false);
+        return Session::Default()->RunPlan(m_Plan, feeds);
     }
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "ComputationalGraph/Profiler.h"
+#include "ComputationalGraph/Operation.h"
+#include "Tensors/Tensor.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    static uint32_t ThreadIndex()
+    {
+        static atomic<uint32_t> nextIndex{ 0 };
+        static thread_local uint32_t index = nextIndex++;
+        return index;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static string EscapeJson(const string& str)
+    {
+        string result;
+        result.reserve(str.size());
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Profiler::Profiler()
+    {
+        m_Origin = chrono::steady_clock::now();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Profiler::Compute(Operation* op, bool training)
+    {
+        auto start = chrono::steady_clock::now();
+        op->Compute(training);
+        Record(op, false, start, chrono::steady_clock::now());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Profiler::ComputeGradient(Operation* op, const Tensor& grad)
+    {
+        auto start = chrono::steady_clock::now();
+        op->ComputeGradient(grad);
+        Record(op, true, start, chrono::steady_clock::now());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Profiler::Record(Operation* op, bool gradient, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+    {
+        ProfilerEvent e;
+        e.name = op->Name();
+        e.opType = op->TypeName();
+        size_t scopeEnd = e.name.rfind('-');
+        e.layer = scopeEnd != string::npos ? e.name.substr(0, scopeEnd) : "";
+        e.gradient = gradient;
+        e.thread = ThreadIndex();
+        e.outputShape = op->GetShape();
+        e.flops = op->EstimateFlops(gradient);
+
+        uint64_t inputsLength = 0;
+        for (auto input : op->Inputs())
+        {
+            e.inputShapes.push_back(input->GetShape());
+            inputsLength += input->Length();
+        }
+        // forward pass reads inputs and writes output, gradient pass reads inputs and output gradient and writes inputs gradients
+        e.bytes = (gradient ? 2 * inputsLength + e.outputShape.Length : inputsLength + e.outputShape.Length) * sizeof(float);
+
+        unique_lock<mutex> locker(m_Mtx);
+        e.start = chrono::duration_cast<chrono::microseconds>(start - m_Origin).count();
+        e.duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+        m_Events.push_back(move(e));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static void Accumulate(ProfilerStats& stats, const ProfilerEvent& e)
+    {
+        if (e.gradient)
+        {
+            ++stats.gradientCount;
+            stats.gradientTime += e.duration;
+        }
+        else
+        {
+            ++stats.forwardCount;
+            stats.forwardTime += e.duration;
+        }
+        stats.flops += e.flops;
+        stats.bytes += e.bytes;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    map<string, ProfilerStats> Profiler::StatsPerOpType() const
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        map<string, ProfilerStats> stats;
+        for (const auto& e : m_Events)
+            Accumulate(stats[e.opType], e);
+        return stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    map<string, ProfilerStats> Profiler::StatsPerLayer() const
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        map<string, ProfilerStats> stats;
+        for (const auto& e : m_Events)
+            Accumulate(stats[e.layer], e);
+        return stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static void WriteStatsTable(stringstream& ss, const string& title, const map<string, ProfilerStats>& stats, size_t maxRows)
+    {
+        vector<pair<string, ProfilerStats>> rows(stats.begin(), stats.end());
+        sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.forwardTime + a.second.gradientTime > b.second.forwardTime + b.second.gradientTime; });
+        if (rows.size() > maxRows)
+            rows.resize(maxRows);
+
+        ss << left << setw(40) << title << right << setw(12) << "fwd calls" << setw(12) << "fwd ms" << setw(12) << "grad calls" << setw(12) << "grad ms" << setw(12) << "GFLOP/s" << setw(12) << "GB/s" << "\n";
+        for (const auto& row : rows)
+        {
+            const auto& s = row.second;
+            double seconds = (s.forwardTime + s.gradientTime) * 1e-6;
+            ss << left << setw(40) << (row.first.empty() ? "<none>" : row.first) << right << fixed << setprecision(2)
+               << setw(12) << s.forwardCount << setw(12) << s.forwardTime * 1e-3
+               << setw(12) << s.gradientCount << setw(12) << s.gradientTime * 1e-3
+               << setw(12) << (seconds > 0 ? s.flops * 1e-9 / seconds : 0.0)
+               << setw(12) << (seconds > 0 ? s.bytes * 1e-9 / seconds : 0.0) << "\n";
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string Profiler::Summary(size_t maxRows) const
+    {
+        stringstream ss;
+        WriteStatsTable(ss, "Operation type", StatsPerOpType(), maxRows);
+        ss << "\n";
+        WriteStatsTable(ss, "Layer", StatsPerLayer(), maxRows);
+        return ss.str();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Profiler::SaveChromeTrace(const string& filename) const
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        ofstream stream(filename, ios::out | ios::trunc);
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (size_t i = 0; i < m_Events.size(); ++i)
+        {
+            const auto& e = m_Events[i];
+            stream << (i ? ",\n" : "\n");
+            stream << "{\"name\":\"" << EscapeJson(e.name) << "\",\"cat\":\"" << (e.gradient ? "gradient" : "forward") << "\",\"ph\":\"X\",\"ts\":" << e.start << ",\"dur\":" << e.duration << ",\"pid\":0,\"tid\":" << e.thread;
+            stream << ",\"args\":{\"type\":\"" << EscapeJson(e.opType) << "\",\"layer\":\"" << EscapeJson(e.layer) << "\",\"inputs\":[";
+            for (size_t j = 0; j < e.inputShapes.size(); ++j)
+                stream << (j ? "," : "") << "\"" << e.inputShapes[j].ToString() << "\"";
+            stream << "],\"output\":\"" << e.outputShape.ToString() << "\",\"flops\":" << e.flops << ",\"bytes\":" << e.bytes << "}}";
+        }
+        stream << "\n]}\n";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Profiler::Clear()
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        m_Events.clear();
+        m_Origin = chrono::steady_clock::now();
+    }
+}
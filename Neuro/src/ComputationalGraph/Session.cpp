@@ -30,6 +30,14 @@ namespace Neuro
         m_Graph = graph;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    Session::~Session()
+    {
+        // graph must not be left with dangling profiler, another session might have set its own in the meantime
+        if (m_Graph->GetProfiler() == &m_Profiler)
+            m_Graph->SetProfiler(nullptr);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     Session* Session::Default()
     {
@@ -52,86 +60,133 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     vector<Tensor*> Session::Run(const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds)
     {
-        size_t fetchesHash = GetFetchesHash(fetches);
-        auto orderIt = m_OrderCache.find(fetchesHash);
-        if (orderIt == m_OrderCache.end())
+        auto& plan = m_PlanCache[GetFetchesHash(fetches)];
+        if (plan.fetches != fetches)
+            Compile(fetches, plan);
+
+        return RunPlan(plan, feeds);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::Compile(const vector<TensorLike*>& fetches, ExecutionPlan& plan) const
+    {
+        if (m_OptimizeGraph)
+            m_Graph->Optimize(fetches);
+
+        vector<TensorLike*> order;
+        m_Graph->BuildForwardOrder(fetches, order);
+        Compile(fetches, order, plan);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::Compile(const vector<TensorLike*>& fetches, const vector<TensorLike*>& order, ExecutionPlan& plan) const
+    {
+        SESSION_DEBUG_INFO("##Session: Compiling plan...\n");
+
+        plan.is_training = false;
+        plan.graph_version = m_Graph->Version();
+        plan.fetches = fetches;
+
+        plan.steps.resize(order.size());
+        for (size_t n = 0; n < order.size(); ++n)
         {
-            OrderCacheData data;
-            data.is_training = m_Graph->BuildForwardOrder(fetches, data.order);
-            m_OrderCache[fetchesHash] = data;
-            orderIt = m_OrderCache.find(fetchesHash);
+            auto& step = plan.steps[n];
+            step.node = order[n];
+            step.op = order[n]->IsOp() ? static_cast<Operation*>(order[n]) : nullptr;
+            step.fetched = find(fetches.begin(), fetches.end(), order[n]) != fetches.end();
+            plan.is_training |= step.op && step.op->IsTrainingOp();
         }
 
-        return RunInOrder(orderIt->second.order, fetches, feeds, orderIt->second.is_training);
+        plan.results.resize(fetches.size());
     }
 
     //////////////////////////////////////////////////////////////////////////
-    vector<Tensor*> Session::RunInOrder(const vector<TensorLike*>& order, const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds, bool training)
+    const vector<Tensor*>& Session::RunPlan(ExecutionPlan& plan, const map<Placeholder*, const Tensor*>& feeds)
     {
+        // plan has to be recompiled whenever graph structure changed
+        if (plan.graph_version != m_Graph->Version())
+            Compile(plan.fetches, plan);
+
         m_Graph->InitVariables();
         m_Graph->IncrementStep();
 
-        for (auto feed : feeds)
+        for (auto& feed : feeds)
         {
             SESSION_DEBUG_INFO("##Session: Feeding '%s'...\n", feed.first->Name().c_str());
-            feed.first->m_Output.ResizeBatch(feed.second->Batch());
-            NEURO_ASSERT(feed.second->GetShape() == feed.first->m_Output.GetShape(), "Mismatched feed shape. Expected: " << feed.first->m_Output.GetShape().ToString() << " received: " << feed.second->GetShape().ToString());
-            feed.second->CopyTo(feed.first->m_Output);
-        }
+            auto& placeholderOutput = feed.first->m_Output;
+            NEURO_ASSERT(feed.second->SameDimensionsExceptBatches(placeholderOutput), "Mismatched feed shape. Expected: " << Shape::From(placeholderOutput.GetShape(), feed.second->Batch()).ToString() << " received: " << feed.second->GetShape().ToString());
 
-        for (size_t n = 0; n < order.size(); ++n)
-        {
-            // as of right now there is no functionality using that feature
-            /*if (n + 1 < order.size())
+            // fetched placeholder has to own its value since it is returned as a result
+            if (m_ZeroCopyFeeds && find(plan.fetches.begin(), plan.fetches.end(), feed.first) == plan.fetches.end())
             {
-                auto node = order[n + 1];
-                SESSION_DEBUG_INFO("##Session: Preloading '%s'...\n", node->Name().c_str());
-                node->Prefetch();
-            }*/
+                feed.first->BindFeed(*feed.second);
+                continue;
+            }
 
-            auto node = order[n];
+            placeholderOutput.ResizeBatch(feed.second->Batch());
+            feed.second->CopyTo(placeholderOutput);
+        }
 
-            NVTXProfile p(node->Name().c_str(), 0xFFD67FFF);
+        // gradients computed by graph during this run are recorded by this session's profiler, graph can be shared by multiple sessions
+        // so profiler is set only for the duration of the run
+        Profiler* prevProfiler = m_Graph->GetProfiler();
+        m_Graph->SetProfiler(m_Profiling ? &m_Profiler : nullptr);
+
+        for (auto& step : plan.steps)
+        {
+            NVTXProfile p(step.node->Name().c_str(), 0xFFD67FFF);
 
-            bool isFetched = find(fetches.begin(), fetches.end(), node) != fetches.end();
-            node->SetFetched(isFetched);
-            node->Output().ResetRef(isFetched ? 1 : 0); // lock fetches outputs so they don't get completely released 
+            step.node->SetFetched(step.fetched);
+            step.node->Output().ResetRef(step.fetched ? 1 : 0); // lock fetches outputs so they don't get completely released 
             
-            if (node->IsOp())
+            if (step.op)
             {
-                SESSION_DEBUG_INFO("##Session: Computing '%s'...\n", node->Name().c_str());
-                Operation* op = static_cast<Operation*>(node);
-                op->Compute(training);
-
-                if (Debug::ShouldLogOutput(node->Name()))
-                {
-                    for (size_t i = 0; i < op->Inputs().size(); ++i)
-                    {
-                        //op->Inputs()[i]->Validate();
-                        op->Inputs()[i]->DebugDumpValues(node->Name() + "_input" + to_string(i) + "_step" + to_string(Debug::GetStep()) + ".log");
-                    }
-                }
+                SESSION_DEBUG_INFO("##Session: Computing '%s'...\n", step.node->Name().c_str());
+                if (m_Profiling)
+                    m_Profiler.Compute(step.op, plan.is_training);
+                else
+                    step.op->Compute(plan.is_training);
             }
 
-            if (Debug::ShouldLogOutput(node->Name()))
-            {
-                //node->Output().Validate();
-                node->Output().DebugDumpValues(node->Name() + "_output0_step" + to_string(Debug::GetStep()) + ".log");
-            }
+            DebugLogOutputs(step);
         }
 
+        m_Graph->SetProfiler(prevProfiler);
+
         Debug::Step();
 
-        vector<Tensor*> result(fetches.size());
-        for (size_t i = 0; i < fetches.size(); ++i)
-            result[i] = fetches[i]->OutputPtr();
-        return result;
+        // feeds are owned by caller so bindings cannot outlive the run
+        for (auto& feed : feeds)
+            feed.first->ReleaseFeed();
+
+        for (size_t i = 0; i < plan.fetches.size(); ++i)
+            plan.results[i] = plan.fetches[i]->OutputPtr();
+        return plan.results;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::DebugLogOutputs(const ExecutionPlan::Step& step) const
+    {
+        if (!Debug::ShouldLogOutput(step.node->Name()))
+            return;
+
+        if (step.op)
+        {
+            for (size_t i = 0; i < step.op->Inputs().size(); ++i)
+            {
+                //op->Inputs()[i]->Validate();
+                step.op->Inputs()[i]->DebugDumpValues(step.node->Name() + "_input" + to_string(i) + "_step" + to_string(Debug::GetStep()) + ".log");
+            }
+        }
+
+        //node->Output().Validate();
+        step.node->Output().DebugDumpValues(step.node->Name() + "_output0_step" + to_string(Debug::GetStep()) + ".log");
     }
 
     //////////////////////////////////////////////////////////////////////////
     void Session::Clear()
     {
-        m_OrderCache.clear();
+        m_PlanCache.clear();
         m_Graph->Clear();
     }
 }
@@ -14,9 +14,9 @@ namespace Neuro
         m_TargetPlaceholders = targetPlaceholders;
         m_FetchOps = fetchOps;
 
-        bool isTraining = Graph::Default()->BuildForwardOrder(m_FetchOps, m_Order);
+        Session::Default()->Compile(m_FetchOps, m_Plan);
 
-        NEURO_ASSERT(isTraining, "There is no training operation fetched in trainer.");
+        NEURO_ASSERT(m_Plan.is_training, "There is no training operation fetched in trainer.");
 
         for (size_t i = 0; i < m_InputPlaceholders.size(); ++i)
             m_Feeds[m_InputPlaceholders[i]] = nullptr;
@@ -35,6 +35,6 @@ namespace Neuro
         for (size_t i = 0; i < m_TargetPlaceholders.size(); ++i)
             m_Feeds[m_TargetPlaceholders[i]] = outputs[i];
 
-        return Session::Default()->RunInOrder(m_Order, m_FetchOps, m_Feeds, true);
+        return Session::Default()->RunPlan(m_Plan, m_Feeds);
     }
 }
\ No newline at end of file
@@ -50,6 +50,8 @@ namespace Neuro
 
         for (auto consumer : m_Consumers)
             consumer->RefreshCareAboutGradient();
+
+        m_Graph->OnTrainabilityChanged();
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <ppl.h>
+
+#include "CsvLoader.h"
+#include "Tensors/Tensor.h"
+#include "Memory/MappedFile.h"
+
+namespace Neuro
+{
+    using namespace concurrency;
+
+    static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    //////////////////////////////////////////////////////////////////////////
+    // Returns pointer to line's '\n' or end of data
+    static const char* LineEnd(const char* p, const char* end)
+    {
+        auto newLine = (const char*)memchr(p, '\n', end - p);
+        return newLine ? newLine : end;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static const char* TrimLineEnd(const char* begin, const char* end)
+    {
+        while (end > begin && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+            --end;
+        return end;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Locale independent parsing without any allocations, text which is not a number is parsed as 0 (the same way atof does)
+    static const char* ParseFloat(const char* p, const char* end, float& value)
+    {
+        static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16 };
+        const uint64_t MAX_MANTISSA = 100000000000000000ull;
+
+        while (p < end && (*p == ' ' || *p == '\t'))
+            ++p;
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (mantissa < MAX_MANTISSA)
+                mantissa = mantissa * 10 + (*p - '0');
+            else
+                ++exponent;
+        }
+
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+            {
+                if (mantissa < MAX_MANTISSA)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    --exponent;
+                }
+            }
+        }
+
+        if (p + 1 < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* e = p + 1;
+            bool negativeExp = false;
+            if (*e == '-' || *e == '+')
+                negativeExp = *e++ == '-';
+
+            if (e < end && *e >= '0' && *e <= '9')
+            {
+                int exp = 0;
+                for (; e < end && *e >= '0' && *e <= '9'; ++e)
+                    exp = min(exp * 10 + (*e - '0'), 10000);
+                exponent += negativeExp ? -exp : exp;
+                p = e;
+            }
+        }
+
+        double result = (double)mantissa;
+        if (mantissa)
+        {
+            for (; exponent > 16; exponent -= 16)
+                result *= POW10[16];
+            for (; exponent < -16; exponent += 16)
+                result /= POW10[16];
+            result = exponent < 0 ? result / POW10[-exponent] : result * POW10[exponent];
+        }
+
+        value = (float)(negative ? -result : result);
+        return p;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Line should not include new line character, every input and output value is written
+    static void ParseRow(const char* p, const char* end, float* inputs, uint32_t inputsNum, float* outputs, uint32_t outputsNum, bool oneHot)
+    {
+        auto nextField = [&](float& value)
+        {
+            p = ParseFloat(p, end, value);
+            while (p < end && *p != ',')
+                ++p;
+            if (p < end)
+                ++p;
+        };
+
+        for (uint32_t i = 0; i < inputsNum; ++i)
+            nextField(inputs[i]);
+
+        if (oneHot)
+        {
+            float label;
+            nextField(label);
+            fill_n(outputs, outputsNum, 0.f);
+            if (label >= 0 && label < outputsNum)
+                outputs[(uint32_t)label] = 1;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < outputsNum; ++i)
+                nextField(outputs[i]);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Returns number of input columns based on first non-empty line, 0 when there are no lines
+    static uint32_t InputsNum(const char* data, const char* dataEnd, uint32_t outputsNum, bool oneHot)
+    {
+        for (const char* p = data; p < dataEnd;)
+        {
+            const char* end = LineEnd(p, dataEnd);
+            const char* lineEnd = TrimLineEnd(p, end);
+
+            if (lineEnd > p)
+            {
+                uint32_t fieldsNum = 1 + (uint32_t)count(p, lineEnd, ',');
+                uint32_t outputColumns = oneHot ? 1 : outputsNum;
+                return fieldsNum > outputColumns ? fieldsNum - outputColumns : 0;
+            }
+
+            p = end < dataEnd ? end + 1 : dataEnd;
+        }
+        return 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void LoadCSVData(const string& filename, int outputsNum, Tensor& input, Tensor& output, bool outputsOneHotEncoded, int maxLines)
+    {
+        const MappedFile file(filename);
+        NEURO_ASSERT(file.IsValid(), "Failed to open CSV file '" << filename << "'.");
+        if (!file.IsValid())
+            return;
+
+        const char* data = (const char*)file.Data();
+        const char* dataEnd = data + file.Size();
+        const uint32_t inputsNum = InputsNum(data, dataEnd, outputsNum, outputsOneHotEncoded);
+
+        // split file into chunks starting right after new line characters
+        const size_t chunksNum = max<size_t>(1, min<size_t>(file.Size() / MIN_CHUNK_SIZE, thread::hardware_concurrency() * 4));
+        vector<const char*> chunkStart(chunksNum + 1, dataEnd);
+        chunkStart[0] = data;
+        for (size_t c = 1; c < chunksNum; ++c)
+        {
+            const char* p = max(chunkStart[c - 1], data + file.Size() / chunksNum * c);
+            if (p[-1] != '\n')
+            {
+                p = LineEnd(p, dataEnd);
+                p = p < dataEnd ? p + 1 : dataEnd;
+            }
+            chunkStart[c] = p;
+        }
+
+        auto forEachRow = [&](size_t c, const function<bool(const char*, const char*)>& func)
+        {
+            for (const char* p = chunkStart[c]; p < chunkStart[c + 1];)
+            {
+                const char* end = LineEnd(p, dataEnd);
+                const char* lineEnd = TrimLineEnd(p, end);
+                if (lineEnd > p && !func(p, lineEnd))
+                    return;
+                p = end < dataEnd ? end + 1 : dataEnd;
+            }
+        };
+
+        // first pass counts rows in every chunk so the second one knows where to write its rows
+        vector<size_t> chunkFirstRow(chunksNum + 1, 0);
+        parallel_for((size_t)0, chunksNum, [&](size_t c)
+        {
+            size_t rows = 0;
+            forEachRow(c, [&](const char*, const char*) { ++rows; return true; });
+            chunkFirstRow[c + 1] = rows;
+        });
+
+        for (size_t c = 0; c < chunksNum; ++c)
+            chunkFirstRow[c + 1] += chunkFirstRow[c];
+
+        uint32_t rowsNum = (uint32_t)chunkFirstRow[chunksNum];
+        if (maxLines >= 0)
+            rowsNum = min<uint32_t>(rowsNum, maxLines);
+
+        // every value is written by parser so tensors don't have to be cleared
+        input = Tensor(Shape(inputsNum, 1, 1, rowsNum));
+        output = Tensor(Shape(outputsNum, 1, 1, rowsNum));
+        input.OverrideHost();
+        output.OverrideHost();
+        float* inputValues = input.Values();
+        float* outputValues = output.Values();
+
+        parallel_for((size_t)0, chunksNum, [&](size_t c)
+        {
+            size_t row = chunkFirstRow[c];
+            forEachRow(c, [&](const char* begin, const char* end)
+            {
+                if (row >= rowsNum)
+                    return false;
+                ParseRow(begin, end, inputValues + row * inputsNum, inputsNum, outputValues + row * outputsNum, outputsNum, outputsOneHotEncoded);
+                ++row;
+                return true;
+            });
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    CsvLoader::CsvLoader(const string& filename, int outputsNum, uint32_t batchSize, bool outputsOneHotEncoded)
+        : m_OutputsNum(outputsNum), m_BatchSize(batchSize), m_OneHot(outputsOneHotEncoded)
+    {
+        m_File = new MappedFile(filename);
+        if (!m_File->IsValid())
+        {
+            cout << "CSV file '" << filename << "' could not be opened.\n";
+            return;
+        }
+
+        const char* data = (const char*)m_File->Data();
+        m_InputsNum = InputsNum(data, data + m_File->Size(), m_OutputsNum, m_OneHot);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    CsvLoader::~CsvLoader()
+    {
+        delete m_File;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool CsvLoader::IsValid() const
+    {
+        // at least one sample is required otherwise looking for lines would never end
+        return m_File->IsValid() && m_InputsNum > 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t CsvLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        NEURO_ASSERT(IsValid(), "Loading from invalid CSV file.");
+
+        auto& x = dest[loadIdx];
+        auto& y = dest[loadIdx + 1];
+        NEURO_ASSERT(x.BatchLength() == m_InputsNum, "Mismatched inputs length " << x.BatchLength() << ", file has " << m_InputsNum << " inputs.");
+        NEURO_ASSERT(y.BatchLength() == m_OutputsNum, "Mismatched outputs length " << y.BatchLength() << ", expected " << m_OutputsNum << ".");
+
+        const char* data = (const char*)m_File->Data();
+        const char* dataEnd = data + m_File->Size();
+
+        // only lines boundaries are found under lock, parsing is done concurrently by all workers
+        vector<pair<const char*, const char*>> lines;
+        lines.reserve(m_BatchSize);
+        {
+            unique_lock<mutex> positionLocker(m_PositionMtx);
+            const char* p = data + m_Position;
+            while (lines.size() < m_BatchSize)
+            {
+                if (p >= dataEnd)
+                    p = data;
+
+                const char* end = LineEnd(p, dataEnd);
+                const char* lineEnd = TrimLineEnd(p, end);
+                if (lineEnd > p)
+                    lines.push_back(make_pair(p, lineEnd));
+                p = end < dataEnd ? end + 1 : dataEnd;
+            }
+            m_Position = p - data;
+        }
+
+        x.ResizeBatch(m_BatchSize);
+        y.ResizeBatch(m_BatchSize);
+        x.OverrideHost();
+        y.OverrideHost();
+        float* inputValues = x.Values();
+        float* outputValues = y.Values();
+
+        for (uint32_t n = 0; n < m_BatchSize; ++n)
+            ParseRow(lines[n].first, lines[n].second, inputValues + n * m_InputsNum, m_InputsNum, outputValues + n * m_OutputsNum, m_OutputsNum, m_OneHot);
+
+        x.CopyToDevice();
+        y.CopyToDevice();
+        return 2;
+    }
+}
@@ -1,120 +1,246 @@
+#include <sstream>
+#include <iomanip>
+
 #include "DataPreloader.h"
 #include "Tensors/Tensor.h"
 #include "ComputationalGraph/Placeholder.h"
 #include "Tools.h"
 
+#include <windows.h>
+
 namespace Neuro
 {
+    static const uint32_t STOP_SLOT = 0xFFFFFFFF;
+
+    // Bounded multi-producer multi-consumer queue of slot indices. Positions are claimed with atomic increments, every cell has a turn
+    // counter telling whether it waits for push or pop in given lap. Threads wait for their turn on the counter itself (WaitOnAddress).
+    class SlotQueue
+    {
+    public:
+        SlotQueue(size_t capacity) : m_Capacity(capacity), m_Cells(capacity) {}
+
+        void Push(uint32_t slot) { PushAt(m_Tail++, slot); }
+
+        // Pushes at given position, used to keep items in order of positions assigned up front
+        void PushAt(size_t pos, uint32_t slot)
+        {
+            auto& cell = m_Cells[pos % m_Capacity];
+            const size_t turn = 2 * (pos / m_Capacity);
+            WaitForTurn(cell.turn, turn);
+            cell.slot = slot;
+            cell.turn.store(turn + 1, memory_order_release);
+            WakeByAddressAll(&cell.turn);
+        }
+
+        uint32_t Pop(size_t* pos = nullptr)
+        {
+            const size_t p = m_Head++;
+            auto& cell = m_Cells[p % m_Capacity];
+            const size_t turn = 2 * (p / m_Capacity) + 1;
+            WaitForTurn(cell.turn, turn);
+            uint32_t slot = cell.slot;
+            cell.turn.store(turn + 1, memory_order_release);
+            WakeByAddressAll(&cell.turn);
+
+            if (pos)
+                *pos = p;
+            return slot;
+        }
+
+    private:
+        struct Cell
+        {
+            atomic<size_t> turn{ 0 };
+            uint32_t slot = STOP_SLOT;
+        };
+
+        static void WaitForTurn(atomic<size_t>& turn, size_t expected)
+        {
+            size_t current = turn.load(memory_order_acquire);
+            while (current != expected)
+            {
+                // returns when value is different than current one (or spuriously)
+                WaitOnAddress(&turn, &current, sizeof(current), INFINITE);
+                current = turn.load(memory_order_acquire);
+            }
+        }
+
+        size_t m_Capacity;
+        vector<Cell> m_Cells;
+        atomic<size_t> m_Head{ 0 };
+        atomic<size_t> m_Tail{ 0 };
+    };
+
     //////////////////////////////////////////////////////////////////////////
-    DataPreloader::DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode)
-        : m_Destination(destination), m_Loaders(loaders), m_ThreadedMode(threadedMode)
+    string DataPreloaderStats::ToString() const
     {
-        for (size_t i = 0; i < capacity; ++i)
+        stringstream ss;
+        ss << fixed << setprecision(2);
+        ss << "Batches loaded: " << batchesLoaded << " consumed: " << batchesConsumed;
+        if (batchesConsumed)
+            ss << " - avg queue depth: " << (float)queueDepthSum / batchesConsumed << " - avg consumer wait: " << consumerWaitTime / batchesConsumed << "ms";
+        if (batchesLoaded)
+            ss << " - avg load: " << loadTime / batchesLoaded << "ms - avg workers wait: " << workersWaitTime / batchesLoaded << "ms";
+        return ss.str();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    DataPreloader::DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode, uint32_t workersNum, bool ordered)
+        : m_Destination(destination), m_Loaders(loaders), m_ThreadedMode(threadedMode), m_Ordered(ordered)
+    {
+        NEURO_ASSERT(workersNum > 0, "At least one worker is required.");
+        NEURO_ASSERT(capacity > 0, "At least one slot is required.");
+
+        m_Slots.resize(capacity);
+        // stop markers for all workers have to fit in free slots queue along with all slots
+        m_Free = new SlotQueue(capacity + (m_ThreadedMode ? workersNum : 0));
+        m_Ready = new SlotQueue(capacity);
+
+        for (uint32_t s = 0; s < (uint32_t)capacity; ++s)
         {
-            vector<Tensor>* data = new vector<Tensor>(destination.size());
+            auto& data = m_Slots[s];
+            data.resize(destination.size());
             for (size_t i = 0; i < destination.size(); ++i)
-                (*data)[i].Resize(destination[i]->GetShape());
-            m_Pending.push_back(data);
+            {
+                // storage type has to match so slot can be swapped with destination
+                data[i].SetStorageType(destination[i]->GetStorageType());
+                data[i].Resize(destination[i]->GetShape());
+            }
+            m_Free->Push(s);
         }
 
         if (m_ThreadedMode)
-            m_PreloaderThread = thread(&DataPreloader::PreloadFunc, this);
+        {
+            for (uint32_t i = 0; i < workersNum; ++i)
+                m_Workers.push_back(thread(&DataPreloader::PreloadFunc, this));
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
     DataPreloader::~DataPreloader()
     {
-        m_Stop = true;
-        m_PendingCond.notify_all();
-        if (m_ThreadedMode)
-            m_PreloaderThread.join();
-
-        for (auto& tVec : m_Pending)
-            delete tVec;
-
-        for (auto& tVec : m_Available)
-            delete tVec;
+        // every worker will pick up one stop marker once it is done with slots queued before it
+        for (size_t i = 0; i < m_Workers.size(); ++i)
+            m_Free->Push(STOP_SLOT);
+        for (auto& worker : m_Workers)
+            worker.join();
+
+        delete m_Free;
+        delete m_Ready;
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void DataPreloader::Load()
+    void DataPreloader::Load(bool swapStorage)
     {
         if (!m_ThreadedMode)
             Preload();
 
-        vector<Tensor>* data = nullptr;
+        uint32_t slot;
         {
             NVTXProfile p("Waiting for available data", 0xFF93FF72);
-            unique_lock<mutex> availableLocker(m_AvailableMtx);
-            m_AvailableCond.wait(availableLocker, [this]() {return !m_Available.empty(); });
-
-            data = m_Available.front();
-            m_Available.pop_front();
+            Stopwatch waitTimer;
+            waitTimer.Start();
+            m_QueueDepthSum += m_ReadyCount.load();
+            slot = m_Ready->Pop();
+            --m_ReadyCount;
+            waitTimer.Stop();
+            m_ConsumerWaitTime += waitTimer.ElapsedMicroseconds();
+            ++m_BatchesConsumed;
         }
 
+        auto& data = m_Slots[slot];
+
+        if (swapStorage)
+        {
+            NVTXProfile p("Swapping preloaded data into placeholders", 0xFF93FF72);
+            for (size_t i = 0; i < m_Destination.size(); ++i)
+            {
+                m_Destination[i]->ResizeBatch(data[i].Batch());
+                m_Destination[i]->SwapStorage(data[i]);
+            }
+        }
+        else
         {
             NVTXProfile p("Copying preloaded data to placeholders", 0xFF93FF72);
             // copy data to destination
             for (size_t i = 0; i < m_Destination.size(); ++i)
             {
-                m_Destination[i]->ResizeBatch((*data)[i].Batch());
-                (*data)[i].CopyTo(*m_Destination[i]);
+                m_Destination[i]->ResizeBatch(data[i].Batch());
+                data[i].CopyTo(*m_Destination[i]);
             }
         }
 
-        {
-            NVTXProfile p("Waiting for pending data lock", 0xFF93FF72);
-            unique_lock<mutex> pendingLocker(m_PendingMtx);
-            m_Pending.push_back(data);
-        }
-        m_PendingCond.notify_all();
+        m_Free->Push(slot);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void DataPreloader::Preload()
+    DataPreloaderStats DataPreloader::Stats() const
     {
-        vector<Tensor>* data = nullptr;
+        DataPreloaderStats stats;
+        stats.batchesLoaded = m_BatchesLoaded;
+        stats.batchesConsumed = m_BatchesConsumed;
+        stats.queueDepthSum = m_QueueDepthSum;
+        stats.loadTime = m_LoadTime * 0.001f;
+        stats.workersWaitTime = m_WorkersWaitTime * 0.001f;
+        stats.consumerWaitTime = m_ConsumerWaitTime * 0.001f;
+        return stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void DataPreloader::ResetStats()
+    {
+        m_BatchesLoaded = m_BatchesConsumed = m_QueueDepthSum = 0;
+        m_LoadTime = m_WorkersWaitTime = m_ConsumerWaitTime = 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool DataPreloader::Preload()
+    {
+        uint32_t slot;
+        size_t sequence;
+        Stopwatch timer;
 
         {
             NVTXProfile p("Waiting for pending data", 0xFF93FF72);
-            unique_lock<mutex> pendingLocker(m_PendingMtx);
-            m_PendingCond.wait(pendingLocker, [this]() {return !m_Pending.empty() || m_Stop; });
-
-            if (m_Stop)
-                return;
+            timer.Start();
+            // position in free slots queue tells in which order batches should be handed out
+            slot = m_Free->Pop(&sequence);
+            timer.Stop();
 
-            data = m_Pending.front();
-            m_Pending.pop_front();
+            if (slot == STOP_SLOT)
+                return false;
         }
 
+        m_WorkersWaitTime += timer.ElapsedMicroseconds();
+        auto& data = m_Slots[slot];
+
         {
             NVTXProfile p("Loading data", 0xFF93FF72);
+            timer.Restart();
             // load data
             size_t loadIdx = 0;
             for (size_t i = 0; i < m_Loaders.size(); ++i)
-                loadIdx += (*m_Loaders[i])(*data, loadIdx);
+                loadIdx += (*m_Loaders[i])(data, loadIdx);
+            timer.Stop();
 
-            NEURO_ASSERT(loadIdx == data->size(), "Number or loaded items (" << loadIdx << ") doesn't match number of destinations (" << data->size() << ").");
+            NEURO_ASSERT(loadIdx == data.size(), "Number or loaded items (" << loadIdx << ") doesn't match number of destinations (" << data.size() << ").");
         }
 
-        {
-            NVTXProfile p("Waiting for available data lock", 0xFF93FF72);
-            unique_lock<mutex> availableLocker(m_AvailableMtx);
-            m_Available.push_back(data);
-        }
-        m_AvailableCond.notify_all();
+        m_LoadTime += timer.ElapsedMicroseconds();
+        ++m_BatchesLoaded;
+
+        ++m_ReadyCount;
+        if (m_Ordered)
+            m_Ready->PushAt(sequence, slot);
+        else
+            m_Ready->Push(slot);
+        return true;
     }
 
     //////////////////////////////////////////////////////////////////////////
     void DataPreloader::PreloadFunc()
     {
-        while (true)
-        {
-            if (m_Stop)
-                return;
-
-            Preload();
-        }
+        while (Preload()) {}
     }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,177 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <ppl.h>
+#include <experimental/filesystem>
+
+#include "ImageFilesCache.h"
+#include "Tools.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace Neuro
+{
+    using namespace concurrency;
+
+    // Cache file layout (text):
+    // header line: magic and version
+    // one line per file: path, size, modification time, width, height, format, state separated with tabs
+    // Cache files written by older versions contain only paths, their entries are treated as unknown files.
+    static const string FILES_CACHE_MAGIC = "NEUROFLC";
+    static const int FILES_CACHE_VERSION = 1;
+
+    //////////////////////////////////////////////////////////////////////////
+    ImageFilesCache& ImageFilesCache::Default()
+    {
+        static ImageFilesCache cache;
+        return cache;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<ImageFileInfo> ImageFilesCache::Load(const string& dir)
+    {
+        vector<ImageFileInfo> files;
+        ifstream stream(CacheFilename(dir));
+        if (!stream)
+            return files;
+
+        string line;
+        if (!getline(stream, line))
+            return files;
+
+        if (line != FILES_CACHE_MAGIC + " " + to_string(FILES_CACHE_VERSION))
+        {
+            // paths only cache
+            do
+            {
+                if (line.empty())
+                    continue;
+                files.push_back(ImageFileInfo());
+                files.back().path = line;
+            } while (getline(stream, line));
+
+            Register(files);
+            return files;
+        }
+
+        // damaged cache is treated as missing so directory gets scanned again
+        while (getline(stream, line))
+        {
+            if (line.empty())
+                continue;
+
+            auto fields = Split(line, "\t");
+            if (fields.size() != 7 || fields[0].empty())
+                return {};
+
+            ImageFileInfo info;
+            info.path = fields[0];
+            try
+            {
+                info.size = stoull(fields[1]);
+                info.modificationTime = stoll(fields[2]);
+                info.width = (uint32_t)stoul(fields[3]);
+                info.height = (uint32_t)stoul(fields[4]);
+                info.format = stoi(fields[5]);
+                int state = stoi(fields[6]);
+                if (state < IFS_Unknown || state > IFS_Invalid)
+                    return {};
+                info.state = (EImageFileState)state;
+            }
+            catch (const logic_error&)
+            {
+                // invalid_argument or out_of_range
+                return {};
+            }
+            files.push_back(info);
+        }
+
+        Register(files);
+        return files;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<ImageFileInfo> ImageFilesCache::Refresh(const string& dir, bool validate)
+    {
+        unordered_map<string, ImageFileInfo> cached;
+        for (auto& info : Load(dir))
+            cached[info.path] = info;
+
+        vector<string> paths;
+        for (const auto& entry : fs::directory_iterator(dir))
+        {
+            if (!fs::is_directory(entry.status()))
+                paths.push_back(entry.path().generic_string());
+        }
+
+        vector<ImageFileInfo> files(paths.size());
+
+        parallel_for((size_t)0, paths.size(), [&](size_t i)
+        {
+            auto& info = files[i];
+            info.path = paths[i];
+
+            error_code ec;
+            info.size = (uint64_t)fs::file_size(info.path, ec);
+            info.modificationTime = (int64_t)fs::last_write_time(info.path, ec).time_since_epoch().count();
+
+            auto it = cached.find(info.path);
+            if (it != cached.end() && it->second.size == info.size && it->second.modificationTime == info.modificationTime && (!validate || it->second.state != IFS_Unknown))
+            {
+                info = it->second;
+                return;
+            }
+
+            if (validate)
+                ProbeImageFile(info, true);
+        });
+
+        if (validate)
+        {
+            for (const auto& info : files)
+            {
+                if (info.state == IFS_Invalid)
+                    cout << "Detected invalid image file '" << info.path << "'" << endl;
+            }
+        }
+
+        Save(dir, files);
+        Register(files);
+        return files;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ImageFilesCache::Find(const string& filename, ImageFileInfo& info) const
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        auto it = m_Files.find(filename);
+        if (it == m_Files.end())
+            return false;
+        info = it->second;
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageFilesCache::Update(const ImageFileInfo& info)
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        m_Files[info.path] = info;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageFilesCache::Save(const string& dir, const vector<ImageFileInfo>& files) const
+    {
+        ofstream stream(CacheFilename(dir), ios::out | ios::trunc);
+        stream << FILES_CACHE_MAGIC << " " << FILES_CACHE_VERSION << "\n";
+        for (const auto& info : files)
+            stream << info.path << "\t" << info.size << "\t" << info.modificationTime << "\t" << info.width << "\t" << info.height << "\t" << info.format << "\t" << (int)info.state << "\n";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageFilesCache::Register(const vector<ImageFileInfo>& files)
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        for (const auto& info : files)
+            m_Files[info.path] = info;
+    }
+}
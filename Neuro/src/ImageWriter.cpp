@@ -0,0 +1,106 @@
+#include "ImageWriter.h"
+#include "Tensors/Tensor.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    ImageWriter& ImageWriter::Default()
+    {
+        static ImageWriter writer;
+        return writer;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ImageWriter::ImageWriter(size_t capacity)
+        : m_Capacity(capacity)
+    {
+        NEURO_ASSERT(capacity > 0, "At least one queued image is required.");
+        m_Worker = thread(&ImageWriter::WorkerFunc, this);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ImageWriter::~ImageWriter()
+    {
+        {
+            unique_lock<mutex> locker(m_Mtx);
+            m_Stop = true;
+        }
+        m_JobAvailable.notify_one();
+        // worker writes everything queued before it stops
+        m_Worker.join();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ImageWriter::Write(const Tensor& t, const string& imageFile, bool denormalize, uint32_t maxCols)
+    {
+        {
+            unique_lock<mutex> locker(m_Mtx);
+            if (m_Queue.size() >= m_Capacity)
+            {
+                ++m_Dropped;
+                return false;
+            }
+        }
+
+        // snapshot is plain memory so it doesn't depend on tensors' memory management which may be gone when writing at program exit
+        auto job = new Job();
+        const float* values = t.Values();
+        job->values.assign(values, values + t.Length());
+        job->shape = t.GetShape();
+        job->filename = imageFile;
+        job->denormalize = denormalize;
+        job->maxCols = maxCols;
+
+        {
+            unique_lock<mutex> locker(m_Mtx);
+            // queue could fill up while values were copied
+            if (m_Queue.size() >= m_Capacity)
+            {
+                ++m_Dropped;
+                delete job;
+                return false;
+            }
+            m_Queue.push_back(job);
+        }
+        m_JobAvailable.notify_one();
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageWriter::Flush()
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        m_Idle.wait(locker, [&]() { return m_Queue.empty() && !m_Writing; });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageWriter::WorkerFunc()
+    {
+        while (true)
+        {
+            Job* job = nullptr;
+            {
+                unique_lock<mutex> locker(m_Mtx);
+                m_JobAvailable.wait(locker, [&]() { return m_Stop || !m_Queue.empty(); });
+
+                if (m_Queue.empty())
+                    return;
+
+                job = m_Queue.front();
+                m_Queue.pop_front();
+                m_Writing = true;
+            }
+
+            SaveImage(&job->values[0], job->shape, job->filename, job->denormalize, job->maxCols);
+            delete job;
+            ++m_Written;
+
+            {
+                unique_lock<mutex> locker(m_Mtx);
+                m_Writing = false;
+            }
+            m_Idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include "Memory/ImageCache.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    ImageCache& ImageCache::Default()
+    {
+        static ImageCache cache;
+        return cache;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageCache::SetCapacity(size_t capacityInBytes)
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        m_Capacity = capacityInBytes;
+        Evict(0);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    shared_ptr<const CachedImage> ImageCache::Get(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY)
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        auto it = m_EntriesByKey.find(Key(filename, targetSizeX, targetSizeY));
+        if (it == m_EntriesByKey.end())
+        {
+            ++m_Misses;
+            return nullptr;
+        }
+
+        ++m_Hits;
+        m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+        return it->second->second;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageCache::Put(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, const shared_ptr<const CachedImage>& image)
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        const size_t imageSize = image->pixels.size();
+        if (imageSize > m_Capacity)
+            return;
+
+        string key = Key(filename, targetSizeX, targetSizeY);
+        // another thread might have decoded the same image in the meantime
+        if (m_EntriesByKey.find(key) != m_EntriesByKey.end())
+            return;
+
+        Evict(imageSize);
+        m_Entries.push_front(make_pair(key, image));
+        m_EntriesByKey[key] = m_Entries.begin();
+        m_Size += imageSize;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageCache::Clear()
+    {
+        unique_lock<mutex> locker(m_Mtx);
+        m_Entries.clear();
+        m_EntriesByKey.clear();
+        m_Size = 0;
+        m_Hits = 0;
+        m_Misses = 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string ImageCache::Key(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY)
+    {
+        return filename + "|" + to_string(targetSizeX) + "x" + to_string(targetSizeY);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageCache::Evict(size_t requiredSize)
+    {
+        while (!m_Entries.empty() && m_Size + requiredSize > m_Capacity)
+        {
+            m_Size -= m_Entries.back().second->pixels.size();
+            m_EntriesByKey.erase(m_Entries.back().first);
+            m_Entries.pop_back();
+        }
+    }
+}
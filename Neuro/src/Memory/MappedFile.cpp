@@ -0,0 +1,48 @@
+#include <windows.h>
+
+#include "Memory/MappedFile.h"
+#include "Types.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    MappedFile::MappedFile(const string& filename, bool copyOnWrite)
+        : m_CopyOnWrite(copyOnWrite)
+    {
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        m_FileHandle = file;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+
+        m_MappingHandle = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+        if (!m_MappingHandle)
+            return;
+
+        m_Data = (uint8_t*)MapViewOfFile(m_MappingHandle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+        if (m_Data)
+            m_Size = (size_t)fileSize.QuadPart;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MappedFile::~MappedFile()
+    {
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_MappingHandle)
+            CloseHandle(m_MappingHandle);
+        if (m_FileHandle)
+            CloseHandle(m_FileHandle);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint8_t* MappedFile::MutableData()
+    {
+        NEURO_ASSERT(m_CopyOnWrite, "Read-only mapping cannot be modified.");
+        return m_Data;
+    }
+}
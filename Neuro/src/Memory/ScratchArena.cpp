@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <atomic>
+
+#include "Memory/ScratchArena.h"
+#include "Memory/MemoryManager.h"
+#include "Tensors/Tensor.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    static const size_t SCRATCH_ALIGNMENT = 64 / sizeof(float);
+
+    static atomic<size_t> g_BlockSize{ 4 * 1024 * 1024 / sizeof(float) };
+    static atomic<size_t> g_GlobalPeak{ 0 };
+
+    //////////////////////////////////////////////////////////////////////////
+    ScratchArena& ScratchArena::Local()
+    {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ScratchArena::~ScratchArena()
+    {
+        NEURO_ASSERT(m_Used == 0, "Scratch arena destroyed while its memory is still in use.");
+        for (auto& block : m_Blocks)
+            HostMemoryManager::Default().Free(block.data);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    float* ScratchArena::Allocate(size_t count)
+    {
+        count = (count + SCRATCH_ALIGNMENT - 1) & ~(SCRATCH_ALIGNMENT - 1);
+
+        if (m_Blocks.empty() || m_Used + count > m_Blocks[m_Current].begin + m_Blocks[m_Current].size)
+        {
+            // remaining part of current block is skipped
+            size_t nextIdx = m_Blocks.empty() ? 0 : m_Current + 1;
+            size_t nextBegin = m_Blocks.empty() ? 0 : m_Blocks[m_Current].begin + m_Blocks[m_Current].size;
+
+            if (nextIdx >= m_Blocks.size() || m_Blocks[nextIdx].size < count)
+            {
+                // blocks past current one are not used so they can be replaced with a single larger one
+                for (size_t i = nextIdx; i < m_Blocks.size(); ++i)
+                    HostMemoryManager::Default().Free(m_Blocks[i].data);
+                m_Blocks.resize(nextIdx);
+
+                Block block;
+                block.size = max(max(count, (size_t)g_BlockSize), m_Blocks.empty() ? 0 : m_Blocks.back().size * 2);
+                block.begin = nextBegin;
+                HostMemoryManager::Default().Allocate((void**)&block.data, block.size * sizeof(float), "scratch");
+                m_Blocks.push_back(block);
+            }
+
+            m_Current = nextIdx;
+            m_Used = nextBegin;
+        }
+
+        const auto& block = m_Blocks[m_Current];
+        float* ptr = block.data + (m_Used - block.begin);
+        m_Used += count;
+
+        if (m_Used > m_Peak)
+        {
+            m_Peak = m_Used;
+            size_t globalPeak = g_GlobalPeak;
+            while (m_Peak > globalPeak && !g_GlobalPeak.compare_exchange_weak(globalPeak, m_Peak)) {}
+        }
+
+        return ptr;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ScratchArena::Release(size_t mark)
+    {
+        NEURO_ASSERT(mark <= m_Used, "Scratch memory released out of order.");
+        m_Used = mark;
+        // mark at the beginning of a block belongs to the end of previous one
+        while (m_Current > 0 && mark <= m_Blocks[m_Current].begin)
+            --m_Current;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t ScratchArena::GlobalPeakSizeInBytes()
+    {
+        return g_GlobalPeak * sizeof(float);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ScratchArena::SetBlockSize(size_t sizeInBytes)
+    {
+        g_BlockSize = max((size_t)1, sizeInBytes / sizeof(float));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ScratchArena::DumpState(FILE* file)
+    {
+        auto& arena = Local();
+        size_t reserved = 0;
+        for (const auto& block : arena.m_Blocks)
+            reserved += block.size * sizeof(float);
+
+        fprintf(file, "Scratch >>> used=%zu, reserved=%zu, peak=%zu, global peak=%zu\n\n", arena.UsedSizeInBytes(), reserved, arena.PeakSizeInBytes(), GlobalPeakSizeInBytes());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Tensor ScratchScope::NewTensor(const Shape& shape, const string& name)
+    {
+        Tensor t(Shape(0), name);
+        t.Alias(Allocate(shape.Length), shape, true);
+        return t;
+    }
+}
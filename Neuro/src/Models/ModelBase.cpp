@@ -2,10 +2,19 @@
 #include <iostream>
 #include <numeric>
 #include <cctype>
+#include <cstring>
 #include <iomanip>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <experimental/filesystem>
+#include <cstdio>
+#include <io.h>
 #include <H5Cpp.h>
+#include <ppl.h>
+#define NOMINMAX
+#include <windows.h>
 
 #include "Models/ModelBase.h"
 #include "Optimizers/OptimizerBase.h"
@@ -15,21 +24,78 @@
 #include "ChartGenerator.h"
 #include "Stopwatch.h"
 #include "ComputationalGraph/Ops.h"
+#include "ComputationalGraph/Graph.h"
 #include "ComputationalGraph/Placeholder.h"
 #include "ComputationalGraph/Variable.h"
 #include "ComputationalGraph/NameScope.h"
 #include "ComputationalGraph/Trainer.h"
 #include "ComputationalGraph/Predicter.h"
 #include "ComputationalGraph/Session.h"
+#include "Memory/MappedFile.h"
 
 using namespace H5;
 
 namespace Neuro
 {
+    using namespace concurrency;
+
+    // Native weights file layout (little-endian):
+    // header: magic, uint32 version, uint32 number of layers
+    // index: for every layer uint32 name length, name, uint32 number of parameters and for every parameter uint32 dimensions[4], uint64 values offset
+    // values: parameters' values in internal layout, every parameter starts at page boundary so it can be used directly from mapped file
+    static const char NATIVE_WEIGHTS_MAGIC[] = "NEUROWTS";
+    static const uint32_t NATIVE_WEIGHTS_VERSION = 1;
+    static const uint32_t NATIVE_WEIGHTS_ALIGNMENT = 4096;
+    static const string NATIVE_WEIGHTS_EXT = ".nw";
+
+    //////////////////////////////////////////////////////////////////////////
+    static uint64_t AlignToPage(uint64_t offset)
+    {
+        return (offset + NATIVE_WEIGHTS_ALIGNMENT - 1) / NATIVE_WEIGHTS_ALIGNMENT * NATIVE_WEIGHTS_ALIGNMENT;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static bool IsNativeWeightsFile(const string& filename)
+    {
+        char magic[sizeof(NATIVE_WEIGHTS_MAGIC) - 1] = {};
+        ifstream stream(filename, ios::in | ios::binary);
+        stream.read(magic, sizeof(magic));
+        return stream && memcmp(magic, NATIVE_WEIGHTS_MAGIC, sizeof(magic)) == 0;
+    }
+
+    // Checkpoint file layout (little-endian):
+    // header: magic, uint32 version, uint32 number of layers
+    // layers: uint32 name length, name, uint32 number of parameters and for every parameter uint32 dimensions[4] followed by values
+    // optimizer state: uint32 state flag, float iteration, uint32 number of variables and for every variable its name and tensors as above
+    static const char CHECKPOINT_MAGIC[] = "NEUROCKP";
+    static const uint32_t CHECKPOINT_VERSION = 1;
+
+    struct CheckpointSnapshot
+    {
+        vector<pair<string, vector<Tensor>>> layers; // layer name, parameters' values
+        bool hasOptimizerState = false;
+        OptimizerState optimizerState;
+    };
+
     //////////////////////////////////////////////////////////////////////////
     ModelBase::~ModelBase()
     {
+        WaitForCheckpoint();
         delete m_Optimizer;
+
+        if (!m_MappedWeights.empty())
+        {
+            // parameters belong to graph so they may outlive mapped weights, they need their own copy of values
+            vector<Variable*> params;
+            Parameters(params, false);
+            for (auto param : params)
+            {
+                if (param->Output().IsAlias())
+                    param->Output() = Tensor(param->Output());
+            }
+        }
+
+        DeleteContainer(m_MappedWeights);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -368,7 +434,8 @@ namespace Neuro
         vector<Variable*> params;
         Parameters(params);
 
-        fetches.push_back(optimizer->Minimize({ totalLoss }, params));
+        m_Minimization = optimizer->Minimize({ totalLoss }, params);
+        fetches.push_back(m_Minimization);
 
         vector<Placeholder*> inputs;
         for_each(m_Inputs.begin(), m_Inputs.end(), [&](TensorLike* input) { inputs.push_back(static_cast<Placeholder*>(input)); });
@@ -441,6 +508,12 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void ModelBase::SaveWeights(const string& filename) const
     {
+        if (filename.length() > NATIVE_WEIGHTS_EXT.length() && filename.compare(filename.length() - NATIVE_WEIGHTS_EXT.length(), NATIVE_WEIGHTS_EXT.length(), NATIVE_WEIGHTS_EXT) == 0)
+        {
+            SaveWeightsNative(filename);
+            return;
+        }
+
         //https://github.com/keras-team/keras/blob/5be4ed3d9e7548dfa9d51d1d045a3f951d11c2b1/keras/engine/saving.py#L733
         H5File file = H5File(filename, H5F_ACC_TRUNC);
         
@@ -492,7 +565,7 @@ namespace Neuro
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void ModelBase::LoadWeights(const string& filename, bool ignoreInputLayer, bool byName)
+    void ModelBase::LoadWeights(const string& filename, bool ignoreInputLayer, bool byName, bool verbose)
     {
         if (!std::experimental::filesystem::exists(filename))
         {
@@ -500,24 +573,32 @@ namespace Neuro
             return;
         }
 
+        if (!m_Built)
+            Build();
+
+        if (IsNativeWeightsFile(filename))
+        {
+            LoadWeightsNative(filename, ignoreInputLayer, byName);
+            return;
+        }
+
         if (!H5File::isHdf5(filename.c_str()))
         {
             cout << "File '" << filename << "' is not valid HDF5 file.\n";
             return;
         }
 
-        if (!m_Built)
-            Build();
+        Stopwatch totalTimer;
+        totalTimer.Start();
 
         H5File file = H5File(filename, H5F_ACC_RDONLY);
+        // contiguous datasets are copied straight from mapped file by worker threads, HDF5 library itself is not reentrant
+        const MappedFile mappedFile(filename);
 
         // layer names determine layers' order in model
         bool is_keras = file.attrExists("layer_names");
 
-        Shape tranposedParamShape;
-        Tensor kerasParam;
         vector<SerializedParameter> params;
-        static char buffer[1024];
 
         auto layers = Layers();
         if (ignoreInputLayer)
@@ -526,68 +607,91 @@ namespace Neuro
         hsize_t layerGroupsNum;
         H5Gget_num_objs(file.getId(), &layerGroupsNum);
 
+        // truncated models (ie. feature extractors) use only leading saved layers
         if (!byName)
-            NEURO_ASSERT((size_t)layerGroupsNum == layers.size(), "Number of saved layers doesn't match number of layers in the model. Found " << layerGroupsNum << " expected " << layers.size() << ".");
-
-        vector<hsize_t> layersOrder(layers.size());
-        iota(layersOrder.begin(), layersOrder.end(), 0); // creation order by default
+            NEURO_ASSERT((size_t)layerGroupsNum >= layers.size(), "Number of saved layers is lower than number of layers in the model. Found " << layerGroupsNum << " expected " << layers.size() << ".");
 
-        map<string, hsize_t> layerNameToIdx;
-        for (hsize_t i = 0; i < layerGroupsNum; ++i)
-            layerNameToIdx[file.getObjnameByIdx(i)] = i;
-
-        // Keras specifies order of layers by attribute containing array of layer names
-        if (is_keras && !byName)
+        auto readNames = [](const Attribute& att)
         {
-            Attribute att(file.openAttribute("layer_names"));
-            hsize_t layersNamesNum = 0;
-            att.getSpace().getSimpleExtentDims(&layersNamesNum);
-            NEURO_ASSERT(layersNamesNum == layerGroupsNum, "Number of layer names doesn't match number of layers' groups. Found " << layersNamesNum << " expected " << layerGroupsNum << ".");
+            hsize_t namesNum = 0;
+            att.getSpace().getSimpleExtentDims(&namesNum);
             hsize_t strLen = att.getDataType().getSize();
-            att.read(att.getDataType(), buffer);
+            vector<char> buffer(namesNum * strLen);
+            att.read(att.getDataType(), buffer.data());
+
+            vector<string> names((size_t)namesNum);
+            for (hsize_t i = 0; i < namesNum; ++i)
+            {
+                const char* name = buffer.data() + i * strLen;
+                names[i] = string(name, find(name, name + strLen, '\0'));
+            }
+            return names;
+        };
 
-            for (hsize_t i = 0; i < layerGroupsNum; ++i)
+        // only groups of layers present in the model are ever opened, empty name means layer has no saved weights
+        vector<string> groupNames(layers.size());
+        if (byName)
+        {
+            for (size_t l = 0; l < layers.size(); ++l)
             {
-                string layerName(buffer + i * strLen, min(strlen(buffer + i * strLen), strLen));
-                // we need to get rid of group/layer name from weight name
-                layerName = layerName.substr(layerName.find_last_of('/') + 1);
-                layersOrder[i] = layerNameToIdx[layerName];
+                if (H5Lexists(file.getId(), layers[l]->Name().c_str(), H5P_DEFAULT) > 0)
+                    groupNames[l] = layers[l]->Name();
+                else
+                    cout << "Weights for layer '" << layers[l]->Name() << "' not found.\n";
             }
         }
+        // Keras specifies order of layers by attribute containing array of layer names
+        else if (is_keras)
+        {
+            auto layerNames = readNames(file.openAttribute("layer_names"));
+            NEURO_ASSERT(layerNames.size() == layerGroupsNum, "Number of layer names doesn't match number of layers' groups. Found " << layerNames.size() << " expected " << layerGroupsNum << ".");
+            for (size_t l = 0; l < layers.size(); ++l)
+                groupNames[l] = layerNames[l].substr(layerNames[l].find_last_of('/') + 1); // we need to get rid of group/layer name from weight name
+        }
+        else
+        {
+            for (size_t l = 0; l < layers.size(); ++l)
+                groupNames[l] = file.getObjnameByIdx(l); // creation order by default
+        }
+
+        struct CopyJob
+        {
+            const float* data; // saved values in mapped file
+            Shape savedShape;
+            vector<EAxis> transAxes;
+            Tensor* output;
+            size_t layerIdx;
+        };
+        vector<CopyJob> jobs;
+        vector<__int64> layersReadTime(layers.size(), 0);
+        vector<__int64> layersCopyTime(layers.size(), 0);
+        vector<size_t> layersBytes(layers.size(), 0);
 
         for (size_t l = 0; l < layers.size(); ++l)
         {
             auto layer = layers[l];
 
-            if (byName && layerNameToIdx.find(layer->Name()) == layerNameToIdx.end())
-            {
-                cout << "Weights for layer '" << layer->Name() << "' not found.\n";
+            params.clear();
+            layer->SerializedParameters(params);
+
+            if (groupNames[l].empty() || params.empty())
                 continue;
-            }
 
-            hsize_t groupIdx = byName ? layerNameToIdx[layer->Name()] : layersOrder[l];
-            Group g(file.openGroup(file.getObjnameByIdx(groupIdx)));
+            Stopwatch readTimer;
+            readTimer.Start();
 
-            params.clear();
-            layer->SerializedParameters(params);
+            Group g(file.openGroup(groupNames[l]));
 
             vector<DataSet> weightsDatasets;
 
             // Keras specifies order of tensors by attribute containing array of tensor names
             if (is_keras)
             {
-                Attribute att(g.openAttribute("weight_names"));
-                hsize_t weightsNamesNum = 0;
-                att.getSpace().getSimpleExtentDims(&weightsNamesNum);
-                NEURO_ASSERT(weightsNamesNum == params.size(), "Number of saved parameters doesn't match number of parameters in layer '" << layer->Name() << "'. Found " << weightsNamesNum << " expected " << params.size() << ".");
-                hsize_t strLen = att.getDataType().getSize();
-                att.read(att.getDataType(), buffer);
-
-                for (hsize_t i = 0; i < weightsNamesNum; ++i)
-                {
-                    string weightName(buffer + i * strLen, min(strlen(buffer + i * strLen), strLen));
+                auto weightNames = readNames(g.openAttribute("weight_names"));
+                NEURO_ASSERT(weightNames.size() == params.size(), "Number of saved parameters doesn't match number of parameters in layer '" << layer->Name() << "'. Found " << weightNames.size() << " expected " << params.size() << ".");
+
+                for (auto& weightName : weightNames)
                     weightsDatasets.push_back(g.openDataSet(weightName));
-                }
             }
             else
             {
@@ -598,50 +702,121 @@ namespace Neuro
             for (hsize_t i = 0; i < params.size(); ++i)
             {
                 auto& dataset = weightsDatasets[i];
-                auto w = params[i].param->OutputPtr();
+                auto& w = params[i].param->Output();
 
                 hsize_t weightNDims = dataset.getSpace().getSimpleExtentNdims();
                 hsize_t weightDims[5];
                 dataset.getSpace().getSimpleExtentDims(nullptr, weightDims);
 
-                NEURO_ASSERT(w->GetShape().Length == dataset.getSpace().getSimpleExtentNpoints(), "Number of values in parameter '" << w->Name() << "' doesn't match saved parameter. Found " << dataset.getSpace().getSimpleExtentNpoints() << " expected " << w->GetShape().Length  << ".");
+                NEURO_ASSERT(w.GetShape().Length == dataset.getSpace().getSimpleExtentNpoints(), "Number of values in parameter '" << w.Name() << "' doesn't match saved parameter. Found " << dataset.getSpace().getSimpleExtentNpoints() << " expected " << w.GetShape().Length  << ".");
 
                 NEURO_ASSERT(params[i].transAxesKeras.empty() || !params[i].reshapeKeras, "Cannot perform both transposition and reshape on Keras data.");
 
+                // reshape doesn't change values layout so in that case values are loaded directly as well
+                Shape savedShape = w.GetShape();
                 if (is_keras && (!params[i].transAxesKeras.empty() || params[i].reshapeKeras))
                 {
                     vector<int> dims(weightNDims);
                     for (size_t n = 0; n < dims.size(); ++n)
                         dims[n] = (int)weightDims[n];
-                    kerasParam.Resize(Shape::FromKeras(&dims[0], (int)weightNDims));
-                    kerasParam.Name(w->Name());
-                    w = &kerasParam;
+                    savedShape = Shape::FromKeras(&dims[0], (int)weightNDims);
                 }
 
-                auto wShape = w->GetShape();
-
-                NEURO_ASSERT(wShape.NDim == dataset.getSpace().getSimpleExtentNdims(), "Number of dimensions of parameter '" << w->Name() << "' doesn't match saved parameter. Found " << dataset.getSpace().getSimpleExtentNdims() << " expected " << wShape.NDim << ".");
-                for (int i = wShape.NDim - 1, n = 0; i >= 0; --i, ++n)
+                NEURO_ASSERT(savedShape.NDim == dataset.getSpace().getSimpleExtentNdims(), "Number of dimensions of parameter '" << w.Name() << "' doesn't match saved parameter. Found " << dataset.getSpace().getSimpleExtentNdims() << " expected " << savedShape.NDim << ".");
+                for (int i = savedShape.NDim - 1, n = 0; i >= 0; --i, ++n)
                 {
                     if (is_keras)
-                        NEURO_ASSERT(weightDims[n] == wShape.Dimensions[i], "Dimension " << n << " of parameter '" << w->Name() << "' doesn't match corresponding dimension of saved parameter. Found " << weightDims[n] << " expected " << wShape.Dimensions[i] << ".");
+                        NEURO_ASSERT(weightDims[n] == savedShape.Dimensions[i], "Dimension " << n << " of parameter '" << w.Name() << "' doesn't match corresponding dimension of saved parameter. Found " << weightDims[n] << " expected " << savedShape.Dimensions[i] << ".");
                     else
-                        NEURO_ASSERT(weightDims[i] == wShape.Dimensions[i], "Dimension " << i << " of parameter '" << w->Name() << "' doesn't match corresponding dimension of saved parameter. Found " << weightDims[i] << " expected " << wShape.Dimensions[i] << ".");
+                        NEURO_ASSERT(weightDims[i] == savedShape.Dimensions[i], "Dimension " << i << " of parameter '" << w.Name() << "' doesn't match corresponding dimension of saved parameter. Found " << weightDims[i] << " expected " << savedShape.Dimensions[i] << ".");
                 }
 
-                dataset.read(w->Values(), PredType::NATIVE_FLOAT);
+                vector<EAxis> transAxes;
+                if (is_keras && !params[i].transAxesKeras.empty())
+                    transAxes = Tensor::FillUpTranposeAxis(params[i].transAxesKeras);
 
-                if (is_keras && (!params[i].transAxesKeras.empty() || params[i].reshapeKeras))
+                w.OverrideHost();
+                layersBytes[l] += w.Length() * sizeof(float);
+
+                haddr_t offset = H5Dget_offset(dataset.getId());
+                bool canCopyFromMapping = mappedFile.IsValid() && offset != HADDR_UNDEF && offset % sizeof(float) == 0 &&
+                                          offset + savedShape.Length * sizeof(float) <= mappedFile.Size() &&
+                                          dataset.getDataType() == PredType::IEEE_F32LE;
+
+                if (canCopyFromMapping)
+                    jobs.push_back({ (const float*)(mappedFile.Data() + offset), savedShape, transAxes, &w, l });
+                else if (transAxes.empty())
+                    dataset.read(w.Values(), PredType::NATIVE_FLOAT);
+                else
                 {
-                    if (!params[i].transAxesKeras.empty())
-                        params[i].param->Output() = w->Transpose(params[i].transAxesKeras);
-                    if (params[i].reshapeKeras)
-                        params[i].param->Output() = w->Reshaped(params[i].param->Output().GetShape());
-                    params[i].param->Output().Name(kerasParam.Name());
+                    Tensor savedParam(savedShape, w.Name());
+                    dataset.read(savedParam.Values(), PredType::NATIVE_FLOAT);
+                    savedParam.Transpose(transAxes, w);
                 }
 
                 params[i].param->ForceInitialized();
             }
+
+            readTimer.Stop();
+            layersReadTime[l] = readTimer.ElapsedMicroseconds();
+        }
+
+        vector<__int64> jobsTime(jobs.size());
+        parallel_for(0, (int)jobs.size(), [&](int j)
+        {
+            auto& job = jobs[j];
+            Stopwatch copyTimer;
+            copyTimer.Start();
+
+            if (job.transAxes.empty())
+                memcpy(job.output->Values(), job.data, job.savedShape.Length * sizeof(float));
+            else
+            {
+                // transposition has to be done on CPU as worker threads don't own GPU context, job might also run inline on
+                // calling thread so its forced op mode has to be restored
+                EOpMode prevMode;
+                bool prevForced = Tensor::GetForcedOpMode(prevMode);
+                Tensor::SetForcedOpMode(CPU);
+                Tensor savedParam;
+                savedParam.Alias(job.data, job.savedShape);
+                savedParam.Transpose(job.transAxes, *job.output);
+                if (prevForced)
+                    Tensor::SetForcedOpMode(prevMode);
+                else
+                    Tensor::ClearForcedOpMode();
+            }
+
+            copyTimer.Stop();
+            jobsTime[j] = copyTimer.ElapsedMicroseconds();
+        });
+
+        for (size_t j = 0; j < jobs.size(); ++j)
+            layersCopyTime[jobs[j].layerIdx] += jobsTime[j];
+
+        totalTimer.Stop();
+
+        if (verbose)
+        {
+            stringstream ss;
+            ss.precision(3);
+            ss << "_____________________________________________________________________________\n";
+            ss << "Layer                        Size[MB]    Read[ms]    Copy[ms]    \n";
+            ss << "=============================================================================\n";
+
+            for (size_t l = 0; l < layers.size(); ++l)
+            {
+                if (!layersBytes[l])
+                    continue;
+
+                ss << left << setw(29) << layers[l]->Name().substr(0, 28);
+                ss << setw(12) << layersBytes[l] / (1024.f * 1024.f);
+                ss << setw(12) << layersReadTime[l] * 0.001f;
+                ss << setw(12) << layersCopyTime[l] * 0.001f << "\n";
+                ss << "_____________________________________________________________________________\n";
+            }
+
+            ss << "Total load time: " << totalTimer.ElapsedMilliseconds() << "ms (copies done by " << jobs.size() << " parallel jobs)" << endl;
+            cout << ss.str();
         }
 
         /*ifstream stream(filename, ios::in | ios::binary);
@@ -652,6 +827,375 @@ namespace Neuro
         stream.close();*/
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::SaveWeightsNative(const string& filename, bool ignoreInputLayer) const
+    {
+        vector<SerializedParameter> params;
+        vector<vector<Variable*>> layersParams;
+
+        auto layers = Layers();
+        if (ignoreInputLayer)
+            layers.erase(layers.begin()); // remove input layer from the list
+
+        // header followed by index
+        uint64_t indexEnd = sizeof(NATIVE_WEIGHTS_MAGIC) - 1 + 2 * sizeof(uint32_t);
+        for (auto layer : layers)
+        {
+            params.clear();
+            layer->SerializedParameters(params);
+
+            layersParams.push_back({});
+            for (auto& param : params)
+                layersParams.back().push_back(param.param);
+
+            indexEnd += 2 * sizeof(uint32_t) + layer->Name().length() + params.size() * (4 * sizeof(uint32_t) + sizeof(uint64_t));
+        }
+
+        ofstream stream(filename, ios::out | ios::binary);
+        auto writeU32 = [&](uint32_t value) { stream.write((const char*)&value, sizeof(value)); };
+
+        stream.write(NATIVE_WEIGHTS_MAGIC, sizeof(NATIVE_WEIGHTS_MAGIC) - 1);
+        writeU32(NATIVE_WEIGHTS_VERSION);
+        writeU32((uint32_t)layers.size());
+
+        uint64_t offset = AlignToPage(indexEnd);
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            auto& name = layers[l]->Name();
+            writeU32((uint32_t)name.length());
+            stream.write(name.c_str(), name.length());
+            writeU32((uint32_t)layersParams[l].size());
+
+            for (auto param : layersParams[l])
+            {
+                auto& shape = param->Output().GetShape();
+                for (uint32_t d = 0; d < 4; ++d)
+                    writeU32(shape.Dimensions[d]);
+                stream.write((const char*)&offset, sizeof(offset));
+                offset = AlignToPage(offset + shape.Length * sizeof(float));
+            }
+        }
+
+        static const char padding[NATIVE_WEIGHTS_ALIGNMENT] = {};
+        for (auto& layerParams : layersParams)
+        {
+            for (auto param : layerParams)
+            {
+                uint64_t pos = (uint64_t)stream.tellp();
+                stream.write(padding, AlignToPage(pos) - pos);
+                stream.write((const char*)param->Output().Values(), param->Output().Length() * sizeof(float));
+            }
+        }
+
+        stream.close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::LoadWeightsNative(const string& filename, bool ignoreInputLayer, bool byName)
+    {
+        auto mappedFile = new MappedFile(filename, true);
+        if (!mappedFile->IsValid())
+        {
+            cout << "File '" << filename << "' could not be mapped.\n";
+            delete mappedFile;
+            return;
+        }
+
+        uint8_t* data = mappedFile->MutableData();
+        size_t pos = sizeof(NATIVE_WEIGHTS_MAGIC) - 1;
+        auto readU32 = [&]()
+        {
+            NEURO_ASSERT(pos + sizeof(uint32_t) <= mappedFile->Size(), "Unexpected end of weights file '" << filename << "'.");
+            uint32_t value;
+            memcpy(&value, data + pos, sizeof(value));
+            pos += sizeof(value);
+            return value;
+        };
+
+        uint32_t version = readU32();
+        NEURO_ASSERT(version == NATIVE_WEIGHTS_VERSION, "Unsupported version " << version << " of weights file '" << filename << "'.");
+
+        struct SavedParameter
+        {
+            uint32_t dims[4];
+            uint64_t offset;
+        };
+
+        uint32_t layersNum = readU32();
+        vector<vector<SavedParameter>> savedLayersParams(layersNum);
+        vector<string> savedLayersNames(layersNum);
+        map<string, size_t> layerNameToIdx;
+
+        for (uint32_t l = 0; l < layersNum; ++l)
+        {
+            uint32_t nameLen = readU32();
+            NEURO_ASSERT(pos + nameLen <= mappedFile->Size(), "Unexpected end of weights file '" << filename << "'.");
+            savedLayersNames[l].assign((const char*)data + pos, nameLen);
+            layerNameToIdx[savedLayersNames[l]] = l;
+            pos += nameLen;
+
+            savedLayersParams[l].resize(readU32());
+            for (auto& savedParam : savedLayersParams[l])
+            {
+                for (uint32_t d = 0; d < 4; ++d)
+                    savedParam.dims[d] = readU32();
+                NEURO_ASSERT(pos + sizeof(uint64_t) <= mappedFile->Size(), "Unexpected end of weights file '" << filename << "'.");
+                memcpy(&savedParam.offset, data + pos, sizeof(uint64_t));
+                pos += sizeof(uint64_t);
+            }
+        }
+
+        auto layers = Layers();
+        // file saved with all layers can still be loaded while ignoring input layer
+        size_t savedLayersOffset = 0;
+        if (ignoreInputLayer)
+        {
+            if (layersNum == layers.size() && savedLayersNames[0] == layers[0]->Name())
+                savedLayersOffset = 1;
+            layers.erase(layers.begin()); // remove input layer from the list
+        }
+
+        if (!byName)
+            NEURO_ASSERT(layersNum - savedLayersOffset == layers.size(), "Number of saved layers doesn't match number of layers in the model. Found " << layersNum - savedLayersOffset << " expected " << layers.size() << ".");
+
+        vector<SerializedParameter> params;
+
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            auto layer = layers[l];
+
+            if (byName && layerNameToIdx.find(layer->Name()) == layerNameToIdx.end())
+            {
+                cout << "Weights for layer '" << layer->Name() << "' not found.\n";
+                continue;
+            }
+
+            auto& savedParams = savedLayersParams[byName ? layerNameToIdx[layer->Name()] : l + savedLayersOffset];
+
+            params.clear();
+            layer->SerializedParameters(params);
+            NEURO_ASSERT(savedParams.size() == params.size(), "Number of saved parameters doesn't match number of parameters in layer '" << layer->Name() << "'. Found " << savedParams.size() << " expected " << params.size() << ".");
+
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                auto& w = params[i].param->Output();
+                auto& wShape = w.GetShape();
+
+                for (uint32_t d = 0; d < 4; ++d)
+                    NEURO_ASSERT(savedParams[i].dims[d] == wShape.Dimensions[d], "Dimension " << d << " of parameter '" << w.Name() << "' doesn't match corresponding dimension of saved parameter. Found " << savedParams[i].dims[d] << " expected " << wShape.Dimensions[d] << ".");
+                NEURO_ASSERT(savedParams[i].offset + wShape.Length * sizeof(float) <= mappedFile->Size(), "Values of parameter '" << w.Name() << "' exceed weights file '" << filename << "'.");
+
+                // parameter is using mapped pages directly, training will make private copies of modified pages
+                w.Alias((const float*)(data + savedParams[i].offset), Shape(wShape), true);
+                params[i].param->ForceInitialized();
+            }
+        }
+
+        m_MappedWeights.push_back(mappedFile);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::LoadWeightsCached(const string& filename, bool ignoreInputLayer, bool byName)
+    {
+        string nativeFilename = filename + NATIVE_WEIGHTS_EXT;
+        if (std::experimental::filesystem::exists(nativeFilename))
+        {
+            LoadWeights(nativeFilename, ignoreInputLayer, byName);
+            return;
+        }
+
+        LoadWeights(filename, ignoreInputLayer, byName);
+        // same layers have to be saved so native copy is loaded with the same arguments
+        SaveWeightsNative(nativeFilename, ignoreInputLayer);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::SaveGraph(const string& filename, bool saveWeights) const
+    {
+        vector<Placeholder*> inputs;
+        for (auto input : m_Inputs)
+        {
+            NEURO_ASSERT(input->IsPlaceholder(), "Model input '" << input->Name() << "' is not a placeholder.");
+            inputs.push_back(static_cast<Placeholder*>(input));
+        }
+
+        Graph::Default()->Save(filename, inputs, m_Outputs, saveWeights);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::SaveCheckpoint(const string& filename, const Operation* minimization)
+    {
+        if (!minimization)
+            minimization = m_Minimization;
+
+        // values are copied to host on calling thread so training can continue modifying parameters right away
+        auto snapshot = make_shared<CheckpointSnapshot>();
+        vector<SerializedParameter> params;
+        for (auto layer : Layers())
+        {
+            params.clear();
+            layer->SerializedParameters(params);
+
+            snapshot->layers.push_back({ layer->Name(), {} });
+            for (auto& param : params)
+                snapshot->layers.back().second.push_back(param.param->Output());
+        }
+        snapshot->hasOptimizerState = minimization && minimization->GetOptimizerState(snapshot->optimizerState);
+
+        // previous checkpoint has to be finished before it is replaced
+        WaitForCheckpoint();
+
+        m_CheckpointFuture = async(launch::async, [snapshot, filename]()
+        {
+            string tmpFilename = filename + ".tmp";
+            FILE* file = fopen(tmpFilename.c_str(), "wb");
+            if (!file)
+            {
+                cout << "Failed to create checkpoint file '" << tmpFilename << "'.\n";
+                return false;
+            }
+
+            auto writeU32 = [&](uint32_t value) { fwrite(&value, sizeof(value), 1, file); };
+            auto writeString = [&](const string& str) { writeU32((uint32_t)str.length()); fwrite(str.c_str(), 1, str.length(), file); };
+            auto writeTensor = [&](const Tensor& t)
+            {
+                for (uint32_t d = 0; d < 4; ++d)
+                    writeU32(t.GetShape().Dimensions[d]);
+                fwrite(t.Values(), sizeof(float), t.Length(), file);
+            };
+
+            fwrite(CHECKPOINT_MAGIC, 1, sizeof(CHECKPOINT_MAGIC) - 1, file);
+            writeU32(CHECKPOINT_VERSION);
+            writeU32((uint32_t)snapshot->layers.size());
+            for (auto& layer : snapshot->layers)
+            {
+                writeString(layer.first);
+                writeU32((uint32_t)layer.second.size());
+                for (auto& param : layer.second)
+                    writeTensor(param);
+            }
+
+            writeU32(snapshot->hasOptimizerState ? 1 : 0);
+            if (snapshot->hasOptimizerState)
+            {
+                auto& state = snapshot->optimizerState;
+                fwrite(&state.iteration, sizeof(state.iteration), 1, file);
+                writeU32((uint32_t)state.variables.size());
+                for (auto& varState : state.variables)
+                {
+                    writeString(varState.first);
+                    writeU32((uint32_t)varState.second.size());
+                    for (auto& t : varState.second)
+                        writeTensor(t);
+                }
+            }
+
+            // make sure data hits the disk before replacing previous checkpoint so it is never left half-written
+            bool written = !ferror(file) && fflush(file) == 0 && _commit(_fileno(file)) == 0;
+            written &= fclose(file) == 0;
+            if (!written)
+            {
+                cout << "Failed to write checkpoint file '" << tmpFilename << "'.\n";
+                remove(tmpFilename.c_str());
+                return false;
+            }
+
+            // filesystem rename fails when destination already exists
+            if (!MoveFileExW(std::experimental::filesystem::path(tmpFilename).c_str(), std::experimental::filesystem::path(filename).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+            {
+                cout << "Failed to replace checkpoint file '" << filename << "' (error " << GetLastError() << ").\n";
+                return false;
+            }
+            return true;
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::LoadCheckpoint(const string& filename, Operation* minimization)
+    {
+        WaitForCheckpoint();
+
+        if (!std::experimental::filesystem::exists(filename))
+        {
+            cout << "File '" << filename << "' does not exist.\n";
+            return;
+        }
+
+        if (!minimization)
+            minimization = m_Minimization;
+
+        if (!m_Built)
+            Build();
+
+        ifstream stream(filename, ios::in | ios::binary);
+        char magic[sizeof(CHECKPOINT_MAGIC) - 1] = {};
+        stream.read(magic, sizeof(magic));
+        NEURO_ASSERT(stream && memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0, "File '" << filename << "' is not a valid checkpoint.");
+        if (!stream || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+            return;
+
+        auto readU32 = [&]() { uint32_t value = 0; stream.read((char*)&value, sizeof(value)); return value; };
+        auto readString = [&]() { string str(readU32(), '\0'); if (!str.empty()) stream.read(&str[0], str.length()); return str; };
+        auto readShape = [&]() { uint32_t dims[4]; for (auto& dim : dims) dim = readU32(); return Shape(dims[0], dims[1], dims[2], dims[3]); };
+        auto readTensor = [&](Tensor& t)
+        {
+            Shape shape = readShape();
+            NEURO_ASSERT(shape == t.GetShape(), "Mismatched shape of '" << t.Name() << "'. Found " << shape.ToString() << " expected " << t.GetShape().ToString() << ".");
+            t.OverrideHost();
+            stream.read((char*)t.Values(), t.Length() * sizeof(float));
+        };
+
+        uint32_t version = readU32();
+        NEURO_ASSERT(version == CHECKPOINT_VERSION, "Unsupported checkpoint version " << version << ".");
+
+        vector<SerializedParameter> params;
+        uint32_t layersNum = readU32();
+        for (uint32_t l = 0; l < layersNum; ++l)
+        {
+            string layerName = readString();
+            uint32_t paramsNum = readU32();
+
+            auto layer = Layer(layerName);
+            NEURO_ASSERT(layer, "Layer '" << layerName << "' not found.");
+            params.clear();
+            if (layer)
+                layer->SerializedParameters(params);
+            NEURO_ASSERT(params.size() == paramsNum, "Number of saved parameters doesn't match number of parameters in layer '" << layerName << "'. Found " << paramsNum << " expected " << params.size() << ".");
+
+            for (auto& param : params)
+            {
+                readTensor(param.param->Output());
+                param.param->ForceInitialized();
+            }
+        }
+
+        if (readU32() && minimization)
+        {
+            OptimizerState state;
+            stream.read((char*)&state.iteration, sizeof(state.iteration));
+            uint32_t varsNum = readU32();
+            for (uint32_t v = 0; v < varsNum; ++v)
+            {
+                auto& varState = state.variables[readString()];
+                varState.resize(readU32());
+                for (auto& t : varState)
+                {
+                    t.Resize(readShape());
+                    stream.read((char*)t.Values(), t.Length() * sizeof(float));
+                }
+            }
+            minimization->SetOptimizerState(state);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ModelBase::WaitForCheckpoint()
+    {
+        if (m_CheckpointFuture.valid())
+            return m_CheckpointFuture.get();
+        return true;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void ModelBase::Parameters(vector<Variable*>& params, bool onlyTrainable) const
     {
@@ -723,7 +1267,7 @@ namespace Neuro
         uint32_t validationBatchesNum = validationBatchSize > 0 ? (uint32_t)ceil(validationSamplesCount / (float)validationBatchSize) : 0;
         vector<vector<uint32_t>> trainBatchesIndices(trainBatchesNum);
 
-        vector<const_tensor_ptr_vec_t> validInputsBatches, validOutputsBatches;
+        vector<vector<Tensor>> validInputsBatches(validationBatchesNum), validOutputsBatches(validationBatchesNum);
         if (validInputs)
         {
             uint32_t i = 0;
@@ -735,18 +1279,63 @@ namespace Neuro
                 validationBatchIndices.resize(samplesEndIndex - samplesStartIndex);
                 iota(validationBatchIndices.begin(), validationBatchIndices.end(), i);
                 i += (uint32_t)validationBatchIndices.size();
-                validInputsBatches.push_back(GenerateBatch(*validInputs, validationBatchIndices));
-                validOutputsBatches.push_back(GenerateBatch(*validOutputs, validationBatchIndices));
+                GenerateBatch(*validInputs, validationBatchIndices, validInputsBatches[b]);
+                GenerateBatch(*validOutputs, validationBatchIndices, validOutputsBatches[b]);
             }
         }
 
+        // next batch is assembled on background thread while current one is being trained on, each of them has its own set of tensors
+        const bool generateBatches = trainSamplesCount > 1 && trainBatchSize < trainSamplesCount;
+        vector<Tensor> inputsBatches[2], outputsBatches[2];
+        const_tensor_ptr_vec_t inputsBatchesPtrs[2], outputsBatchesPtrs[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            inputsBatches[i].resize(inputs.size());
+            outputsBatches[i].resize(outputs.size());
+            for (auto& t : inputsBatches[i])
+                inputsBatchesPtrs[i].push_back(&t);
+            for (auto& t : outputsBatches[i])
+                outputsBatchesPtrs[i].push_back(&t);
+        }
+
+        // make sure samples are on host before they are accessed from background thread
+        for (auto inputTensor : inputs)
+            inputTensor->Values();
+        for (auto outputTensor : outputs)
+            outputTensor->Values();
+
+        // batch can be assembled once the one which used the same set of tensors two steps ago was trained on
+        mutex batchesMtx;
+        condition_variable batchesCv;
+        uint32_t batchesAssembled = 0, batchesConsumed = 0;
+
+        auto assembleBatches = [&]()
+        {
+            for (uint32_t b = 0; b < trainBatchesNum; ++b)
+            {
+                {
+                    unique_lock<mutex> locker(batchesMtx);
+                    batchesCv.wait(locker, [&]() { return b < batchesConsumed + 2; });
+                }
+
+                GenerateBatch(inputs, trainBatchesIndices[b], inputsBatches[b % 2]);
+                GenerateBatch(outputs, trainBatchesIndices[b], outputsBatches[b % 2]);
+
+                {
+                    unique_lock<mutex> locker(batchesMtx);
+                    batchesAssembled = b + 1;
+                }
+                batchesCv.notify_all();
+            }
+        };
+
         for (uint32_t e = 1; e <= epochs; ++e)
         {
             if (verbose > 0)
                 LogLine("Epoch " + to_string(e) + "/" + to_string(epochs));
 
             // no point generating batches when we have single batch
-            if (trainSamplesCount > 1 && trainBatchSize < trainSamplesCount)
+            if (generateBatches)
             {
                 if (shuffle)
                     random_shuffle(indices.begin(), indices.end(), [&](size_t max) { return GlobalRng().Next((int)max); });
@@ -764,22 +1353,35 @@ namespace Neuro
             float trainTotalAcc = 0;
 
             unique_ptr<Tqdm> progress(verbose == 2 ? new Tqdm(trainSamplesCount) : nullptr);
+            // single thread assembles all batches of an epoch staying at most one batch ahead of training
+            thread assembler;
+            if (generateBatches)
+            {
+                batchesAssembled = batchesConsumed = 0;
+                assembler = thread(assembleBatches);
+            }
+
             for (uint32_t b = 0; b < trainBatchesNum; ++b)
             {
                 uint32_t samplesInBatch = inputs[0]->Batch();
 
                 float loss, acc = 0;
-                if (trainSamplesCount > 1 && trainBatchSize < trainSamplesCount)
+                if (generateBatches)
                 {
-                    auto inputsBatch = GenerateBatch(inputs, trainBatchesIndices[b]);
-                    auto outputsBatch = GenerateBatch(outputs, trainBatchesIndices[b]);
+                    {
+                        unique_lock<mutex> locker(batchesMtx);
+                        batchesCv.wait(locker, [&]() { return batchesAssembled > b; });
+                    }
 
-                    samplesInBatch = inputsBatch[0]->Batch();
+                    samplesInBatch = inputsBatches[b % 2][0].Batch();
 
-                    TrainStep(inputsBatch, outputsBatch, &loss, (m_TrackedMetrics & Accuracy) ? &acc: nullptr);
+                    TrainStep(inputsBatchesPtrs[b % 2], outputsBatchesPtrs[b % 2], &loss, (m_TrackedMetrics & Accuracy) ? &acc: nullptr);
 
-                    DeleteContainer(inputsBatch);
-                    DeleteContainer(outputsBatch);
+                    {
+                        unique_lock<mutex> locker(batchesMtx);
+                        batchesConsumed = b + 1;
+                    }
+                    batchesCv.notify_all();
                 }
                 else
                     TrainStep(inputs, outputs, &loss, &acc);
@@ -796,6 +1398,9 @@ namespace Neuro
                 }
             }
 
+            if (assembler.joinable())
+                assembler.join();
+
             if (progress)
                 LogLine(progress->Str(), false);
 
@@ -874,12 +1479,6 @@ namespace Neuro
                 chartGen ? .Save();*/
         }
 
-        for (size_t b = 0; b < validInputsBatches.size(); ++b)
-        {
-            DeleteContainer(validInputsBatches[b]);
-            DeleteContainer(validOutputsBatches[b]);
-        }
-
         if (m_LogFile && m_LogFile->is_open())
         {
             m_LogFile->close();
@@ -1055,23 +1654,43 @@ namespace Neuro
     }
 
     //////////////////////////////////////////////////////////////////////////
-    const_tensor_ptr_vec_t ModelBase::GenerateBatch(const const_tensor_ptr_vec_t& inputs, const vector<uint32_t>& batchIndices)
+    void ModelBase::GenerateBatch(const const_tensor_ptr_vec_t& inputs, const vector<uint32_t>& batchIndices, vector<Tensor>& result)
     {
-        const_tensor_ptr_vec_t result; // result is a vector of tensors (1 per each input) with multiple (batchIndices.size()) batches in each one of them
+        // result is a vector of tensors (1 per each input) with multiple (batchIndices.size()) batches in each one of them
+        result.resize(inputs.size());
+        uint32_t batchSize = (uint32_t)batchIndices.size();
+
+        // consecutive samples (i.e. when not shuffling) can be used directly without copying
+        bool consecutive = true;
+        for (uint32_t b = 1; consecutive && b < batchSize; ++b)
+            consecutive = batchIndices[b] == batchIndices[b - 1] + 1;
 
         for (uint32_t i = 0; i < inputs.size(); ++i)
         {
-            uint32_t batchSize = (uint32_t)batchIndices.size();
+            auto& t = result[i];
 
-            auto t = new Tensor(Shape(inputs[i]->Width(), inputs[i]->Height(), inputs[i]->Depth(), batchSize));
+            if (consecutive)
+            {
+                t.Alias(*inputs[i], batchIndices[0], batchSize);
+                continue;
+            }
 
-            for (uint32_t b = 0; b < batchSize; ++b)
-                inputs[i]->CopyBatchTo(batchIndices[b], b, *t);
+            // gathered samples cannot be written to aliased input
+            if (t.IsAlias())
+                t.ReleaseData();
 
-            result.push_back(t);
-        }
+            t.Resize(Shape::From(inputs[i]->GetShape(), batchSize));
+            t.OverrideHost();
+
+            const float* srcData = inputs[i]->Values();
+            float* dstData = t.Values();
+            const uint32_t sampleLen = inputs[i]->BatchLength();
 
-        return result;
+            parallel_for(0u, batchSize, [&](uint32_t b)
+            {
+                memcpy(dstData + b * sampleLen, srcData + (size_t)batchIndices[b] * sampleLen, sampleLen * sizeof(float));
+            });
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -49,7 +49,7 @@ namespace Neuro
     Adam::MinimizationOperation::MinimizationOperation(const vector<TensorLike*>& losses, const vector<Variable*>& vars, Variable* globalStep, TensorLike* lr, float beta1, float beta2, float epsilon)
         : Operation(MergeVectors({ losses, vector<TensorLike*>{ lr } }), "adam_minimize"), m_Vars(vars), m_GlobalStep(globalStep), m_LearningRate(lr), m_Beta1(beta1), m_Beta2(beta2), m_Epsilon(epsilon)
     {
-        m_Order = Graph::Default()->BuildBackwardOrder(losses, m_NodesAffectingLosses, vars);
+        m_Plan.params = vars;
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -57,54 +57,122 @@ namespace Neuro
     {
         m_MGradients.clear();
         m_VGradients.clear();
+        m_MomentsVars.clear();
+        m_RestoredMoments.clear();
         m_Iteration = 0;
         if (m_GlobalStep)
             m_GlobalStep->Output()(0) = 0;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    bool Adam::MinimizationOperation::GetOptimizerState(OptimizerState& state) const
+    {
+        state.iteration = m_Iteration;
+        state.variables.clear();
+
+        for (auto& restored : m_RestoredMoments)
+            state.variables[restored.first] = { restored.second.first, restored.second.second };
+
+        for (size_t i = 0; i < m_MomentsVars.size(); ++i)
+            state.variables[m_MomentsVars[i]->Name()] = { m_MGradients[i], m_VGradients[i] };
+
+        // global step is stored as single tensor so it can be told apart from moments
+        if (m_GlobalStep)
+            state.variables[m_GlobalStep->Name()] = { m_GlobalStep->Output() };
+
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Adam::MinimizationOperation::SetOptimizerState(const OptimizerState& state)
+    {
+        m_Iteration = state.iteration;
+        m_RestoredMoments.clear();
+
+        for (auto& varState : state.variables)
+        {
+            if (m_GlobalStep && varState.first == m_GlobalStep->Name())
+            {
+                NEURO_ASSERT(varState.second.size() == 1, "Invalid Adam state of global step '" << varState.first << "'.");
+                varState.second[0].CopyTo(m_GlobalStep->Output());
+                continue;
+            }
+
+            NEURO_ASSERT(varState.second.size() == 2, "Invalid Adam state of variable '" << varState.first << "', expected first and second moments.");
+
+            auto varIt = find_if(m_MomentsVars.begin(), m_MomentsVars.end(), [&](Variable* var) { return var->Name() == varState.first; });
+            if (varIt == m_MomentsVars.end())
+            {
+                // moments will be picked up when variable is optimized for the first time
+                m_RestoredMoments[varState.first] = make_pair(varState.second[0], varState.second[1]);
+                continue;
+            }
+
+            size_t i = distance(m_MomentsVars.begin(), varIt);
+            NEURO_ASSERT(varState.second[0].GetShape() == m_MGradients[i].GetShape(), "Mismatched Adam moments shape of variable '" << varState.first << "'.");
+            varState.second[0].CopyTo(m_MGradients[i]);
+            varState.second[1].CopyTo(m_VGradients[i]);
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Adam::MinimizationOperation::ComputeInternal()
     {
         m_InputsManuallyConsumed = true;
-        auto vars = Graph::Default()->ComputeGradientsInOrder(m_Order, m_InputNodes, m_NodesAffectingLosses, m_Vars);
         ++m_Iteration;
 
-        if (m_MGradients.size() != vars.size())
-        {
-            assert(m_MGradients.empty() && m_VGradients.empty());
-            m_MGradients.reserve(vars.size());
-            m_VGradients.reserve(vars.size());
+        // losses might have been replaced by graph optimization, last input node is learning rate
+        if (!Graph::Default()->IsUpToDate(m_Plan))
+            m_Plan.losses.assign(m_InputNodes.begin(), m_InputNodes.end() - 1);
 
-            for (uint32_t i = 0; i < vars.size(); ++i)
-            {
-                m_MGradients.push_back(zeros(vars[i]->Output().GetShape()));
-                m_MGradients.back().Name(vars[i]->Name() + "/adam_m_grad");
-                //m_MGradients.back().SetStorageType(ST_Offloadable);
+        // moments have to be ready before backward pass since parameters are updated as soon as their gradients are computed
+        auto& vars = Graph::Default()->PrepareGradientsPlan(m_Plan);
 
-                m_VGradients.push_back(zeros(vars[i]->Output().GetShape()));
-                m_VGradients.back().Name(vars[i]->Name() + "/adam_v_grad");
-                //m_VGradients.back().SetStorageType(ST_Offloadable);
+        if (m_MomentsVars != vars)
+        {
+            // moments are matched with variables by index so they have to follow variables order of recompiled plan
+            vector<Tensor> mGradients(vars.size()), vGradients(vars.size());
+            for (size_t i = 0; i < vars.size(); ++i)
+            {
+                auto oldIt = find(m_MomentsVars.begin(), m_MomentsVars.end(), vars[i]);
+                if (oldIt != m_MomentsVars.end())
+                {
+                    mGradients[i] = move(m_MGradients[distance(m_MomentsVars.begin(), oldIt)]);
+                    vGradients[i] = move(m_VGradients[distance(m_MomentsVars.begin(), oldIt)]);
+                    continue;
+                }
+
+                auto restoredIt = m_RestoredMoments.find(vars[i]->Name());
+                if (restoredIt != m_RestoredMoments.end() && restoredIt->second.first.GetShape() == vars[i]->Output().GetShape())
+                {
+                    mGradients[i] = move(restoredIt->second.first);
+                    mGradients[i].Name(vars[i]->Name() + "/adam_m_grad");
+                    vGradients[i] = move(restoredIt->second.second);
+                    vGradients[i].Name(vars[i]->Name() + "/adam_v_grad");
+                    m_RestoredMoments.erase(restoredIt);
+                    continue;
+                }
+
+                mGradients[i] = zeros(vars[i]->Output().GetShape());
+                mGradients[i].Name(vars[i]->Name() + "/adam_m_grad");
+                //mGradients[i].SetStorageType(ST_Offloadable);
+
+                vGradients[i] = zeros(vars[i]->Output().GetShape());
+                vGradients[i].Name(vars[i]->Name() + "/adam_v_grad");
+                //vGradients[i].SetStorageType(ST_Offloadable);
             }
+            m_MGradients = move(mGradients);
+            m_VGradients = move(vGradients);
+            m_MomentsVars = vars;
         }
 
         float learningRate = m_LearningRate->Output()(0) * (float)::sqrt(1.0 - ::pow(m_Beta2, m_Iteration)) / (1.0f - (float)::pow(m_Beta1, m_Iteration));
 
-        for (auto i = 0; i < vars.size(); ++i)
+        Graph::Default()->ComputeGradients(m_Plan, [&](Variable* var, size_t i)
         {
-            auto& value = vars[i]->Output();
-            auto& gradient = vars[i]->OutputGrad();
-            /*value.SyncToHost();
-            gradient.SyncToHost();*/
-            auto& mGrad = m_MGradients[i];
-            //mGrad.SyncToHost();
-            auto& vGrad = m_VGradients[i];
-            //vGrad.SyncToHost();
-
-            Tensor::ActiveOp()->AdamStep(value, gradient, mGrad, vGrad, learningRate, m_Beta1, m_Beta2, m_Epsilon);
-
-            //value.SyncToHost();
-            //gradient.SyncToHost();
-        }
+            assert(i < m_MGradients.size());
+            Tensor::ActiveOp()->AdamStep(var->Output(), var->OutputGrad(), m_MGradients[i], m_VGradients[i], learningRate, m_Beta1, m_Beta2, m_Epsilon);
+        });
 
         if (m_GlobalStep)
             m_GlobalStep->Output()(0) += 1;
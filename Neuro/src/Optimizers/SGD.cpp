@@ -38,16 +38,20 @@ namespace Neuro
     SGD::MinimizationOperation::MinimizationOperation(const vector<TensorLike*>& losses, const vector<Variable*>& vars, float lr)
         : Operation(losses, "sgd_minimize"), m_Vars(vars), m_LearningRate(lr)
     {
-        m_Order = Graph::Default()->BuildBackwardOrder(losses, m_NodesAffectingLosses, vars);
+        m_Plan.params = vars;
     }
 
     //////////////////////////////////////////////////////////////////////////
     void SGD::MinimizationOperation::ComputeInternal()
     {
         m_InputsManuallyConsumed = true; // loss outputs will be completely obliterated after gradients computation
-        auto vars = Graph::Default()->ComputeGradientsInOrder(m_Order, m_InputNodes, m_NodesAffectingLosses, m_Vars);
-
-        for (auto v : vars)
+        // losses might have been replaced by graph optimization
+        if (!Graph::Default()->IsUpToDate(m_Plan))
+            m_Plan.losses = m_InputNodes;
+        // parameters are updated as soon as their gradients are computed
+        Graph::Default()->ComputeGradients(m_Plan, [&](Variable* v, size_t)
+        {
             Tensor::ActiveOp()->SgdStep(v->Output(), v->OutputGrad(), /*batchSize, */m_LearningRate);
+        });
     }
 }
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <ppl.h>
+
+#include "RecordDataset.h"
+#include "Tensors/Tensor.h"
+#include "Memory/MappedFile.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    using namespace concurrency;
+
+    // Index file layout (little-endian):
+    // magic, uint32 version, uint32 record type, uint32 sample dimensions[3], uint32 records per shard, uint64 number of records, uint32 number of shards
+    // Shard file layout:
+    // header: magic, uint32 version, uint32 shard index, uint32 number of records padded to page size
+    // records: samples' values, every record is padded to cache line size
+    static const char RECORD_INDEX_MAGIC[] = "NEURORDI";
+    static const char RECORD_SHARD_MAGIC[] = "NEURORDS";
+    static const uint32_t RECORD_DATASET_VERSION = 1;
+    static const uint32_t RECORD_SHARD_HEADER_SIZE = 4096;
+    static const uint32_t RECORD_ALIGNMENT = 64;
+
+    //////////////////////////////////////////////////////////////////////////
+    static size_t RecordStride(const Shape& sampleShape, ERecordType type)
+    {
+        size_t size = sampleShape.Length * (type == RT_UInt8 ? sizeof(uint8_t) : sizeof(float));
+        return (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static string ShardFilename(const string& prefix, uint32_t shardIdx)
+    {
+        return prefix + "_" + PadLeft(to_string(shardIdx), 5, '0') + ".rec";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    RecordDatasetWriter::RecordDatasetWriter(const string& prefix, const Shape& sampleShape, ERecordType type, uint32_t recordsPerShard)
+        : m_Prefix(prefix), m_SampleShape(Shape::From(sampleShape, 1)), m_Type(type), m_RecordsPerShard(recordsPerShard)
+    {
+        NEURO_ASSERT(recordsPerShard > 0, "At least one record per shard is required.");
+        m_RecordBuffer.resize(RecordStride(m_SampleShape, m_Type));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    RecordDatasetWriter::~RecordDatasetWriter()
+    {
+        Close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDatasetWriter::Write(const Tensor& samples)
+    {
+        NEURO_ASSERT(samples.BatchLength() == m_SampleShape.Length, "Mismatched sample length " << samples.BatchLength() << ", expected " << m_SampleShape.Length << ".");
+        const float* values = samples.Values();
+        for (uint32_t n = 0; n < samples.Batch(); ++n)
+            Write(values + n * samples.BatchLength());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDatasetWriter::Write(const float* sample)
+    {
+        NEURO_ASSERT(!m_Closed, "Writing to closed dataset '" << m_Prefix << "'.");
+
+        if (!m_Shard)
+            OpenShard();
+
+        if (m_Type == RT_UInt8)
+        {
+            for (uint32_t i = 0; i < m_SampleShape.Length; ++i)
+                m_RecordBuffer[i] = (uint8_t)Clip(::round(sample[i]), 0.f, 255.f);
+        }
+        else
+            memcpy(&m_RecordBuffer[0], sample, m_SampleShape.Length * sizeof(float));
+
+        fwrite(&m_RecordBuffer[0], 1, m_RecordBuffer.size(), m_Shard);
+        ++m_RecordsNum;
+
+        if (++m_ShardRecordsNum == m_RecordsPerShard)
+            CloseShard();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDatasetWriter::Close()
+    {
+        if (m_Closed)
+            return;
+
+        CloseShard();
+        m_Closed = true;
+
+        ofstream stream(m_Prefix + ".idx", ios::out | ios::binary | ios::trunc);
+        auto writeU32 = [&](uint32_t value) { stream.write((const char*)&value, sizeof(value)); };
+
+        stream.write(RECORD_INDEX_MAGIC, sizeof(RECORD_INDEX_MAGIC) - 1);
+        writeU32(RECORD_DATASET_VERSION);
+        writeU32((uint32_t)m_Type);
+        writeU32(m_SampleShape.Width());
+        writeU32(m_SampleShape.Height());
+        writeU32(m_SampleShape.Depth());
+        writeU32(m_RecordsPerShard);
+        stream.write((const char*)&m_RecordsNum, sizeof(m_RecordsNum));
+        writeU32(m_ShardsNum);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDatasetWriter::OpenShard()
+    {
+        m_Shard = fopen(ShardFilename(m_Prefix, m_ShardsNum).c_str(), "wb");
+        NEURO_ASSERT(m_Shard, "Failed to create shard " << m_ShardsNum << " of dataset '" << m_Prefix << "'.");
+        m_ShardRecordsNum = 0;
+
+        // header is written again with final number of records once shard is complete
+        vector<uint8_t> header(RECORD_SHARD_HEADER_SIZE, 0);
+        fwrite(&header[0], 1, header.size(), m_Shard);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDatasetWriter::CloseShard()
+    {
+        if (!m_Shard)
+            return;
+
+        uint32_t header[3] = { RECORD_DATASET_VERSION, m_ShardsNum, m_ShardRecordsNum };
+        fseek(m_Shard, 0, SEEK_SET);
+        fwrite(RECORD_SHARD_MAGIC, 1, sizeof(RECORD_SHARD_MAGIC) - 1, m_Shard);
+        fwrite(header, sizeof(uint32_t), 3, m_Shard);
+        fclose(m_Shard);
+        m_Shard = nullptr;
+        ++m_ShardsNum;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    RecordDataset::RecordDataset(const string& prefix)
+    {
+        ifstream stream(prefix + ".idx", ios::in | ios::binary);
+        char magic[sizeof(RECORD_INDEX_MAGIC) - 1] = {};
+        stream.read(magic, sizeof(magic));
+        if (!stream || memcmp(magic, RECORD_INDEX_MAGIC, sizeof(magic)) != 0)
+        {
+            cout << "Dataset index '" << prefix << ".idx' could not be read.\n";
+            return;
+        }
+
+        auto readU32 = [&]() { uint32_t value = 0; stream.read((char*)&value, sizeof(value)); return value; };
+
+        uint32_t version = readU32();
+        NEURO_ASSERT(version == RECORD_DATASET_VERSION, "Unsupported version " << version << " of dataset '" << prefix << "'.");
+        m_Type = (ERecordType)readU32();
+        uint32_t width = readU32();
+        uint32_t height = readU32();
+        uint32_t depth = readU32();
+        m_SampleShape = Shape(width, height, depth);
+        m_RecordsPerShard = readU32();
+        uint64_t recordsNum = 0;
+        stream.read((char*)&recordsNum, sizeof(recordsNum));
+        m_RecordsNum = (size_t)recordsNum;
+        uint32_t shardsNum = readU32();
+        m_RecordStride = RecordStride(m_SampleShape, m_Type);
+
+        for (uint32_t s = 0; s < shardsNum; ++s)
+        {
+            const MappedFile* shard = new MappedFile(ShardFilename(prefix, s));
+            size_t shardRecordsNum = min<size_t>(m_RecordsPerShard, m_RecordsNum - (size_t)s * m_RecordsPerShard);
+            if (!shard->IsValid() || shard->Size() < RECORD_SHARD_HEADER_SIZE + shardRecordsNum * m_RecordStride || memcmp(shard->Data(), RECORD_SHARD_MAGIC, sizeof(RECORD_SHARD_MAGIC) - 1) != 0)
+            {
+                cout << "Shard " << s << " of dataset '" << prefix << "' is missing or incomplete.\n";
+                delete shard;
+                DeleteContainer(m_Shards);
+                return;
+            }
+            m_Shards.push_back(shard);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    RecordDataset::~RecordDataset()
+    {
+        DeleteContainer(m_Shards);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    const uint8_t* RecordDataset::Record(size_t idx) const
+    {
+        NEURO_ASSERT(idx < m_RecordsNum, "Record index " << idx << " is out of range.");
+        return m_Shards[idx / m_RecordsPerShard]->Data() + RECORD_SHARD_HEADER_SIZE + (idx % m_RecordsPerShard) * m_RecordStride;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDataset::Read(size_t idx, float* output) const
+    {
+        const uint8_t* record = Record(idx);
+
+        if (m_Type == RT_Float)
+        {
+            memcpy(output, record, m_SampleShape.Length * sizeof(float));
+            return;
+        }
+
+        for (uint32_t i = 0; i < m_SampleShape.Length; ++i)
+            output[i] = (float)record[i];
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void RecordDataset::Gather(const vector<size_t>& indices, float* output) const
+    {
+        parallel_for(0, (int)indices.size(), [&](int n)
+        {
+            Read(indices[n], output + (size_t)n * m_SampleShape.Length);
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t RecordLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        auto& x = dest[loadIdx];
+        NEURO_ASSERT(x.BatchLength() == m_Dataset.SampleShape().Length, "Mismatched sample length " << x.BatchLength() << ", dataset has " << m_Dataset.SampleShape().Length << ".");
+
+        vector<size_t> indices(m_BatchSize);
+        {
+            unique_lock<mutex> rngLocker(m_RngMtx);
+            for (auto& idx : indices)
+                idx = (size_t)m_Rng.Next((int)m_Dataset.Size());
+        }
+
+        x.ResizeBatch(m_BatchSize);
+        x.OverrideHost();
+        m_Dataset.Gather(indices, x.Values());
+        x.CopyToDevice();
+        return 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void PackImagesDataset(const vector<string>& files, const string& prefix, uint32_t width, uint32_t height, ERecordType type, uint32_t recordsPerShard)
+    {
+        const uint32_t DECODE_BATCH_SIZE = 64;
+
+        RecordDatasetWriter writer(prefix, Shape(width, height, 3), type, recordsPerShard);
+        Tensor batch(Shape(width, height, 3, DECODE_BATCH_SIZE));
+        Tqdm progress(files.size(), 0);
+
+        for (size_t i = 0; i < files.size(); i += DECODE_BATCH_SIZE)
+        {
+            uint32_t batchSize = (uint32_t)min<size_t>(DECODE_BATCH_SIZE, files.size() - i);
+            batch.ResizeBatch(batchSize);
+            batch.OverrideHost();
+            float* values = batch.Values();
+
+            parallel_for(0u, batchSize, [&](uint32_t n)
+            {
+                LoadImage(files[i + n], values + n * batch.BatchLength(), width, height);
+            });
+
+            writer.Write(batch);
+            progress.NextStep(batchSize);
+        }
+
+        writer.Close();
+    }
+}
@@ -0,0 +1,191 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <ppl.h>
+#include <emmintrin.h>
+
+#include "Resampler.h"
+#include "Types.h"
+
+namespace Neuro
+{
+    using namespace concurrency;
+
+    struct ResampleWeights
+    {
+        // for every output pixel index of first contributing input pixel and offset of its weights
+        vector<uint32_t> start;
+        vector<uint32_t> count;
+        vector<float> weights; // maxCount weights per output pixel
+        uint32_t maxCount;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    static float Sinc(float x)
+    {
+        if (x == 0.f)
+            return 1.f;
+        x *= (float)M_PI;
+        return ::sin(x) / x;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static float FilterSupport(EResampleFilter filter)
+    {
+        switch (filter)
+        {
+        case RF_Bilinear: return 1.f;
+        case RF_Bicubic: return 2.f;
+        default: return 3.f;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static float FilterValue(EResampleFilter filter, float x)
+    {
+        x = ::fabs(x);
+        switch (filter)
+        {
+        case RF_Bilinear:
+            return x < 1.f ? 1.f - x : 0.f;
+        case RF_Bicubic:
+        {
+            const float a = -0.5f;
+            if (x < 1.f)
+                return ((a + 2.f) * x - (a + 3.f)) * x * x + 1.f;
+            if (x < 2.f)
+                return (((x - 5.f) * x + 8.f) * x - 4.f) * a;
+            return 0.f;
+        }
+        default:
+            return x < 3.f ? Sinc(x) * Sinc(x / 3.f) : 0.f;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static ResampleWeights ComputeWeights(uint32_t srcSize, uint32_t dstSize, EResampleFilter filter)
+    {
+        const float scale = srcSize / (float)dstSize;
+        // when downscaling filter has to cover all source pixels mapped to output pixel
+        const float filterScale = max(scale, 1.f);
+        const float support = FilterSupport(filter) * filterScale;
+
+        ResampleWeights result;
+        result.maxCount = (uint32_t)::ceil(support) * 2 + 2;
+        result.start.resize(dstSize);
+        result.count.resize(dstSize);
+        result.weights.resize(dstSize * result.maxCount, 0.f);
+
+        for (uint32_t i = 0; i < dstSize; ++i)
+        {
+            const float center = (i + 0.5f) * scale;
+            int first = max((int)::floor(center - support), 0);
+            int last = min((int)::ceil(center + support), (int)srcSize);
+
+            float* weights = &result.weights[i * result.maxCount];
+            float sum = 0.f;
+            uint32_t count = 0;
+            for (int j = first; j < last && count < result.maxCount; ++j, ++count)
+            {
+                weights[count] = FilterValue(filter, (j + 0.5f - center) / filterScale);
+                sum += weights[count];
+            }
+
+            if (sum != 0.f)
+            {
+                for (uint32_t k = 0; k < count; ++k)
+                    weights[k] /= sum;
+            }
+
+            result.start[i] = (uint32_t)first;
+            result.count[i] = count;
+        }
+
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static __m128 LoadPixel(const uint8_t* pixel, uint32_t channels)
+    {
+        switch (channels)
+        {
+        case 1: return _mm_set_ps(0.f, 0.f, 0.f, pixel[0]);
+        case 2: return _mm_set_ps(0.f, 0.f, pixel[1], pixel[0]);
+        case 3: return _mm_set_ps(0.f, pixel[2], pixel[1], pixel[0]);
+        default: return _mm_set_ps(pixel[3], pixel[2], pixel[1], pixel[0]);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ResampleImage(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstPitch, uint32_t channels, EResampleFilter filter, bool multiThreaded)
+    {
+        NEURO_ASSERT(channels >= 1 && channels <= 4, "Unsupported number of channels " << channels << ".");
+        if (!srcWidth || !srcHeight || !dstWidth || !dstHeight)
+            return;
+
+        const ResampleWeights horizontal = ComputeWeights(srcWidth, dstWidth, filter);
+        const ResampleWeights vertical = ComputeWeights(srcHeight, dstHeight, filter);
+
+        // horizontally resampled rows, every pixel occupies 4 floats so it can be processed as a single vector
+        const uint32_t tmpRowLen = dstWidth * 4;
+        vector<float> tmp((size_t)srcHeight * tmpRowLen);
+
+        auto horizontalPass = [&](uint32_t y)
+        {
+            const uint8_t* srcRow = src + (size_t)y * srcPitch;
+            float* tmpRow = &tmp[(size_t)y * tmpRowLen];
+
+            for (uint32_t x = 0; x < dstWidth; ++x)
+            {
+                const float* weights = &horizontal.weights[x * horizontal.maxCount];
+                const uint8_t* pixel = srcRow + horizontal.start[x] * channels;
+                __m128 acc = _mm_setzero_ps();
+                for (uint32_t k = 0; k < horizontal.count[x]; ++k, pixel += channels)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(LoadPixel(pixel, channels), _mm_set1_ps(weights[k])));
+                _mm_storeu_ps(tmpRow + x * 4, acc);
+            }
+        };
+
+        auto verticalPass = [&](uint32_t y)
+        {
+            const float* weights = &vertical.weights[y * vertical.maxCount];
+            const float* firstRow = &tmp[(size_t)vertical.start[y] * tmpRowLen];
+            uint8_t* dstRow = dst + (size_t)y * dstPitch;
+
+            for (uint32_t x = 0; x < dstWidth; ++x)
+            {
+                __m128 acc = _mm_setzero_ps();
+                const float* value = firstRow + x * 4;
+                for (uint32_t k = 0; k < vertical.count[y]; ++k, value += tmpRowLen)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(value), _mm_set1_ps(weights[k])));
+
+                // round and saturate to [0, 255]
+                __m128i pixel = _mm_cvtps_epi32(acc);
+                pixel = _mm_packs_epi32(pixel, pixel);
+                pixel = _mm_packus_epi16(pixel, pixel);
+                uint32_t packed = (uint32_t)_mm_cvtsi128_si32(pixel);
+                uint8_t* out = dstRow + x * channels;
+                for (uint32_t c = 0; c < channels; ++c)
+                    out[c] = (uint8_t)(packed >> (8 * c));
+            }
+        };
+
+        // only rows contributing to any output row need horizontal pass
+        const uint32_t firstSrcRow = vertical.start[0];
+        const uint32_t lastSrcRow = vertical.start[dstHeight - 1] + vertical.count[dstHeight - 1];
+
+        if (multiThreaded)
+        {
+            parallel_for(firstSrcRow, lastSrcRow, horizontalPass);
+            parallel_for(0u, dstHeight, verticalPass);
+        }
+        else
+        {
+            for (uint32_t y = firstSrcRow; y < lastSrcRow; ++y)
+                horizontalPass(y);
+            for (uint32_t y = 0; y < dstHeight; ++y)
+                verticalPass(y);
+        }
+    }
+}
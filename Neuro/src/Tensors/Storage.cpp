@@ -1,5 +1,7 @@
 #include <cuda.h>
 #include <cuda_runtime.h>
+#include <future>
+#include <mutex>
 
 #include "Tensors/Storage.h"
 #include "Memory/MemoryManager.h"
@@ -24,15 +26,35 @@ namespace Neuro
 {
     static const uint32_t MIN_SIZE_TO_OFFLOAD = 4*1024*1024; // 4MB
 
+    struct Storage::DeviceState
+    {
+        ~DeviceState()
+        {
+            if (offloadEvent)
+                CUDA_CHECK(cudaEventDestroy(offloadEvent));
+            if (preloadEvent)
+                CUDA_CHECK(cudaEventDestroy(preloadEvent));
+        }
+
+        cudaEvent_t offloadEvent = nullptr;
+        bool offloadDone = false;
+        mutex offloadDoneCallbackMtx;
+        bool freeDeviceMemOnOffloadDone = false;
+        bool freePinnedMemOnOffloadDone = false;
+        bool offloadRequested = false;
+        promise<void> offloadPromise;
+        future<void> offloadFuture;
+        promise<void> preloadPromise;
+        future<void> preloadFuture;
+        bool preloadRequested = false;
+        cudaEvent_t preloadEvent = nullptr;
+    };
+
     //////////////////////////////////////////////////////////////////////////
     Storage::Storage(int type, size_t size, const string& name)
         : m_Type(type), m_AllocSize(size), m_Size(size), m_Name(name), m_DataLocation(None)
     {
-        if (m_Type & ST_Offloadable)
-        {
-            CUDA_CHECK(cudaEventCreate(&m_OffloadEvent));
-            CUDA_CHECK(cudaEventCreate(&m_PreloadEvent));
-        }
+        NEURO_ASSERT(!(type & ST_HostOnly) || !(type & (ST_Offloadable | ST_KeepDevMem)), "Host-only storage cannot use device memory.");
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -72,10 +94,13 @@ namespace Neuro
                 m_DataPtr = nullptr;
             }
             m_DeviceDataPtr = nullptr;
-            m_PreloadRequested = false;
-            m_OffloadRequested = false;
-            m_FreeDeviceMemOnOffloadDone = false;
-            m_FreePinnedMemOnOffloadDone = false;
+            if (m_DeviceState)
+            {
+                m_DeviceState->preloadRequested = false;
+                m_DeviceState->offloadRequested = false;
+                m_DeviceState->freeDeviceMemOnOffloadDone = false;
+                m_DeviceState->freePinnedMemOnOffloadDone = false;
+            }
         }
         return *this;
     }
@@ -85,12 +110,10 @@ namespace Neuro
     {
         if (this != &other)
         {
-            if (m_OffloadEvent)
-                CUDA_CHECK(cudaEventDestroy(m_OffloadEvent));
-            if (m_PreloadEvent)
-                CUDA_CHECK(cudaEventDestroy(m_PreloadEvent));
             FreeOnDevice(true, true);
             FreeOnHost();
+            delete m_DeviceState;
+            m_DeviceState = nullptr;
             m_Type = other.m_Type;
             m_AllocSize = other.m_AllocSize;
             m_Size = other.m_Size;
@@ -102,22 +125,16 @@ namespace Neuro
             other.m_DeviceDataPtr = nullptr;
             m_DataPtr = other.m_DataPtr;
             other.m_DataPtr = nullptr;
-            m_OffloadEvent = other.m_OffloadEvent;
-            other.m_OffloadEvent = nullptr;
-            NEURO_ASSERT(!other.m_OffloadRequested, "Moving while offload in progress, this may not end well...");
+            m_Aliased = other.m_Aliased;
+            other.m_Aliased = false;
+            m_AliasWritable = other.m_AliasWritable;
+            NEURO_ASSERT(!other.IsOffloadRequested(), "Moving while offload in progress, this may not end well...");
             other.WaitForOffload();
-            m_OffloadRequested = other.m_OffloadRequested;
-            m_FreeDeviceMemOnOffloadDone = other.m_FreeDeviceMemOnOffloadDone;
-            m_FreePinnedMemOnOffloadDone = other.m_FreePinnedMemOnOffloadDone;
-            NEURO_ASSERT(!other.m_PreloadRequested, "Moving while preload in progress, this may not end well...");
+            NEURO_ASSERT(!other.IsPreloadRequested(), "Moving while preload in progress, this may not end well...");
             other.WaitForPreload();
-            m_PreloadRequested = other.m_PreloadRequested;
-            m_PreloadEvent = other.m_PreloadEvent;
-            other.m_PreloadEvent = nullptr;
-            m_OffloadPromise = move(other.m_OffloadPromise);
-            m_OffloadFuture = move(other.m_OffloadFuture);
-            m_PreloadPromise = move(other.m_PreloadPromise);
-            m_PreloadFuture = move(other.m_PreloadFuture);
+            // callbacks are given storage address so nothing can be pending when device state changes owner
+            m_DeviceState = other.m_DeviceState;
+            other.m_DeviceState = nullptr;
         }
         return *this;
     }
@@ -127,10 +144,7 @@ namespace Neuro
     {
         FreeOnDevice(true, true);
         FreeOnHost();
-        if (m_OffloadEvent)
-            CUDA_CHECK(cudaEventDestroy(m_OffloadEvent));
-        if (m_PreloadEvent)
-            CUDA_CHECK(cudaEventDestroy(m_PreloadEvent));
+        delete m_DeviceState;
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -140,20 +154,9 @@ namespace Neuro
             return;
 
         NEURO_ASSERT(!m_DataPtr && !m_DeviceDataPtr, "Changing type of allocated storage is not allowed.");
+        NEURO_ASSERT(!(type & ST_HostOnly) || !(type & (ST_Offloadable | ST_KeepDevMem)), "Host-only storage cannot use device memory.");
 
-        if ((m_Type & ST_Offloadable) && !(type & ST_Offloadable))
-        {
-            CUDA_CHECK(cudaEventDestroy(m_OffloadEvent));
-            m_OffloadEvent = nullptr;
-            CUDA_CHECK(cudaEventDestroy(m_PreloadEvent));
-            m_PreloadEvent = nullptr;
-        }
-        else if (!(m_Type & ST_Offloadable) && (type & ST_Offloadable))
-        {
-            CUDA_CHECK(cudaEventCreate(&m_OffloadEvent));
-            CUDA_CHECK(cudaEventCreate(&m_PreloadEvent));
-        }
-
+        // events are created on first offload/preload
         m_Type = type;
     }
 
@@ -205,6 +208,39 @@ namespace Neuro
         m_DataRefCount = 0;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void Storage::Swap(Storage& other)
+    {
+        NEURO_ASSERT(m_Size == other.m_Size, "Swapping storages of different sizes.");
+        NEURO_ASSERT((m_Type & ST_Offloadable) == (other.m_Type & ST_Offloadable), "Pinned memory can only be swapped with pinned memory.");
+        NEURO_ASSERT(!(m_Type & ST_HostOnly) || !other.m_DeviceDataPtr, "Host-only storage cannot receive device memory.");
+        NEURO_ASSERT(!(other.m_Type & ST_HostOnly) || !m_DeviceDataPtr, "Host-only storage cannot receive device memory.");
+        WaitForOffload();
+        WaitForPreload();
+        other.WaitForOffload();
+        other.WaitForPreload();
+        swap(m_DataPtr, other.m_DataPtr);
+        swap(m_DeviceDataPtr, other.m_DeviceDataPtr);
+        swap(m_AllocSize, other.m_AllocSize);
+        swap(m_DataLocation, other.m_DataLocation);
+        swap(m_Aliased, other.m_Aliased);
+        swap(m_AliasWritable, other.m_AliasWritable);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Storage::Alias(const float* data, size_t size, bool writable)
+    {
+        NEURO_ASSERT(!(m_Type & ST_Offloadable), "Offloadable storage requires pinned memory, it cannot alias external memory.");
+        STORAGE_DEBUG_INFO("Aliasing '%s' <<< %zu elements.\n", m_Name.c_str(), size);
+        FreeOnDevice(true, true);
+        FreeOnHost();
+        m_AllocSize = m_Size = size;
+        m_DataPtr = const_cast<float*>(data);
+        m_Aliased = true;
+        m_AliasWritable = writable;
+        m_DataLocation = Host;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Storage::AllocateOnHost() const
     {
@@ -232,12 +268,12 @@ namespace Neuro
     {
         STORAGE_DEBUG_INFO("Releasing on host '%s' ", m_Name.c_str());
 
-        if (m_OffloadRequested)
+        if (IsOffloadRequested())
         {
-            unique_lock<mutex> mtx(m_OffloadDoneCallbackMtx);
-            if (!m_OffloadDone)
+            unique_lock<mutex> mtx(m_DeviceState->offloadDoneCallbackMtx);
+            if (!m_DeviceState->offloadDone)
             {
-                m_FreePinnedMemOnOffloadDone = true;
+                m_DeviceState->freePinnedMemOnOffloadDone = true;
                 STORAGE_DEBUG_INFO_NO_TS("<<< release will take place on offload-done callback.\n");
                 return;
             }
@@ -250,11 +286,19 @@ namespace Neuro
             STORAGE_DEBUG_INFO_NO_TS("<<< not allocated.\n");
             return;
         }
-        STORAGE_DEBUG_INFO_NO_TS("<<< release incoming.\n");
-        if (m_Type & ST_Offloadable)
-            HostPinnedMemoryManager::Default().Free(m_DataPtr);
+        if (m_Aliased)
+        {
+            STORAGE_DEBUG_INFO_NO_TS("<<< dropping alias.\n");
+            m_Aliased = false;
+        }
         else
-            HostMemoryManager::Default().Free(m_DataPtr);
+        {
+            STORAGE_DEBUG_INFO_NO_TS("<<< release incoming.\n");
+            if (m_Type & ST_Offloadable)
+                HostPinnedMemoryManager::Default().Free(m_DataPtr);
+            else
+                HostMemoryManager::Default().Free(m_DataPtr);
+        }
         
         m_DataPtr = nullptr;
         m_DataLocation = None;
@@ -266,21 +310,25 @@ namespace Neuro
         if (m_AllocSize == 0)
             return;
 
+        NEURO_ASSERT(!(m_Type & ST_HostOnly), "Host-only storage cannot use device memory.");
+
         if (!m_DataPtr)
             AllocateOnHost();
 
-        if (m_OffloadFuture.valid())
+        auto& state = GetDeviceState();
+
+        if (state.offloadFuture.valid())
         {
-            m_OffloadRequested = false;
-            m_OffloadFuture.get();
-            m_OffloadPromise = promise<void>();
+            state.offloadRequested = false;
+            state.offloadFuture.get();
+            state.offloadPromise = promise<void>();
         }
 
-        if (m_PreloadFuture.valid())
+        if (state.preloadFuture.valid())
         {
-            m_PreloadRequested = false;
-            m_PreloadFuture.get();
-            m_PreloadPromise = promise<void>();
+            state.preloadRequested = false;
+            state.preloadFuture.get();
+            state.preloadPromise = promise<void>();
         }
 
         NEURO_ASSERT(m_DataPtr, "Data cannot be only on device.");
@@ -303,12 +351,12 @@ namespace Neuro
         if (forceWaitForOffload)
             WaitForOffload();
 
-        if (m_OffloadRequested)
+        if (IsOffloadRequested())
         {
-            unique_lock<mutex> mtx(m_OffloadDoneCallbackMtx);
-            if (!m_OffloadDone)
+            unique_lock<mutex> mtx(m_DeviceState->offloadDoneCallbackMtx);
+            if (!m_DeviceState->offloadDone)
             {
-                m_FreeDeviceMemOnOffloadDone = true;
+                m_DeviceState->freeDeviceMemOnOffloadDone = true;
                 STORAGE_DEBUG_INFO_NO_TS("<<< release will take place on offload-done callback.\n");
                 return;
             }
@@ -327,7 +375,8 @@ namespace Neuro
             return;
         }
 
-        m_FreeDeviceMemOnOffloadDone = false;
+        if (m_DeviceState)
+            m_DeviceState->freeDeviceMemOnOffloadDone = false;
 
         STORAGE_DEBUG_INFO_NO_TS("<<< release incoming.\n");
         CUDA_CHECK(DeviceMemoryManager::Default().Free((void*)m_DeviceDataPtr));
@@ -343,9 +392,10 @@ namespace Neuro
     {
         NVTXProfile nvtxProfile(__FUNCTION__, 0xFFB200FF);
         Storage* storage = (Storage*)userData;
+        auto state = storage->m_DeviceState;
 
-        unique_lock<mutex> mtx(storage->m_OffloadDoneCallbackMtx);
-        if (storage->m_FreeDeviceMemOnOffloadDone)
+        unique_lock<mutex> mtx(state->offloadDoneCallbackMtx);
+        if (state->freeDeviceMemOnOffloadDone)
         {
             STORAGE_DEBUG_INFO("Offload done '%s'[%d]\n", storage->m_Name.c_str(), storage->m_Type);
             CUDA_CHECK(DeviceMemoryManager::Default().ScheduleFree((void*)storage->m_DeviceDataPtr));
@@ -357,7 +407,7 @@ namespace Neuro
         else
             STORAGE_DEBUG_INFO("Offload done '%s'[%d] <<< not releasing device memory\n", storage->m_Name.c_str(), storage->m_Type);
 
-        if (storage->m_FreePinnedMemOnOffloadDone)
+        if (state->freePinnedMemOnOffloadDone)
         {
             HostPinnedMemoryManager::Default().Free((void*)storage->m_DataPtr);
             storage->m_DataPtr = nullptr;
@@ -365,10 +415,10 @@ namespace Neuro
             storage->m_DataLocation = None;
         }
 
-        storage->m_OffloadDone = true;
-        storage->m_FreeDeviceMemOnOffloadDone = false;
-        storage->m_FreePinnedMemOnOffloadDone = false;
-        storage->m_OffloadPromise.set_value();
+        state->offloadDone = true;
+        state->freeDeviceMemOnOffloadDone = false;
+        state->freePinnedMemOnOffloadDone = false;
+        state->offloadPromise.set_value();
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -381,22 +431,42 @@ namespace Neuro
         // perhaps in the future I will add appropriate locks
         if (storage->m_DeviceDataPtr)
             storage->m_DataLocation = Device;
-        storage->m_PreloadPromise.set_value();
+        storage->m_DeviceState->preloadPromise.set_value();
         STORAGE_DEBUG_INFO("Preload done '%s'[%d]\n", storage->m_Name.c_str(), storage->m_Type);
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    Storage::DeviceState& Storage::GetDeviceState() const
+    {
+        if (!m_DeviceState)
+            m_DeviceState = new DeviceState();
+        return *m_DeviceState;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool Storage::IsOffloadRequested() const
+    {
+        return m_DeviceState && m_DeviceState->offloadRequested;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool Storage::IsPreloadRequested() const
+    {
+        return m_DeviceState && m_DeviceState->preloadRequested;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Storage::WaitForOffload() const
     {
-        if (m_OffloadRequested)
+        if (IsOffloadRequested())
         {
             NVTXProfile p((string(__FUNCTION__) + " " + m_Name).c_str(), 0xFFB200FF);
 
             AutoStopwatch prof(Microseconds);
             STORAGE_DEBUG_INFO("Waiting for offload callback... '%s'[%d]\n", m_Name.c_str(), m_Type);
-            m_OffloadFuture.get(); // wait for callback
-            m_OffloadPromise = promise<void>();
-            m_OffloadRequested = false;
+            m_DeviceState->offloadFuture.get(); // wait for callback
+            m_DeviceState->offloadPromise = promise<void>();
+            m_DeviceState->offloadRequested = false;
             STORAGE_DEBUG_INFO("--> waited %s\n", prof.ToString().c_str());
         }
     }
@@ -404,15 +474,15 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void Storage::WaitForPreload() const
     {
-        if (m_PreloadRequested)
+        if (IsPreloadRequested())
         {
             NVTXProfile p((string(__FUNCTION__) + " " + m_Name).c_str(), 0xFFB200FF);
 
             AutoStopwatch prof(Microseconds);
             STORAGE_DEBUG_INFO("Waiting for preload callback... '%s'[%d]\n", m_Name.c_str(), m_Type);
-            m_PreloadFuture.get(); // wait for callback
-            m_PreloadPromise = promise<void>();
-            m_PreloadRequested = false;
+            m_DeviceState->preloadFuture.get(); // wait for callback
+            m_DeviceState->preloadPromise = promise<void>();
+            m_DeviceState->preloadRequested = false;
             STORAGE_DEBUG_INFO("--> waited %s\n", prof.ToString().c_str());
         }
     }
@@ -460,17 +530,20 @@ namespace Neuro
                 return;
             }
 
-            if (m_OffloadRequested)
+            auto& state = GetDeviceState();
+            if (state.offloadRequested)
             {
                 STORAGE_DEBUG_INFO_NO_TS("<<< requested already.\n");
             }
             else
             {
-                m_OffloadFuture = m_OffloadPromise.get_future();
-                m_OffloadRequested = true;
-                m_OffloadDone = false;
+                if (!state.offloadEvent)
+                    CUDA_CHECK(cudaEventCreate(&state.offloadEvent));
+                state.offloadFuture = state.offloadPromise.get_future();
+                state.offloadRequested = true;
+                state.offloadDone = false;
                 STORAGE_DEBUG_INFO_NO_TS("<<< requested - %d bytes.\n", (int)SizeInBytes());
-                CUDA_CHECK(DeviceMemoryManager::Default().Offload((void*)m_DataPtr, (void*)m_DeviceDataPtr, SizeInBytes(), m_OffloadEvent, OffloadDoneCallback, (void*)this));
+                CUDA_CHECK(DeviceMemoryManager::Default().Offload((void*)m_DataPtr, (void*)m_DeviceDataPtr, SizeInBytes(), state.offloadEvent, OffloadDoneCallback, (void*)this));
             }
         }
         else
@@ -491,14 +564,14 @@ namespace Neuro
         if (m_Type & ST_Offloadable)
         {
             // If we didn't finish offloading yet, cancel device memory deallocation on offload to avoid preload
-            if (m_OffloadRequested)
+            if (IsOffloadRequested())
             {
-                unique_lock<mutex> mtx(m_OffloadDoneCallbackMtx);
-                if (!m_OffloadDone)
+                unique_lock<mutex> mtx(m_DeviceState->offloadDoneCallbackMtx);
+                if (!m_DeviceState->offloadDone)
                 {
                     STORAGE_DEBUG_INFO("Cancelling free device memory on offload done '%s'\n", m_Name.c_str());
-                    m_FreeDeviceMemOnOffloadDone = false;
-                    NEURO_ASSERT(!m_FreePinnedMemOnOffloadDone, "Wtf.");
+                    m_DeviceState->freeDeviceMemOnOffloadDone = false;
+                    NEURO_ASSERT(!m_DeviceState->freePinnedMemOnOffloadDone, "Wtf.");
                 }
             }
 
@@ -514,16 +587,19 @@ namespace Neuro
 
             NEURO_ASSERT(m_DataPtr && m_DeviceDataPtr, "");
 
-            if (m_PreloadRequested)
+            auto& state = GetDeviceState();
+            if (state.preloadRequested)
             {
                 STORAGE_DEBUG_INFO("Preload '%s'[%d] <<< requested already.\n", m_Name.c_str(), m_Type);
             }
             else
             {
-                m_PreloadFuture = m_PreloadPromise.get_future();
-                m_PreloadRequested = true;
+                if (!state.preloadEvent)
+                    CUDA_CHECK(cudaEventCreate(&state.preloadEvent));
+                state.preloadFuture = state.preloadPromise.get_future();
+                state.preloadRequested = true;
                 STORAGE_DEBUG_INFO("Preload '%s'[%d] <<< requested.\n", m_Name.c_str(), m_Type);
-                CUDA_CHECK(DeviceMemoryManager::Default().Preload((void*)m_DeviceDataPtr, (void*)m_DataPtr, SizeInBytes(), m_PreloadEvent, PreloadDoneCallback, (void*)this));
+                CUDA_CHECK(DeviceMemoryManager::Default().Preload((void*)m_DeviceDataPtr, (void*)m_DataPtr, SizeInBytes(), state.preloadEvent, PreloadDoneCallback, (void*)this));
             }
         }
         else
@@ -533,7 +609,10 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void Storage::CopyToDevice() const
     {
-        if (m_PreloadRequested)
+        if (m_Type & ST_HostOnly)
+            return;
+
+        if (IsPreloadRequested())
         {
             STORAGE_DEBUG_INFO("Copy to device '%s'[%d] <<< preload completed check\n", m_Name.c_str(), m_Type);
             WaitForPreload();
@@ -565,7 +644,7 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void Storage::CopyToHost(bool allowAlloc) const
     {
-        if (m_PreloadRequested)
+        if (IsPreloadRequested())
         {
             STORAGE_DEBUG_INFO("Copy to host '%s'[%d] <<< preload completed check\n", m_Name.c_str(), m_Type);
             WaitForPreload();
@@ -588,11 +667,16 @@ namespace Neuro
             NEURO_ASSERT(m_DataLocation != None, "Attempting to copy to unallocated host memory");
             NEURO_ASSERT(m_DataPtr && m_DeviceDataPtr, "");
 
-            if (m_OffloadRequested && (m_Type & ST_Offloadable))
+            if (IsOffloadRequested() && (m_Type & ST_Offloadable))
             {
                 STORAGE_DEBUG_INFO("Copy to host '%s'[%d] <<< offload completed check\n", m_Name.c_str(), m_Type);
                 WaitForOffload();
             }
+            else if (m_Aliased && !m_AliasWritable)
+            {
+                // aliased data is read-only so host copy is still up to date
+                STORAGE_DEBUG_INFO("Copy to host '%s'[%d] <<< aliased\n", m_Name.c_str(), m_Type);
+            }
             else
             {
                 STORAGE_DEBUG_INFO("Copy to host '%s'[%d] <<< %s\n", m_Name.c_str(), m_Type, (m_Type & ST_Offloadable) ? "offloadable but offload wasn't requested" : "not offloadable");
@@ -617,6 +701,9 @@ namespace Neuro
         NEURO_ASSERT(m_DataLocation != None, "Attempting to sync to unallocated host memory");
         NEURO_ASSERT(m_DataPtr && m_DeviceDataPtr, "");
 
+        if (m_Aliased && !m_AliasWritable)
+            return;
+
         STORAGE_DEBUG_INFO("Sync to host '%s'\n", m_Name.c_str());
         CUDA_CHECK(cudaMemcpy((void*)m_DataPtr, (void*)m_DeviceDataPtr, SizeInBytes(), cudaMemcpyDeviceToHost));
     }
@@ -745,7 +832,7 @@ namespace Neuro
     {
         NEURO_ASSERT(m_DeviceDataPtr, "Attempting to write to unallocated device memory.");
         NEURO_ASSERT(m_DataLocation == Device, "Attempting to write to data not located on device.");
-        NEURO_ASSERT(!m_OffloadRequested || m_OffloadDone, "Attempting to write to data being offloaded from device.");
+        NEURO_ASSERT(!IsOffloadRequested() || m_DeviceState->offloadDone, "Attempting to write to data being offloaded from device.");
         return m_DeviceDataPtr;
     }
 
@@ -11,6 +11,7 @@
 #include "Tensors/TensorOpCpuMkl.h"
 #include "Tensors/TensorOpGpu.h"
 #include "Tensors/TensorFormatter.h"
+#include "Memory/ScratchArena.h"
 #include "Random.h"
 #include "Tools.h"
 
@@ -25,7 +26,7 @@ namespace Neuro
     TensorOpCpu* Tensor::g_OpGpu = nullptr;
 
     TensorOpCpu* Tensor::g_DefaultOp = nullptr;
-    TensorOpCpu* Tensor::g_ForcedOp = nullptr;
+    thread_local TensorOpCpu* Tensor::g_ForcedOp = nullptr;
 
     //////////////////////////////////////////////////////////////////////////
     Tensor::Tensor(const Shape& shape, const string& name, EStorageType storageType)
@@ -169,6 +170,16 @@ namespace Neuro
         g_ForcedOp = nullptr;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    bool Tensor::GetForcedOpMode(EOpMode& mode)
+    {
+        if (!g_ForcedOp)
+            return false;
+
+        mode = g_ForcedOp->OpMode();
+        return true;
+    }
+
 	//////////////////////////////////////////////////////////////////////////
 	void Tensor::SetOpMode(EOpMode mode)
 	{
@@ -202,6 +213,13 @@ namespace Neuro
         m_Storage.ChangeType(type);
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::SwapStorage(Tensor& other)
+    {
+        NEURO_ASSERT(Length() == other.Length(), "Mismatched length " << Length() << " vs " << other.Length() << ".");
+        m_Storage.Swap(other.m_Storage);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     bool Tensor::Validate() const
     {
@@ -1445,19 +1463,25 @@ namespace Neuro
     {
         if (axis == BatchAxis)
         {
+            // deviations from mean are kept in result and scaled in place
             if (mean && invVariance)
             {
-                Tensor xmu = Sub(*mean);
-                xmu.MulElem(*invVariance, result);
+                Sub(*mean, result);
+                result.MulElem(*invVariance, result);
                 return make_pair(*mean, *invVariance);
             }
 
             float n = (float)Batch();
             Tensor xmean = Mean(BatchAxis);
-            Tensor xmu = Sub(xmean);
-            Tensor variance = xmu.Map([](float x) { return x * x; }).Sum(BatchAxis).Mul(1.f / n);
-            Tensor invVar = variance.Map([](float x) { return 1.f / x; });
-            xmu.MulElem(invVar, result);
+            Sub(xmean, result);
+
+            ScratchScope scratch;
+            Tensor sqrXmu = scratch.NewTensor(GetShape());
+            result.Map([](float x) { return x * x; }, sqrXmu);
+            Tensor invVar(xmean.GetShape());
+            sqrXmu.Sum(BatchAxis, invVar);
+            invVar.Map([n](float x) { return n / x; }, invVar);
+            result.MulElem(invVar, result);
             return make_pair(xmean, invVar);
         }
         else
@@ -2594,6 +2618,24 @@ namespace Neuro
         m_Storage.Release();
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::Alias(const Tensor& source, uint32_t batchOffset, uint32_t batchesNum)
+    {
+        if (!batchesNum)
+            batchesNum = source.Batch() - batchOffset;
+
+        NEURO_ASSERT(batchOffset + batchesNum <= source.Batch(), "Aliased batches range exceeds source tensor.");
+        source.CopyToHost();
+        Alias(source.Values() + batchOffset * source.BatchLength(), Shape::From(source.GetShape(), batchesNum));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::Alias(const float* data, const Shape& shape, bool writable)
+    {
+        m_Shape = shape;
+        m_Storage.Alias(data, shape.Length, writable);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Tensor::OverrideHost()
     {
@@ -4,6 +4,7 @@
 #include "Tools.h"
 #include "Tensors/TensorOpCpu.h"
 #include "Tensors/Tensor.h"
+#include "Memory/ScratchArena.h"
 
 namespace Neuro
 {
@@ -91,19 +92,22 @@ namespace Neuro
         const Tensor* finalA = &a;
         const Tensor* finalB = &b;
 
+        ScratchScope scratch;
         Tensor transpA;
         Tensor transpB;
 
         //directly transposing before multiplying is faster due to cache utilization
         if (transposeA)
         {
-            transpA = a.Transpose();
+            transpA = scratch.NewTensor(Shape(a.Height(), a.Width(), a.Depth(), a.Batch()));
+            a.Transpose(transpA);
             finalA = &transpA;
         }
 
         if (transposeB)
         {
-            transpB = b.Transpose();
+            transpB = scratch.NewTensor(Shape(b.Height(), b.Width(), b.Depth(), b.Batch()));
+            b.Transpose(transpB);
             finalB = &transpB;
         }
 
@@ -869,19 +873,20 @@ namespace Neuro
 		input.CopyToHost();
         output.OverrideHost();
 
-		Tensor shifted = input.Sub(input.Max(EAxis::GlobalAxis)(0));
-        Tensor exps = shifted.Map([&](float x) { return (float)exp(x); });
-
-        auto expsValues = exps.Values();
+        auto inputValues = input.Values();
         auto outputValues = output.Values();
+        const uint32_t batchLen = input.BatchLength();
+        const float maxValue = *max_element(inputValues, inputValues + input.Length());
 
-        Tensor sum = exps.Sum(EAxis::_012Axes);
-        sum.Reshape(Shape(sum.Batch()));
-
+        // exponents are stored in output and normalized in place, so no temporaries are needed
 		for (uint32_t n = 0; n < input.Batch(); ++n)
 		{
-            for (uint32_t i = 0, idx = n * input.BatchLength(); i < input.BatchLength(); ++i, ++idx)
-                outputValues[idx] = expsValues[idx] / sum(n);
+            float sum = 0;
+            for (uint32_t i = 0, idx = n * batchLen; i < batchLen; ++i, ++idx)
+                sum += outputValues[idx] = (float)exp(inputValues[idx] - maxValue);
+
+            for (uint32_t i = 0, idx = n * batchLen; i < batchLen; ++i, ++idx)
+                outputValues[idx] /= sum;
 		}
 	}
 
@@ -891,11 +896,22 @@ namespace Neuro
 		output.CopyToHost();
 		outputGradient.CopyToHost();
         inputGradient.OverrideHost();
-        inputGradient.Zero();
 
-		Tensor outputReshaped = output.Reshaped(Shape(1, Shape::Auto, 1, output.Batch()));
-		Tensor jacob = outputReshaped.DiagFlat().Sub(outputReshaped.MatMul(outputReshaped.Transpose()));
-        outputGradient.MatMul(jacob, inputGradient);
+        auto outputValues = output.Values();
+        auto outputGradientValues = outputGradient.Values();
+        auto inputGradientValues = inputGradient.Values();
+        const uint32_t batchLen = output.BatchLength();
+
+        // multiplying by jacobian diag(y) - y * y^T reduces to y * (g - dot(g, y)), so it is never built
+        for (uint32_t n = 0; n < output.Batch(); ++n)
+        {
+            float dot = 0;
+            for (uint32_t i = 0, idx = n * batchLen; i < batchLen; ++i, ++idx)
+                dot += outputGradientValues[idx] * outputValues[idx];
+
+            for (uint32_t i = 0, idx = n * batchLen; i < batchLen; ++i, ++idx)
+                inputGradientValues[idx] = outputValues[idx] * (outputGradientValues[idx] - dot);
+        }
 	}
 
     //////////////////////////////////////////////////////////////////////////
@@ -993,13 +1009,24 @@ namespace Neuro
 
         float gradScale = 1.f/* / batchSize*/;
         float gradScale2 = gradScale * gradScale;
-        
-        // mGrad = beta1 * mGrad + (1 - beta1) * gradient
-        mGrad.Add(beta1, (1 - beta1) * gradScale, gradient, mGrad);
-        // vGrad = beta2 * vGrad + (1 - beta2) * sqr(gradient)
-        vGrad.Map([&](float v, float g) { return v * beta2 + (1 - beta2) * gradScale2 * g * g ; }, gradient, vGrad);
-        // parameter = parameter - mGrad / (sqrt(vGrad) + epsilon) * lr
-        parameter.Sub(mGrad.Div(vGrad.Map([&](float x) { return (float)::sqrt(x) + epsilon; })).Mul(lr), parameter);
+
+        auto parameterValues = parameter.Values();
+        auto gradientValues = gradient.Values();
+        auto mGradValues = mGrad.Values();
+        auto vGradValues = vGrad.Values();
+
+        // all three updates are done in a single pass so no temporaries are needed
+        #pragma omp parallel for
+        for (int i = 0; i < (int)parameter.Length(); ++i)
+        {
+            float g = gradientValues[i];
+            // mGrad = beta1 * mGrad + (1 - beta1) * gradient
+            mGradValues[i] = beta1 * mGradValues[i] + (1 - beta1) * gradScale * g;
+            // vGrad = beta2 * vGrad + (1 - beta2) * sqr(gradient)
+            vGradValues[i] = vGradValues[i] * beta2 + (1 - beta2) * gradScale2 * g * g;
+            // parameter = parameter - mGrad / (sqrt(vGrad) + epsilon) * lr
+            parameterValues[i] -= mGradValues[i] / ((float)::sqrt(vGradValues[i]) + epsilon) * lr;
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
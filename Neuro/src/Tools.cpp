@@ -6,24 +6,32 @@
 #include <sstream>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <ppl.h>
+#include <emmintrin.h>
 #include <stdarg.h>
-#include <experimental/filesystem>
 #include <FreeImage.h>
 #include <nvToolsExt.h>
 
 #include "Tools.h"
+#include "ImageFilesCache.h"
+#include "Memory/ImageCache.h"
+#include "Memory/MappedFile.h"
+#include "Memory/ScratchArena.h"
+#include "Resampler.h"
 #include "Tensors/Tensor.h"
 #include "ComputationalGraph/Variable.h"
 
-namespace fs = std::experimental::filesystem;
-
 #ifndef NDEBUG
 #define CUDA_PROFILING_ENABLED
 #endif
 
 namespace Neuro
 {
+    using namespace concurrency;
+
     Random g_Rng;
+    mutex g_RngMtx;
     
     //////////////////////////////////////////////////////////////////////////
     Random& GlobalRng()
@@ -31,6 +39,12 @@ namespace Neuro
         return g_Rng;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    mutex& GlobalRngMutex()
+    {
+        return g_RngMtx;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void GlobalRngSeed(unsigned int seed)
     {
@@ -69,13 +83,8 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     static void ImageLibInit()
     {
-        static bool imgLibInitialized = false;
-
-        if (!imgLibInitialized)
-        {
-            FreeImage_Initialise();
-            imgLibInitialized = true;
-        }
+        // images are loaded from multiple threads, static initialization makes sure library is initialized only once
+        static bool imgLibInitialized = (FreeImage_Initialise(), true);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -264,161 +273,161 @@ namespace Neuro
     }
 
     //////////////////////////////////////////////////////////////////////////
-    unique_ptr<char[]> LoadBinFileContents(const string& file, size_t* length = nullptr)
+    // Converts bytes to floats applying (value - mean) * scale
+    static void ConvertPixelsRow(const uint8_t* src, float* dst, uint32_t count, float mean, float scale)
     {
-        ifstream stream(file, ios::in | ios::binary | ios::ate);
-        assert(stream);
-        auto size = stream.tellg();
-        unique_ptr<char[]> buffer(new char[size]);
-        stream.seekg(0, ios::beg);
-        stream.read(buffer.get(), size);
-        stream.close();
-        if (length)
-            *length = size;
-        return buffer;
-    }
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 meanV = _mm_set1_ps(mean);
+        const __m128 scaleV = _mm_set1_ps(scale);
 
-    //////////////////////////////////////////////////////////////////////////
-    void LoadMnistData(const string& imagesFile, const string& labelsFile, Tensor& input, Tensor& output, bool normalize, bool generateImage, int maxImages)
-    {
-        auto ReadBigInt32 = [](const unique_ptr<char[]>& buffer, size_t offset)
+        uint32_t i = 0;
+        for (; i + 16 <= count; i += 16)
         {
-            auto ptr = reinterpret_cast<uint32_t*>(buffer.get());
-            auto value = *(ptr + offset);
-            return EndianSwap(value);
-        };
-
-        auto imagesBuffer = LoadBinFileContents(imagesFile);
-        auto labelsBuffer = LoadBinFileContents(labelsFile);
-
-        uint32_t magic1 = ReadBigInt32(imagesBuffer, 0); // discard
-        uint32_t numImages = ReadBigInt32(imagesBuffer, 1);
-        uint32_t imgWidth = ReadBigInt32(imagesBuffer, 2);
-        uint32_t imgHeight = ReadBigInt32(imagesBuffer, 3);
-
-        int magic2 = ReadBigInt32(labelsBuffer, 0); // 2039 + number of outputs
-        int numLabels = ReadBigInt32(labelsBuffer, 1);
-
-        maxImages = maxImages < 0 ? numImages : min<int>(maxImages, numImages);
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), meanV), scaleV));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), meanV), scaleV));
+            _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), meanV), scaleV));
+            _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), meanV), scaleV));
+        }
 
-        int outputsNum = magic2 - 2039;
+        for (; i < count; ++i)
+            dst[i] = (src[i] - mean) * scale;
+    }
 
-        FIBITMAP* image = nullptr;
+    //////////////////////////////////////////////////////////////////////////
+    static void SaveDatasetPreview(const string& filename, const uint8_t* data, uint32_t imagesNum, size_t imageStride, uint32_t imgWidth, uint32_t imgHeight, uint32_t channels)
+    {
         RGBQUAD imageColor;
         imageColor.rgbRed = imageColor.rgbGreen = imageColor.rgbBlue = 255;
-        uint32_t imageRows = (uint32_t)ceil(::sqrt((float)maxImages));
-        uint32_t imageCols = (uint32_t)ceil(::sqrt((float)maxImages));
+        uint32_t imageCols = (uint32_t)ceil(::sqrt((float)imagesNum));
 
-        const uint32_t IMG_WIDTH = imageRows * imgWidth;
+        const uint32_t IMG_WIDTH = imageCols * imgWidth;
         const uint32_t IMG_HEIGHT = imageCols * imgHeight;
-        if (generateImage)
-        {
-            ImageLibInit();
-            image = FreeImage_Allocate(IMG_WIDTH, IMG_HEIGHT, 24);
-            FreeImage_FillBackground(image, &imageColor);
-        }
-
-        input = Tensor(zeros(Shape(imgWidth, imgHeight, 1, maxImages)));
-        output = Tensor(zeros(Shape(outputsNum, 1, 1, maxImages)));
+        const uint32_t planeSize = imgWidth * imgHeight;
 
-        uint8_t* pixelOffset = reinterpret_cast<uint8_t*>(imagesBuffer.get() + 16);
-        uint8_t* labelOffset = reinterpret_cast<uint8_t*>(labelsBuffer.get() + 8);
+        ImageLibInit();
+        FIBITMAP* image = FreeImage_Allocate(IMG_WIDTH, IMG_HEIGHT, 24);
+        FreeImage_FillBackground(image, &imageColor);
 
-        for (uint32_t i = 0; i < (uint32_t)maxImages; ++i)
+        for (uint32_t i = 0; i < imagesNum; ++i)
         {
-            for (uint32_t h = 0; h < imgWidth; ++h)
-            for (uint32_t w = 0; w < imgHeight; ++w)
-            {
-                uint8_t color = *(pixelOffset++);
-                input(w, h, 0, i) = normalize ? color / 255.f : color;
+            const uint8_t* pixels = data + i * imageStride;
 
-                if (image)
-                {
-                    imageColor.rgbRed = imageColor.rgbGreen = imageColor.rgbBlue = color;
-                    FreeImage_SetPixelColor(image, (i % imageCols) * imgWidth + w, IMG_HEIGHT - ((i / imageCols) * imgHeight + h) - 1, &imageColor);
-                }
+            for (uint32_t h = 0; h < imgHeight; ++h)
+            for (uint32_t w = 0; w < imgWidth; ++w)
+            {
+                uint32_t idx = h * imgWidth + w;
+                imageColor.rgbRed = pixels[idx];
+                imageColor.rgbGreen = pixels[(channels > 1 ? planeSize : 0) + idx];
+                imageColor.rgbBlue = pixels[(channels > 1 ? 2 * planeSize : 0) + idx];
+                FreeImage_SetPixelColor(image, (i % imageCols) * imgWidth + w, IMG_HEIGHT - ((i / imageCols) * imgHeight + h) - 1, &imageColor);
             }
-
-            uint8_t label = *(labelOffset++);
-            output(label, 0, 0, i) = 1;
         }
 
-        if (image)
-        {
-            FreeImage_Save(FIF_PNG, image, (imagesFile + ".png").c_str());
-            FreeImage_Unload(image);
-        }
+        FreeImage_Save(FIF_PNG, image, filename.c_str());
+        FreeImage_Unload(image);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void LoadCifar10Data(const string& imagesFile, Tensor& input, Tensor& output, bool normalize, bool generateImage, int maxImages)
+    void LoadMnistData(const string& imagesFile, const string& labelsFile, Tensor& input, Tensor& output, bool normalize, bool generateImage, int maxImages)
     {
-        auto ReadInt32 = [](const unique_ptr<char[]>& buffer, size_t offset)
+        const MappedFile imagesData(imagesFile);
+        const MappedFile labelsData(labelsFile);
+        NEURO_ASSERT(imagesData.IsValid() && imagesData.Size() >= 16, "Failed to open MNIST images file '" << imagesFile << "'.");
+        NEURO_ASSERT(labelsData.IsValid() && labelsData.Size() >= 8, "Failed to open MNIST labels file '" << labelsFile << "'.");
+        if (!imagesData.IsValid() || imagesData.Size() < 16 || !labelsData.IsValid() || labelsData.Size() < 8)
+            return;
+
+        auto ReadBigInt32 = [](const MappedFile& file, size_t offset)
         {
-            auto ptr = reinterpret_cast<uint32_t*>(buffer.get());
-            auto value = *(ptr + offset);
-            return EndianSwap(value);
+            auto ptr = reinterpret_cast<const uint32_t*>(file.Data());
+            return EndianSwap(*(ptr + offset));
         };
 
-        size_t fileLen = 0;
-        auto buffer = LoadBinFileContents(imagesFile, &fileLen);
+        uint32_t numImages = ReadBigInt32(imagesData, 1);
+        uint32_t imgWidth = ReadBigInt32(imagesData, 2);
+        uint32_t imgHeight = ReadBigInt32(imagesData, 3);
 
-        uint32_t numImages = (uint32_t)fileLen / 3073;
-        uint32_t imgWidth = 32;
-        uint32_t imgHeight = 32;
-        uint32_t outputsNum = 10;
+        int magic2 = ReadBigInt32(labelsData, 0); // 2039 + number of outputs
+        uint32_t numLabels = ReadBigInt32(labelsData, 1);
 
         maxImages = maxImages < 0 ? numImages : min<int>(maxImages, numImages);
+        maxImages = min<int>(maxImages, numLabels);
 
-        FIBITMAP* image = nullptr;
-        RGBQUAD imageColor;
-        imageColor.rgbRed = imageColor.rgbGreen = imageColor.rgbBlue = 255;
-        uint32_t imageRows = (uint32_t)ceil(::sqrt((float)maxImages));
-        uint32_t imageCols = (uint32_t)ceil(::sqrt((float)maxImages));
+        const uint32_t imageSize = imgWidth * imgHeight;
+        NEURO_ASSERT(imagesData.Size() >= 16 + (size_t)maxImages * imageSize, "MNIST images file '" << imagesFile << "' is truncated.");
+        NEURO_ASSERT(labelsData.Size() >= 8 + (size_t)maxImages, "MNIST labels file '" << labelsFile << "' is truncated.");
+        if (imagesData.Size() < 16 + (size_t)maxImages * imageSize || labelsData.Size() < 8 + (size_t)maxImages)
+            return;
 
-        const uint32_t IMG_WIDTH = imageRows * imgWidth;
-        const uint32_t IMG_HEIGHT = imageCols * imgHeight;
-        if (generateImage)
-        {
-            ImageLibInit();
-            image = FreeImage_Allocate(IMG_WIDTH, IMG_HEIGHT, 24);
-            FreeImage_FillBackground(image, &imageColor);
-        }
+        int outputsNum = magic2 - 2039;
 
-        input = Tensor(zeros(Shape(imgWidth, imgHeight, 3, maxImages)));
-        output = Tensor(zeros(Shape(outputsNum, 1, 1, maxImages)));
+        const uint8_t* pixels = imagesData.Data() + 16;
+        const uint8_t* labels = labelsData.Data() + 8;
 
-        for (uint32_t i = 0; i < (uint32_t)maxImages; ++i)
+        // every value of input is written below so only one-hot outputs have to be cleared
+        input = Tensor(Shape(imgWidth, imgHeight, 1, maxImages));
+        output = Tensor(Shape(outputsNum, 1, 1, maxImages));
+        input.OverrideHost();
+        output.OverrideHost();
+        float* inputValues = input.Values();
+        float* outputValues = output.Values();
+        fill_n(outputValues, output.Length(), 0.f);
+        const float scale = normalize ? 1 / 255.f : 1.f;
+
+        // images are stored row by row which is exactly tensor's layout
+        parallel_for(0, maxImages, [&](int i)
         {
-            output((uint32_t)buffer[i * 3073], 0, 0, i) = 1;
+            ConvertPixelsRow(pixels + (size_t)i * imageSize, inputValues + (size_t)i * imageSize, imageSize, 0, scale);
+            outputValues[(size_t)i * outputsNum + labels[i]] = 1;
+        });
 
-            uint8_t* pixelOffset = reinterpret_cast<uint8_t*>(buffer.get() + i * 3073 + 1);
+        if (generateImage)
+            SaveDatasetPreview(imagesFile + ".png", pixels, maxImages, imageSize, imgWidth, imgHeight, 1);
+    }
 
-            for (uint32_t h = 0; h < imgWidth; ++h)
-            for (uint32_t w = 0; w < imgHeight; ++w)
-            {
-                uint8_t red = pixelOffset[h * imgWidth + w];
-                uint8_t green = pixelOffset[1024 + h * imgWidth + w];
-                uint8_t blue = pixelOffset[2048 + h * imgWidth + w];
-                input(w, h, 0, i) = normalize ? red / 255.f : red;
-                input(w, h, 1, i) = normalize ? green / 255.f : green;
-                input(w, h, 2, i) = normalize ? blue / 255.f : blue;
-
-                if (image)
-                {
-                    imageColor.rgbRed = red;
-                    imageColor.rgbGreen = green;
-                    imageColor.rgbBlue = blue;
-                    FreeImage_SetPixelColor(image, (i % imageCols) * imgWidth + w, IMG_HEIGHT - ((i / imageCols) * imgHeight + h) - 1, &imageColor);
-                }
-            }
-        }
+    //////////////////////////////////////////////////////////////////////////
+    void LoadCifar10Data(const string& imagesFile, Tensor& input, Tensor& output, bool normalize, bool generateImage, int maxImages)
+    {
+        const MappedFile data(imagesFile);
+        NEURO_ASSERT(data.IsValid(), "Failed to open CIFAR-10 file '" << imagesFile << "'.");
+        if (!data.IsValid())
+            return;
+
+        const uint32_t imgWidth = 32;
+        const uint32_t imgHeight = 32;
+        const uint32_t outputsNum = 10;
+        const uint32_t imageSize = imgWidth * imgHeight * 3;
+        // every record is label byte followed by red, green and blue planes
+        const size_t recordSize = 1 + imageSize;
+
+        uint32_t numImages = (uint32_t)(data.Size() / recordSize);
+        maxImages = maxImages < 0 ? numImages : min<int>(maxImages, numImages);
 
-        if (image)
+        const uint8_t* records = data.Data();
+
+        // every value of input is written below so only one-hot outputs have to be cleared
+        input = Tensor(Shape(imgWidth, imgHeight, 3, maxImages));
+        output = Tensor(Shape(outputsNum, 1, 1, maxImages));
+        input.OverrideHost();
+        output.OverrideHost();
+        float* inputValues = input.Values();
+        float* outputValues = output.Values();
+        fill_n(outputValues, output.Length(), 0.f);
+        const float scale = normalize ? 1 / 255.f : 1.f;
+
+        // planes are stored the same way as tensor's depth
+        parallel_for(0, maxImages, [&](int i)
         {
-            FreeImage_Save(FIF_PNG, image, (imagesFile + ".png").c_str());
-            FreeImage_Unload(image);
-        }
+            const uint8_t* record = records + i * recordSize;
+            ConvertPixelsRow(record + 1, inputValues + (size_t)i * imageSize, imageSize, 0, scale);
+            outputValues[(size_t)i * outputsNum + record[0]] = 1;
+        });
+
+        if (generateImage)
+            SaveDatasetPreview(imagesFile + ".png", records + 1, maxImages, recordSize, imgWidth, imgHeight, 3);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -489,79 +498,85 @@ namespace Neuro
     //}
 
     //////////////////////////////////////////////////////////////////////////
-    void LoadCSVData(const string& filename, int outputsNum, Tensor& input, Tensor& output, bool outputsOneHotEncoded, int maxLines)
+    FIBITMAP* LoadResizedImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, uint32_t& sizeX, uint32_t& sizeY, Random* rng)
     {
-        ifstream infile(filename.c_str());
-        string line;
+        ImageLibInit();
 
-        vector<float> inputValues;
-        vector<float> outputValues;
-        uint32_t batches = 0;
-        uint32_t inputBatchSize = 0;
+        FIBITMAP* image = nullptr;
+        uint32_t targetWidth, targetHeight;
 
-        while (getline(infile, line))
-        {
-            if (maxLines >= 0 && batches >= (uint32_t)maxLines)
-                break;
+        auto& cache = ImageCache::Default();
+        auto cachedImage = cache.IsEnabled() ? cache.Get(filename, targetSizeX, targetSizeY) : nullptr;
 
-            if (line.empty())
-                continue;
+        if (cachedImage)
+        {
+            targetWidth = cachedImage->width;
+            targetHeight = cachedImage->height;
+            image = FreeImage_ConvertFromRawBits(const_cast<BYTE*>(&cachedImage->pixels[0]), targetWidth, targetHeight, targetWidth * 3, 24, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, FALSE);
+        }
+        else
+        {
+            auto format = FreeImage_GetFileType(filename.c_str());
+            NEURO_ASSERT(format != FIF_UNKNOWN, "Unrecognized format while opening '" << filename << "'");
 
-            auto tmp = Split(line, ",");
+            image = FreeImage_Load(format, filename.c_str());
+            NEURO_ASSERT(image, "Failed to open '" << filename << "'");
 
-            ++batches;
-            inputBatchSize = (int)tmp.size() - (outputsOneHotEncoded ? 1 : outputsNum);
+            uint32_t imgWidth = FreeImage_GetWidth(image);
+            uint32_t imgHeight = FreeImage_GetHeight(image);
 
-            for (int i = 0; i < (int)inputBatchSize; ++i)
-                inputValues.push_back((float)atof(tmp[i].c_str()));
+            targetWidth = targetSizeX > 0 ? targetSizeX : imgWidth;
+            targetHeight = targetSizeY > 0 ? targetSizeY : imgHeight;
 
-            for (int i = 0; i < (outputsOneHotEncoded ? 1 : outputsNum); ++i)
+            if ((targetSizeX > 0 || targetSizeY > 0) && (targetWidth != imgWidth || targetHeight != imgHeight))
             {
-                float v = (float)atof(tmp[inputBatchSize + i].c_str());
-
-                if (outputsOneHotEncoded)
+                uint32_t bpp = FreeImage_GetBPP(image);
+                if (FreeImage_GetImageType(image) != FIT_BITMAP || (bpp != 24 && bpp != 32))
                 {
-                    for (int e = 0; e < outputsNum; ++e)
-                        outputValues.push_back(e == (int)v ? 1.f : 0.f);
+                    auto convertedImage = FreeImage_ConvertTo24Bits(image);
+                    FreeImage_Unload(image);
+                    image = convertedImage;
+                    bpp = 24;
                 }
-                else
-                    outputValues.push_back(v);
-            }
-        }
-
-        input = Tensor(inputValues, Shape(inputBatchSize, 1, 1, batches));
-        output = Tensor(outputValues, Shape(outputsNum, 1, 1, batches));
-    }
-
-    //////////////////////////////////////////////////////////////////////////
-    FIBITMAP* LoadResizedImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, uint32_t& sizeX, uint32_t& sizeY)
-    {
-        ImageLibInit();
-
-        auto format = FreeImage_GetFileType(filename.c_str());
-        NEURO_ASSERT(format != FIF_UNKNOWN, "Unrecognized format while opening '" << filename << "'");
-
-        FIBITMAP* image = FreeImage_Load(format, filename.c_str());
-        NEURO_ASSERT(image, "Failed to open '" << filename << "'");
 
-        uint32_t imgWidth = FreeImage_GetWidth(image);
-        uint32_t imgHeight = FreeImage_GetHeight(image);
+                auto resizedImage = FreeImage_Allocate(targetWidth, targetHeight, bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
+                ResampleImage(FreeImage_GetBits(image), imgWidth, imgHeight, FreeImage_GetPitch(image), FreeImage_GetBits(resizedImage), targetWidth, targetHeight, FreeImage_GetPitch(resizedImage), bpp / 8);
+                FreeImage_Unload(image);
+                image = resizedImage;
+            }
 
-        uint32_t targetWidth = targetSizeX > 0 ? targetSizeX : imgWidth;
-        uint32_t targetHeight = targetSizeY > 0 ? targetSizeY : imgHeight;
+            if (cache.IsEnabled())
+            {
+                if (FreeImage_GetBPP(image) != 24)
+                {
+                    auto convertedImage = FreeImage_ConvertTo24Bits(image);
+                    FreeImage_Unload(image);
+                    image = convertedImage;
+                }
 
-        if (targetSizeX > 0 || targetSizeY > 0)
-        {
-            auto resizedImage = FreeImage_Rescale(image, targetWidth, targetHeight);
-            FreeImage_Unload(image);
-            image = resizedImage;
+                auto entry = make_shared<CachedImage>();
+                entry->width = targetWidth;
+                entry->height = targetHeight;
+                entry->pixels.resize(targetWidth * targetHeight * 3);
+                FreeImage_ConvertToRawBits(&entry->pixels[0], image, targetWidth * 3, 24, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, FALSE);
+                cache.Put(filename, targetSizeX, targetSizeY, entry);
+            }
         }
 
         if ((cropSizeX || cropSizeY) && (targetWidth > cropSizeX || targetHeight > cropSizeY))
         {
-            // copy random-part
-            auto left = targetWidth > cropSizeX ? GlobalRng().Next(targetWidth - cropSizeX) : 0;
-            auto top = targetHeight > cropSizeY ? GlobalRng().Next(targetHeight - cropSizeY) : 0;
+            // copy random-part, images can be loaded from multiple threads so global generator has to be locked
+            uint32_t left, top;
+            {
+                unique_lock<mutex> rngLocker(g_RngMtx, defer_lock);
+                if (!rng)
+                {
+                    rngLocker.lock();
+                    rng = &g_Rng;
+                }
+                left = targetWidth > cropSizeX ? rng->Next(targetWidth - cropSizeX) : 0;
+                top = targetHeight > cropSizeY ? rng->Next(targetHeight - cropSizeY) : 0;
+            }
             auto croppedImage = FreeImage_Copy(image, left, top, min(left + cropSizeX, targetWidth), min(top + cropSizeY, targetHeight));
             FreeImage_Unload(image);
             image = croppedImage;
@@ -575,69 +590,108 @@ namespace Neuro
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void LoadImageInternal(FIBITMAP* image, const Shape& shape, EDataFormat targetFormat, float* buffer)
+    void LoadImageInternal(FIBITMAP* image, const Shape& shape, EDataFormat targetFormat, float* buffer, const ImagePreprocess& preprocess)
     {
         NEURO_ASSERT((targetFormat == NCHW && shape.Depth() == 3) || (targetFormat == NHWC && shape.Width() == 3), "Mismatched depth.");
-        RGBQUAD color;
 
-        uint32_t idx = 0;
-        for (uint32_t h = 0; h < shape.Height(); ++h)
-        for (uint32_t w = 0; w < shape.Width(); ++w)
+        FIBITMAP* converted = nullptr;
+        uint32_t bpp = FreeImage_GetBPP(image);
+        if (FreeImage_GetImageType(image) != FIT_BITMAP || (bpp != 24 && bpp != 32))
         {
-            FreeImage_GetPixelColor(image, (unsigned int)w, shape.Height() - (unsigned int)h - 1, &color);
+            image = converted = FreeImage_ConvertTo24Bits(image);
+            bpp = 24;
+        }
+
+        const uint32_t width = FreeImage_GetWidth(image);
+        const uint32_t height = FreeImage_GetHeight(image);
+        const uint32_t pixelSize = bpp / 8;
+
+        // source byte offsets and means of output channels
+        const uint32_t channelOffset[3] = { preprocess.swapChannels ? FI_RGBA_BLUE : FI_RGBA_RED, FI_RGBA_GREEN, preprocess.swapChannels ? FI_RGBA_RED : FI_RGBA_BLUE };
+        const float channelMean[3] = { preprocess.mean[preprocess.swapChannels ? 2 : 0], preprocess.mean[1], preprocess.mean[preprocess.swapChannels ? 0 : 2] };
+
+        vector<uint8_t> planes(targetFormat == NCHW ? width * 3 : 0);
+
+        for (uint32_t h = 0; h < height; ++h)
+        {
+            // scanlines are stored bottom-up
+            const uint8_t* scanline = FreeImage_GetScanLine(image, height - h - 1);
 
             if (targetFormat == NCHW)
             {
-                buffer[shape.GetIndex(w, h, 0u)] = (float)color.rgbRed;
-                buffer[shape.GetIndex(w, h, 1u)] = (float)color.rgbGreen;
-                buffer[shape.GetIndex(w, h, 2u)] = (float)color.rgbBlue;
+                // deinterleave row into channel planes and convert each of them in a single sweep
+                for (uint32_t w = 0; w < width; ++w)
+                {
+                    const uint8_t* pixel = scanline + w * pixelSize;
+                    planes[w] = pixel[channelOffset[0]];
+                    planes[width + w] = pixel[channelOffset[1]];
+                    planes[2 * width + w] = pixel[channelOffset[2]];
+                }
+
+                for (uint32_t c = 0; c < 3; ++c)
+                    ConvertPixelsRow(&planes[c * width], buffer + c * width * height + h * width, width, channelMean[c], preprocess.scale);
             }
             else
             {
-                buffer[idx++] = (float)color.rgbRed;
-                buffer[idx++] = (float)color.rgbGreen;
-                buffer[idx++] = (float)color.rgbBlue;
+                float* row = buffer + h * width * 3;
+                for (uint32_t w = 0; w < width; ++w)
+                {
+                    const uint8_t* pixel = scanline + w * pixelSize;
+                    for (uint32_t c = 0; c < 3; ++c)
+                        row[w * 3 + c] = (pixel[channelOffset[c]] - channelMean[c]) * preprocess.scale;
+                }
             }
         }
+
+        if (converted)
+            FreeImage_Unload(converted);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat)
+    void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat, const ImagePreprocess& preprocess, Random* rng)
     {
         uint32_t sizeX, sizeY;
-        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, sizeX, sizeY);
+        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, sizeX, sizeY, rng);
         Shape imageShape = targetFormat == NCHW ? Shape(sizeX, sizeY, 3) : Shape(3, sizeX, sizeY);
-        LoadImageInternal(image, imageShape, targetFormat, buffer);
+        LoadImageInternal(image, imageShape, targetFormat, buffer, preprocess);
         FreeImage_Unload(image);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    Tensor LoadImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat)
+    Tensor LoadImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat, const ImagePreprocess& preprocess, Random* rng)
     {
         uint32_t sizeX, sizeY;
-        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, sizeX, sizeY);
+        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, sizeX, sizeY, rng);
         Shape imageShape = targetFormat == NCHW ? Shape(sizeX, sizeY, 3) : Shape(3, sizeX, sizeY);
         Tensor result(imageShape);
-        LoadImageInternal(image, imageShape, targetFormat, &result.Values()[0]);
+        LoadImageInternal(image, imageShape, targetFormat, &result.Values()[0], preprocess);
         FreeImage_Unload(image);
         return result;
     }
 
     //////////////////////////////////////////////////////////////////////////
     void SaveImage(const Tensor& t, const string& imageFile, bool denormalize, uint32_t maxCols)
+    {
+        SaveImage(t.Values(), t.GetShape(), imageFile, denormalize, maxCols);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SaveImage(const float* values, const Shape& shape, const string& imageFile, bool denormalize, uint32_t maxCols)
     {
         ImageLibInit();
 
         auto format = FreeImage_GetFIFFromFilename(imageFile.c_str());
         NEURO_ASSERT(format != FIF_UNKNOWN, "Unrecognized format while writing '" << imageFile << "'");
 
-        const uint32_t TENSOR_WIDTH = t.Width();
-        const uint32_t TENSOR_HEIGHT = t.Height();
-        const uint32_t IMG_COLS = min((uint32_t)ceil(::sqrt((float)t.Batch())), maxCols == 0 ? numeric_limits<uint32_t>().max() : maxCols);
-        const uint32_t IMG_ROWS = (uint32_t)ceil((float)t.Batch() / IMG_COLS);
+        const uint32_t TENSOR_WIDTH = shape.Width();
+        const uint32_t TENSOR_HEIGHT = shape.Height();
+        const uint32_t IMG_COLS = min((uint32_t)ceil(::sqrt((float)shape.Batch())), maxCols == 0 ? numeric_limits<uint32_t>().max() : maxCols);
+        const uint32_t IMG_ROWS = (uint32_t)ceil((float)shape.Batch() / IMG_COLS);
         const uint32_t IMG_WIDTH = IMG_COLS * TENSOR_WIDTH;
         const uint32_t IMG_HEIGHT = IMG_ROWS * TENSOR_HEIGHT;
-        const bool GRAYSCALE = (t.Depth() == 1);
+        const bool GRAYSCALE = (shape.Depth() == 1);
+        const float SCALE = denormalize ? 255.0f : 1.f;
+        const uint32_t PLANE_SIZE = TENSOR_WIDTH * TENSOR_HEIGHT;
 
         RGBQUAD color;
         color.rgbRed = color.rgbGreen = color.rgbBlue = 255;
@@ -645,16 +699,25 @@ namespace Neuro
         FIBITMAP* image = FreeImage_Allocate(IMG_WIDTH, IMG_HEIGHT, 24);
         FreeImage_FillBackground(image, &color);
 
-        for (uint32_t n = 0; n < t.Batch(); ++n)
-        for (uint32_t h = 0; h < t.Height(); ++h)
-        for (uint32_t w = 0; w < t.Width(); ++w)
+        // rows of every tile are written directly to scanlines (image is stored bottom-up)
+        parallel_for(0u, shape.Batch(), [&](uint32_t n)
         {
-            color.rgbRed = (int)(t.Get(w, h, 0, n) * (denormalize ? 255.0f : 1.f));
-            color.rgbGreen = GRAYSCALE ? color.rgbRed : (int)(t.Get(w, h, 1, n) * (denormalize ? 255.0f : 1.f));
-            color.rgbBlue = GRAYSCALE ? color.rgbRed : (int)(t.Get(w, h, 2, n) * (denormalize ? 255.0f : 1.f));
+            const float* red = values + n * shape.Stride[3];
+            const float* green = GRAYSCALE ? red : red + PLANE_SIZE;
+            const float* blue = GRAYSCALE ? red : red + 2 * PLANE_SIZE;
 
-            FreeImage_SetPixelColor(image, (n % IMG_COLS) * TENSOR_WIDTH + w, IMG_HEIGHT - ((n / IMG_COLS) * TENSOR_HEIGHT + h) - 1, &color);
-        }
+            for (uint32_t h = 0; h < TENSOR_HEIGHT; ++h)
+            {
+                BYTE* pixel = FreeImage_GetScanLine(image, IMG_HEIGHT - ((n / IMG_COLS) * TENSOR_HEIGHT + h) - 1) + (n % IMG_COLS) * TENSOR_WIDTH * 3;
+                for (uint32_t w = 0; w < TENSOR_WIDTH; ++w, pixel += 3)
+                {
+                    uint32_t i = h * TENSOR_WIDTH + w;
+                    pixel[FI_RGBA_RED] = (BYTE)(int)(red[i] * SCALE);
+                    pixel[FI_RGBA_GREEN] = (BYTE)(int)(green[i] * SCALE);
+                    pixel[FI_RGBA_BLUE] = (BYTE)(int)(blue[i] * SCALE);
+                }
+            }
+        });
 
         FreeImage_Save(format, image, imageFile.c_str());
         FreeImage_Unload(image);
@@ -711,26 +774,43 @@ namespace Neuro
 
     //////////////////////////////////////////////////////////////////////////
     bool IsImageFileValid(const string& filename)
+    {
+        ImageFileInfo info;
+        info.path = filename;
+        ProbeImageFile(info, true);
+        return info.state == IFS_Valid;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ProbeImageFile(ImageFileInfo& info, bool decode)
     {
         ImageLibInit();
 
         FIBITMAP* image = nullptr;
         try
         {
-            auto format = FreeImage_GetFileType(filename.c_str());
-            image = FreeImage_Load(format, filename.c_str());
+            auto format = FreeImage_GetFileType(info.path.c_str());
+            info.format = (int)format;
+            if (format != FIF_UNKNOWN)
+                image = FreeImage_Load(format, info.path.c_str(), decode ? 0 : FIF_LOAD_NOPIXELS);
         }
         catch (...)
         {
-            return false;
+            image = nullptr;
         }
 
         if (!image)
-            return false;
+        {
+            info.state = IFS_Invalid;
+            return;
+        }
 
-        FreeImage_Unload(image);
+        info.width = FreeImage_GetWidth(image);
+        info.height = FreeImage_GetHeight(image);
+        if (decode)
+            info.state = IFS_Valid;
 
-        return true;
+        FreeImage_Unload(image);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -752,70 +832,41 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     Shape GetImageDims(const string& filename)
     {
-        ImageLibInit();
-
-        auto format = FreeImage_GetFileType(filename.c_str());
-        assert(format != FIF_UNKNOWN);
-
-        FIBITMAP* image = FreeImage_Load(format, filename.c_str());
-        assert(image);
+        auto& cache = ImageFilesCache::Default();
+        ImageFileInfo info;
+        if (!cache.Find(filename, info) || !info.width)
+        {
+            info.path = filename;
+            ProbeImageFile(info, false);
+            NEURO_ASSERT(info.width, "Failed to read dimensions of '" << filename << "'");
+            cache.Update(info);
+        }
 
-        Shape shape(FreeImage_GetWidth(image), FreeImage_GetHeight(image), 3);
-            
-        FreeImage_Unload(image);
-        
-        return shape;
+        return Shape(info.width, info.height, 3);
     }
 
     //////////////////////////////////////////////////////////////////////////
     vector<string> LoadFilesList(const string& dir, bool shuffle, bool useCache, bool validate)
     {
-        vector<string> files;
-        ifstream contentCache = ifstream(dir + "_cache");
+        auto& cache = ImageFilesCache::Default();
+        vector<ImageFileInfo> entries;
 
-        if (!useCache)
-            contentCache.close();
+        if (useCache)
+            entries = cache.Load(dir);
 
-        if (contentCache && useCache)
-        {
-            string entry;
-            while (getline(contentCache, entry))
-                files.push_back(entry);
-            contentCache.close();
-        }
-        else
-        {
-            auto contentCache = ofstream(dir + "_cache");
+        // cache has to be refreshed when any of its files was never validated
+        bool refresh = entries.empty() || (validate && any_of(entries.begin(), entries.end(), [](const ImageFileInfo& info) { return info.state == IFS_Unknown; }));
+        if (refresh)
+            entries = cache.Refresh(dir, validate);
 
-            // build content files list
-            for (const auto& entry : fs::directory_iterator(dir))
-            {
-                string filename = entry.path().generic_string();
-                files.push_back(filename);
-                if (!validate)
-                    contentCache << files.back() << endl;
-            }
-
-            if (validate)
-            {
-                vector<string> validFiles;
-
-                //Tqdm progress(files.size(), 20);
-                for (size_t i = 0; i < files.size(); ++i/*, progress.NextStep()*/)
-                {
-                    if (!IsImageFileValid(files[i]))
-                    {
-                        cout << "Detected invalid image file '" << files[i] << "'" << endl;
-                        continue;
-                    }
-                    validFiles.push_back(files[i]);
-                    contentCache << files.back() << endl;
-                }
-
-                files = validFiles;
-            }
-
-            contentCache.close();
+        vector<string> files;
+        files.reserve(entries.size());
+        for (const auto& info : entries)
+        {
+            // files known to be invalid are always skipped, validation only makes sure there are no files of unknown state
+            if (info.state == IFS_Invalid || (validate && info.state != IFS_Valid))
+                continue;
+            files.push_back(info.path);
         }
 
         if (shuffle)
@@ -875,16 +926,36 @@ namespace Neuro
         NEURO_ASSERT(img.Depth() == 1, "Image has to be black and white (only 1 channel).");
         NEURO_ASSERT(img.Batch() == 1, "Batches are not supported.");
 
-        Tensor kX({ 1.f, 0.f, -1.f, 2.f, 0.f, -2.f, 1.f, 0.f, -1.f }, Shape(3, 3));
-        Tensor kY({ -1.f, -2.f, -1.f, 0.f, 0.f, 0.f, 1.f, 2.f, 1.f }, Shape(3, 3));
-
-        Tensor iX = img.Conv2D(kX, 1, 1, NCHW);
-        Tensor iY = img.Conv2D(kY, 1, 1, NCHW);
-
-        g = sqrt(sqr(iX) + sqr(iY));
-        g.Mul(255.f / g.Max(GlobalAxis)(0), g);
-
-        theta = iY.Map([](float y, float x) { return atan2(y, x); }, iX);
+        static const float KERNEL_X[] = { 1.f, 0.f, -1.f, 2.f, 0.f, -2.f, 1.f, 0.f, -1.f };
+        static const float KERNEL_Y[] = { -1.f, -2.f, -1.f, 0.f, 0.f, 0.f, 1.f, 2.f, 1.f };
+
+        ScratchScope scratch;
+        Tensor kX, kY;
+        kX.Alias(KERNEL_X, Shape(3, 3));
+        kY.Alias(KERNEL_Y, Shape(3, 3));
+
+        Tensor iX = scratch.NewTensor(img.GetShape());
+        Tensor iY = scratch.NewTensor(img.GetShape());
+        img.Conv2D(kX, 1, 1, NCHW, iX);
+        img.Conv2D(kY, 1, 1, NCHW, iY);
+
+        g.Resize(img.GetShape());
+        theta.Resize(img.GetShape());
+        g.OverrideHost();
+        theta.OverrideHost();
+
+        auto iXValues = iX.Values();
+        auto iYValues = iY.Values();
+        auto gValues = g.Values();
+        auto thetaValues = theta.Values();
+        float maxG = 0;
+        for (uint32_t i = 0; i < img.Length(); ++i)
+        {
+            gValues[i] = ::sqrt(iXValues[i] * iXValues[i] + iYValues[i] * iYValues[i]);
+            thetaValues[i] = ::atan2(iYValues[i], iXValues[i]);
+            maxG = max(maxG, gValues[i]);
+        }
+        g.Mul(255.f / maxG, g);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -970,17 +1041,164 @@ namespace Neuro
         }
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    // Scratch memory is kept per thread so edge detection running in loader workers doesn't allocate for every image
+    static void CannyEdgeDetectionInternal(const float* img, uint32_t width, uint32_t height, uint32_t channels, float* edges)
+    {
+        const int GAUSSIAN_RADIUS = 2;
+        const float GAUSSIAN_SIGMA = 1.4f;
+        const float HIGH_THRESHOLD_RATIO = 0.17f;
+        const float LOW_THRESHOLD_RATIO = 0.09f;
+        const float TAN_22_5 = 0.41421356f;
+        const float TAN_67_5 = 2.41421356f;
+        enum { EDGE_NONE = 0, EDGE_WEAK = 1, EDGE_STRONG = 2 };
+
+        static thread_local vector<float> gray, tmp, blurred, magnitude;
+        static thread_local vector<uint8_t> direction, labels;
+        static thread_local vector<uint32_t> stack;
+
+        const uint32_t size = width * height;
+        // blurred image has 1 pixel wide zero border so Sobel filters don't need any bounds checks
+        const uint32_t paddedWidth = width + 2;
+        gray.resize(size);
+        tmp.resize(size);
+        blurred.assign(paddedWidth * (height + 2), 0.f);
+        magnitude.resize(size);
+        direction.resize(size);
+        labels.resize(size);
+
+        const float* grayValues = img;
+        if (channels == 3)
+        {
+            for (uint32_t i = 0; i < size; ++i)
+                gray[i] = img[i] * 0.2989f + img[size + i] * 0.5870f + img[2 * size + i] * 0.1140f;
+            grayValues = &gray[0];
+        }
+
+        // 2D gaussian kernel is a product of two 1D kernels so it is applied as horizontal and vertical pass (with zero padding)
+        float kernel[2 * GAUSSIAN_RADIUS + 1];
+        for (int t = -GAUSSIAN_RADIUS; t <= GAUSSIAN_RADIUS; ++t)
+            kernel[t + GAUSSIAN_RADIUS] = ::exp(-(t * t) / (2.f * GAUSSIAN_SIGMA * GAUSSIAN_SIGMA)) / (::sqrt(2.f * (float)M_PI) * GAUSSIAN_SIGMA);
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const float* src = grayValues + y * width;
+            float* dst = &tmp[y * width];
+            for (int x = 0; x < (int)width; ++x)
+            {
+                float sum = 0.f;
+                int tBegin = max(-GAUSSIAN_RADIUS, -x), tEnd = min(GAUSSIAN_RADIUS, (int)width - 1 - x);
+                for (int t = tBegin; t <= tEnd; ++t)
+                    sum += kernel[t + GAUSSIAN_RADIUS] * src[x + t];
+                dst[x] = sum;
+            }
+        }
+
+        for (int y = 0; y < (int)height; ++y)
+        {
+            float* dst = &blurred[(y + 1) * paddedWidth + 1];
+            int tBegin = max(-GAUSSIAN_RADIUS, -y), tEnd = min(GAUSSIAN_RADIUS, (int)height - 1 - y);
+            for (int t = tBegin; t <= tEnd; ++t)
+            {
+                const float* src = &tmp[(y + t) * width];
+                const float k = kernel[t + GAUSSIAN_RADIUS];
+                for (uint32_t x = 0; x < width; ++x)
+                    dst[x] += k * src[x];
+            }
+        }
+
+        // Sobel gradients with magnitude and direction quantized to 0, 45, 90 and 135 degrees without computing angle itself
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const float* top = &blurred[y * paddedWidth + 1];
+            const float* mid = top + paddedWidth;
+            const float* bottom = mid + paddedWidth;
+            float* mag = &magnitude[y * width];
+            uint8_t* dir = &direction[y * width];
+
+            for (int x = 0; x < (int)width; ++x)
+            {
+                float gX = (top[x - 1] + 2.f * mid[x - 1] + bottom[x - 1]) - (top[x + 1] + 2.f * mid[x + 1] + bottom[x + 1]);
+                float gY = (bottom[x - 1] + 2.f * bottom[x] + bottom[x + 1]) - (top[x - 1] + 2.f * top[x] + top[x + 1]);
+                float absX = ::fabs(gX), absY = ::fabs(gY);
+                mag[x] = ::sqrt(gX * gX + gY * gY);
+                dir[x] = absY <= TAN_22_5 * absX ? 0 : (absY >= TAN_67_5 * absX ? 2 : (gX * gY > 0 ? 1 : 3));
+            }
+        }
+
+        // non-maximum suppression picks neighbours along gradient direction from offsets table, border pixels are suppressed
+        const int neighbours[4][2] = { { 1, -1 }, { (int)width - 1, 1 - (int)width }, { (int)width, -(int)width }, { -(int)width - 1, (int)width + 1 } };
+        float maxValue = 0.f;
+        fill_n(edges, size, 0.f);
+
+        for (uint32_t y = 1; y + 1 < height; ++y)
+        for (uint32_t x = 1; x + 1 < width; ++x)
+        {
+            uint32_t i = y * width + x;
+            const float m = magnitude[i];
+            const int* n = neighbours[direction[i]];
+            float value = (m >= magnitude[i + n[0]]) & (m >= magnitude[i + n[1]]) ? m : 0.f;
+            edges[i] = value;
+            maxValue = max(maxValue, value);
+        }
+
+        // double threshold followed by hysteresis growing strong edges through connected weak pixels
+        const float highThreshold = maxValue * HIGH_THRESHOLD_RATIO;
+        const float lowThreshold = highThreshold * LOW_THRESHOLD_RATIO;
+        stack.clear();
+
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            const float value = edges[i];
+            labels[i] = value > 0.f && value >= highThreshold ? EDGE_STRONG : (value > 0.f && value >= lowThreshold ? EDGE_WEAK : EDGE_NONE);
+            if (labels[i] == EDGE_STRONG)
+                stack.push_back(i);
+        }
+
+        // strong pixels are never on the border so all their neighbours are valid
+        const int around[8] = { -(int)width - 1, -(int)width, -(int)width + 1, -1, 1, (int)width - 1, (int)width, (int)width + 1 };
+        while (!stack.empty())
+        {
+            uint32_t i = stack.back();
+            stack.pop_back();
+
+            for (int offset : around)
+            {
+                uint32_t j = i + offset;
+                if (labels[j] == EDGE_WEAK)
+                {
+                    labels[j] = EDGE_STRONG;
+                    stack.push_back(j);
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < size; ++i)
+            edges[i] = labels[i] == EDGE_STRONG ? 255.f : 0.f;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CannyEdgeDetection(const Tensor& img, Tensor& edges)
+    {
+        NEURO_ASSERT(img.Depth() == 1 || img.Depth() == 3, "Image has to be black and white or RGB.");
+
+        const float* imgValues = img.Values();
+        edges.Resize(Shape(img.Width(), img.Height(), 1, img.Batch()));
+        edges.OverrideHost();
+        float* edgesValues = edges.Values();
+
+        parallel_for(0u, img.Batch(), [&](uint32_t n)
+        {
+            CannyEdgeDetectionInternal(imgValues + n * img.BatchLength(), img.Width(), img.Height(), img.Depth(), edgesValues + n * edges.BatchLength());
+        });
+    }
+
     //////////////////////////////////////////////////////////////////////////
     Tensor CannyEdgeDetection(const Tensor& img)
     {
-        Tensor output = img.ToGrayScale();
-        auto blurred = output.Conv2D(GaussianFilter(5, 1.4f), 1, 2, NCHW);
-        Tensor g, theta;
-        SobelFilters(blurred, g, theta);
-        auto nonMaxImg = NonMaxSuppression(g, theta);
-        auto thresholdImg = Threshold(nonMaxImg, 0.09f, 0.17f);
-        Hysteresis(thresholdImg, 100);
-        return thresholdImg;
+        Tensor edges;
+        CannyEdgeDetection(img, edges);
+        return edges;
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -1132,9 +1350,34 @@ namespace Neuro
         auto& x = dest[loadIdx];
         x.ResizeBatch(m_BatchSize);
         x.OverrideHost();
-        for (uint32_t j = 0; j < x.Batch(); ++j)
-            LoadImage(m_Files[GlobalRng().Next((int)m_Files.size())], x.Values() + j * x.BatchLength(), x.Width() * m_UpScaleFactor, x.Height() * m_UpScaleFactor, x.Width(), x.Height());
+        vector<const string*> files;
+        vector<unsigned int> seeds;
+        {
+            unique_lock<mutex> rngLocker(g_RngMtx);
+            files = SampleFiles(g_Rng, &seeds);
+        }
+        parallel_for(0u, x.Batch(), [&](uint32_t j)
+        {
+            Random cropRng(seeds[j]);
+            LoadImage(*files[j], x.Values() + j * x.BatchLength(), x.Width() * m_UpScaleFactor, x.Height() * m_UpScaleFactor, x.Width(), x.Height(), NCHW, m_Preprocess, &cropRng);
+        });
         x.CopyToDevice();
         return 1;
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<const string*> ImageLoader::SampleFiles(Random& rng, vector<unsigned int>* seeds)
+    {
+        unique_lock<mutex> sampleLocker(m_SampleMtx);
+        vector<const string*> files(m_BatchSize);
+        for (auto& file : files)
+            file = &m_Files[rng.Next((int)m_Files.size())];
+        if (seeds)
+        {
+            seeds->resize(m_BatchSize);
+            for (auto& seed : *seeds)
+                seed = (unsigned int)rng.Next(numeric_limits<int>::max());
+        }
+        return files;
+    }
 }
\ No newline at end of file